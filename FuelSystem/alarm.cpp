@@ -0,0 +1,93 @@
+#include "alarm.h"
+
+/*
+ * Function: watch
+ * ---------------
+ * tankID: Tank to watch, replaces any earlier thresholds
+ * low, high: Fill ratios that raise the alarms
+ * hysteresis: How far back past a threshold the ratio must go to clear its alarm
+ * ratio: Current fill ratio, an alarm it already meets is raised now
+ *
+ * return: True if the thresholds are valid
+ */
+bool AlarmIndex::watch(int tankID, double low, double high, double hysteresis, double ratio) {
+	//Written so that a NaN bound fails too
+	if (!(low >= 0 && high <= 1 && low < high && hysteresis >= 0)) {
+		return false;
+	}
+
+	m_watched[tankID] = Threshold{ low, high, hysteresis, false, false };
+	check(tankID, ratio);
+	return true;
+}
+
+bool AlarmIndex::unwatch(int tankID) {
+	return m_watched.erase(tankID) > 0;
+}
+
+void AlarmIndex::clear() {
+	m_watched.clear();
+	m_queue.clear();
+}
+
+/*
+ * Function: check
+ * ---------------
+ * tankID: Tank whose level changed
+ * ratio: Its new fill ratio
+ *
+ * Raises or clears the tank's alarms, a tank that is not watched costs one lookup. An alarm
+ * clears only strictly past its band, so a tank sitting on a threshold does not toggle
+ */
+void AlarmIndex::check(int tankID, double ratio) {
+	auto found = m_watched.find(tankID);
+	if (found == m_watched.end()) {
+		return;
+	}
+
+	Threshold& threshold = found->second;
+	if (!threshold.lowRaised && ratio <= threshold.low) {
+		threshold.lowRaised = true;
+		fire(tankID, LOWALARM, ratio);
+	}
+	else if (threshold.lowRaised && ratio > threshold.low + threshold.hysteresis) {
+		threshold.lowRaised = false;
+		fire(tankID, LOWCLEAR, ratio);
+	}
+
+	if (!threshold.highRaised && ratio >= threshold.high) {
+		threshold.highRaised = true;
+		fire(tankID, HIGHALARM, ratio);
+	}
+	else if (threshold.highRaised && ratio < threshold.high - threshold.hysteresis) {
+		threshold.highRaised = false;
+		fire(tankID, HIGHCLEAR, ratio);
+	}
+}
+
+std::vector<Alarm> AlarmIndex::take() {
+	std::vector<Alarm> alarms;
+	alarms.swap(m_queue);
+	return alarms;
+}
+
+bool AlarmIndex::raised(int tankID) const {
+	auto found = m_watched.find(tankID);
+	return found != m_watched.end() && (found->second.lowRaised || found->second.highRaised);
+}
+
+void AlarmIndex::memory(HeapBytes& heap) const {
+	heap.hash(m_watched);
+	heap.vector(m_queue);
+}
+
+void AlarmIndex::fire(int tankID, ALARM type, double ratio) {
+	Alarm alarm = Alarm{ tankID, type, ratio };
+
+	if (m_callback) {
+		m_callback(alarm);
+	}
+	else {
+		m_queue.push_back(alarm);
+	}
+}
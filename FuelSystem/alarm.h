@@ -0,0 +1,47 @@
+#ifndef ALARM_H
+#define ALARM_H
+#include "memory.h"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+enum ALARM { LOWALARM, LOWCLEAR, HIGHALARM, HIGHCLEAR };
+struct Alarm {
+    int tankID;
+    ALARM type;
+    double ratio; // fill ratio that triggered it
+};
+// AlarmIndex holds low and high fill-ratio thresholds per tank. FuelSys
+// checks it for each tank whose level changes, so evaluating alarms costs
+// one hash lookup per changed tank and nothing for the rest. A low alarm
+// raises at or below low and clears once the ratio climbs back past
+// low + hysteresis; a high alarm mirrors it. Alarms go to the callback if
+// one is set, otherwise they queue until taken.
+class AlarmIndex {
+public:
+    // watch a tank, false if the bounds are not 0 <= low < high <= 1 or hysteresis is negative or NaN
+    bool watch(int tankID, double low, double high, double hysteresis, double ratio);
+    bool unwatch(int tankID);
+    void clear();
+    bool empty() const { return m_watched.empty(); }
+    // evaluate a tank whose fill ratio changed
+    void check(int tankID, double ratio);
+    void onAlarm(std::function<void(const Alarm&)> callback) { m_callback = callback; }
+    // queued alarms, oldest first, the queue is emptied
+    std::vector<Alarm> take();
+    // true if the tank's low or high alarm is raised
+    bool raised(int tankID) const;
+    void memory(HeapBytes& heap) const;
+private:
+    struct Threshold {
+        double low;
+        double high;
+        double hysteresis;
+        bool lowRaised;
+        bool highRaised;
+    };
+    std::unordered_map<int, Threshold> m_watched;
+    std::function<void(const Alarm&)> m_callback;
+    std::vector<Alarm> m_queue;
+    void fire(int tankID, ALARM type, double ratio);
+};
+#endif
@@ -0,0 +1,260 @@
+#include "balance.h"
+#include <algorithm>
+#include <climits>
+
+// room of a pump, more than any surplus can fill
+const long long UNLIMITED = LLONG_MAX / 4;
+
+BalanceFlow::BalanceFlow(int nodes) {
+	m_nodes = nodes;
+	m_out.resize(nodes + 2);
+	m_excess.assign(nodes, 0);
+}
+
+void BalanceFlow::addPump(int from, int to, int pumpID) {
+	if (from == to || !m_pairs.insert((long long)from * m_nodes + to).second) {
+		return;
+	}
+	link(from, to, pumpID, UNLIMITED);
+}
+
+void BalanceFlow::setExcess(int node, long long amount) {
+	m_excess[node] = amount;
+}
+
+/*
+ * Function: solve
+ * ---------------
+ * transfers: Receives the plan, each tank's inflows listed before its outflows
+ *
+ * Links a source to every node with a surplus and every short node to a sink, finds a
+ * max flow with Dinic's algorithm, then cancels any flow around a loop
+ *
+ * return: True if every unit of surplus reaches a short node
+ */
+bool BalanceFlow::solve(std::vector<Transfer>& transfers) {
+	int source = m_nodes;
+	int sink = m_nodes + 1;
+	long long surplus = 0;
+
+	for (int node = 0; node < m_nodes; node++) {
+		if (m_excess[node] > 0) {
+			link(source, node, -1, m_excess[node]);
+			surplus += m_excess[node];
+		}
+		else if (m_excess[node] < 0) {
+			link(node, sink, -1, -m_excess[node]);
+		}
+	}
+
+	long long moved = 0;
+	std::vector<int> level;
+	while (moved < surplus && leveled(level)) {
+		moved += augment(level);
+	}
+	if (moved < surplus) {
+		return false;
+	}
+
+	transfers.clear();
+	for (int node : cancelLoops()) {
+		for (int e : m_out[node]) {
+			const Edge& edge = m_edges[e];
+			if (edge.pumpID >= 0 && m_edges[e ^ 1].room > 0) {
+				transfers.push_back(Transfer{ node, edge.to, edge.pumpID, m_edges[e ^ 1].room });
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Function: leveled
+ * -----------------
+ * level: Receives the breadth-first distance of each node from the source over edges
+ * with room, -1 if it cannot be reached
+ *
+ * return: True if the sink can be reached
+ */
+bool BalanceFlow::leveled(std::vector<int>& level) const {
+	level.assign(m_out.size(), -1);
+	std::vector<int> queue(1, m_nodes);
+	level[m_nodes] = 0;
+
+	for (size_t head = 0; head < queue.size(); head++) {
+		int node = queue[head];
+		for (int e : m_out[node]) {
+			const Edge& edge = m_edges[e];
+			if (edge.room > 0 && level[edge.to] < 0) {
+				level[edge.to] = level[node] + 1;
+				queue.push_back(edge.to);
+			}
+		}
+	}
+
+	return level[m_nodes + 1] >= 0;
+}
+
+/*
+ * Function: augment
+ * -----------------
+ * level: Distances from leveled
+ *
+ * Pushes a blocking flow along edges that go one level further. The path is kept on
+ * an explicit stack since a group can be too large to recurse over
+ *
+ * return: Amount moved from the source to the sink
+ */
+long long BalanceFlow::augment(const std::vector<int>& level) {
+	int source = m_nodes;
+	int sink = m_nodes + 1;
+	std::vector<size_t> next(m_out.size(), 0);
+	std::vector<char> dead(m_out.size(), 0);
+	std::vector<int> path;
+	long long moved = 0;
+	int node = source;
+
+	while (true) {
+		if (node == sink) {
+			long long amount = UNLIMITED;
+			for (int e : path) {
+				amount = std::min(amount, m_edges[e].room);
+			}
+
+			//Back up to the start of the first edge that is now full
+			size_t keep = path.size();
+			for (size_t i = 0; i < path.size(); i++) {
+				m_edges[path[i]].room -= amount;
+				m_edges[path[i] ^ 1].room += amount;
+				if (m_edges[path[i]].room == 0 && keep == path.size()) {
+					keep = i;
+				}
+			}
+			moved += amount;
+			path.resize(keep);
+			node = path.empty() ? source : m_edges[path.back()].to;
+			continue;
+		}
+
+		bool advanced = false;
+		while (next[node] < m_out[node].size()) {
+			int e = m_out[node][next[node]];
+			const Edge& edge = m_edges[e];
+			if (edge.room > 0 && level[edge.to] == level[node] + 1 && !dead[edge.to]) {
+				path.push_back(e);
+				node = edge.to;
+				advanced = true;
+				break;
+			}
+			next[node]++;
+		}
+
+		if (advanced) {
+			continue;
+		}
+		if (node == source) {
+			break;
+		}
+
+		//Nothing more gets through this node in this phase
+		dead[node] = 1;
+		path.pop_back();
+		node = path.empty() ? source : m_edges[path.back()].to;
+		next[node]++;
+	}
+
+	return moved;
+}
+
+/*
+ * Function: cancelLoops
+ * ---------------------
+ * Walks the pumps that carry fuel depth first. Reaching a node already on the stack
+ * closes a loop, so the smallest amount on it is taken off every pump of the loop and
+ * the walk backs up to the first pump left empty. Each loop empties at least one pump
+ *
+ * return: Every node, each before the nodes it sends fuel to
+ */
+std::vector<int> BalanceFlow::cancelLoops() {
+	std::vector<char> state(m_nodes, 0); // 0 unvisited, 1 on the stack, 2 done
+	std::vector<size_t> next(m_nodes, 0);
+	std::vector<int> position(m_nodes, 0);
+	std::vector<int> order;
+	std::vector<int> stack;
+	std::vector<int> entered; // pump into each node on the stack, -1 for the first
+
+	auto flowOf = [this](int e) { return m_edges[e ^ 1].room; };
+	auto cancel = [this](int e, long long amount) {
+		m_edges[e ^ 1].room -= amount;
+		m_edges[e].room += amount;
+	};
+
+	for (int root = 0; root < m_nodes; root++) {
+		if (state[root] != 0) {
+			continue;
+		}
+		state[root] = 1;
+		position[root] = 0;
+		stack.assign(1, root);
+		entered.assign(1, -1);
+
+		while (!stack.empty()) {
+			int node = stack.back();
+			if (next[node] == m_out[node].size()) {
+				state[node] = 2;
+				order.push_back(node);
+				stack.pop_back();
+				entered.pop_back();
+				continue;
+			}
+
+			int e = m_out[node][next[node]];
+			const Edge& edge = m_edges[e];
+			if (edge.pumpID < 0 || flowOf(e) == 0 || state[edge.to] == 2) {
+				next[node]++;
+				continue;
+			}
+			if (state[edge.to] == 0) {
+				state[edge.to] = 1;
+				position[edge.to] = (int)stack.size();
+				stack.push_back(edge.to);
+				entered.push_back(e);
+				continue;
+			}
+
+			size_t begin = position[edge.to];
+			long long amount = flowOf(e);
+			for (size_t i = begin + 1; i < stack.size(); i++) {
+				amount = std::min(amount, flowOf(entered[i]));
+			}
+			cancel(e, amount);
+			for (size_t i = begin + 1; i < stack.size(); i++) {
+				cancel(entered[i], amount);
+			}
+
+			size_t keep = stack.size();
+			for (size_t i = begin + 1; i < stack.size(); i++) {
+				if (flowOf(entered[i]) == 0) {
+					keep = i;
+					break;
+				}
+			}
+			for (size_t i = keep; i < stack.size(); i++) {
+				state[stack[i]] = 0;
+			}
+			stack.resize(keep);
+			entered.resize(keep);
+		}
+	}
+
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+void BalanceFlow::link(int from, int to, int pumpID, long long room) {
+	m_out[from].push_back((int)m_edges.size());
+	m_edges.push_back(Edge{ to, pumpID, room });
+	m_out[to].push_back((int)m_edges.size());
+	m_edges.push_back(Edge{ from, -1, 0 });
+}
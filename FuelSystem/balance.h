@@ -0,0 +1,44 @@
+#ifndef BALANCE_H
+#define BALANCE_H
+#include <unordered_set>
+#include <vector>
+// BalanceFlow routes fuel from tanks above their target level to tanks
+// below it over the pumps of a group. A pump carries any amount, so this is
+// a max flow from the surplus tanks to the short ones, and a plan exists
+// only if every unit of surplus arrives. Fuel sent around a loop moves
+// nothing, so such flow is cancelled: the plan uses at most one pump per
+// pair of tanks and can be listed with every tank's inflows before its
+// outflows. Nodes are 0 to nodes - 1; amounts are in the quantity's
+// smallest unit.
+class BalanceFlow {
+public:
+    struct Transfer {
+        int from;
+        int to;
+        int pumpID;
+        long long amount;
+    };
+    BalanceFlow(int nodes);
+    // a pump from one node to another, pumps parallel to an earlier one are ignored
+    void addPump(int from, int to, int pumpID);
+    // amount the node holds above its target, negative if it is short
+    void setExcess(int node, long long amount);
+    // false if some surplus cannot reach a short node, otherwise the transfers in order
+    bool solve(std::vector<Transfer>& transfers);
+private:
+    struct Edge {
+        int to;
+        int pumpID;      // -1 for the source and sink edges and every reverse edge
+        long long room;  // capacity left
+    };
+    int m_nodes;
+    std::vector<Edge> m_edges; // each edge is followed by its reverse
+    std::vector<std::vector<int>> m_out;
+    std::vector<long long> m_excess;
+    std::unordered_set<long long> m_pairs; // from * nodes + to of every pump added
+    bool leveled(std::vector<int>& level) const;
+    long long augment(const std::vector<int>& level);
+    std::vector<int> cancelLoops();
+    void link(int from, int to, int pumpID, long long room);
+};
+#endif
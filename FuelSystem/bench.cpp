@@ -0,0 +1,482 @@
+#include "fuel.h"
+#include "compact.h"
+#include "staticfuel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+//Every allocation made by the process is counted so each benchmark can report allocations per operation
+static std::atomic<long long> g_allocations(0);
+//Results of read-only benchmarks are stored here so the calls are not optimized away
+static volatile long long g_sink = 0;
+//Largest system the memory benchmark builds, it adds tanks one call at a time
+const int MEMORYSIZE = 10000;
+const int MEMORYDEGREE = 4;
+typedef StaticFuelSys<MEMORYSIZE, MEMORYSIZE * MEMORYDEGREE> MemoryFuelSys;
+
+//Bytes malloc has handed out and not taken back, 0 where it cannot tell
+static long long heapInUse() {
+#ifdef __GLIBC__
+	return (long long)mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+void* operator new(size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+enum DISTRIBUTION { UNIFORM, SKEWED };
+
+class Bench {
+public:
+    Bench(int maxSize, const string& filter) : m_maxSize(maxSize), m_filter(filter), m_generator(10) {}
+
+    /*
+     * Function: build
+     * ---------------
+     * sys: Empty fuel system
+     * numTanks: Tanks to create with IDs 0 to numTanks - 1
+     * degree: Pumps per tank, each to a random other tank
+     *
+     * Links the nodes directly. Building through addTank walks the list twice per
+     * tank, which makes a million-tank system take hours to set up. Pumps are added
+     * once every tank exists since they point at their target's index
+     */
+    void build(FuelSys& sys, int numTanks, int degree) {
+        std::uniform_int_distribution<int> pickTank(0, numTanks - 1);
+        Tank* last = nullptr;
+
+        for (int tankID = 0; tankID < numTanks; tankID++) {
+            Tank* tank = sys.newTank(tankID, DEFCAP);
+            sys.setFuel(tank, DEFCAP / 2, FILLCHANGE);
+
+            if (last == nullptr) {
+                sys.m_current = tank;
+            }
+            else {
+                last->m_next = tank;
+            }
+            last = tank;
+        }
+
+        for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+            int tankID = tank->m_tankID;
+            Pump* lastPump = nullptr;
+
+            for (int pumpID = 0; pumpID < degree && numTanks > 1; pumpID++) {
+                int target = pickTank(m_generator);
+                while (target == tankID) {
+                    target = pickTank(m_generator);
+                }
+
+                Pump* pump = sys.newPump(tankID, pumpID, target);
+                if (lastPump == nullptr) {
+                    tank->m_pumps = pump;
+                }
+                else {
+                    lastPump->m_next = pump;
+                }
+                lastPump = pump;
+            }
+        }
+    }
+
+    /*
+     * Function: keys
+     * --------------
+     * Draws tank IDs in [0, numTanks). Skewed keys are u^4 * numTanks so a few
+     * tanks receive most of the accesses
+     */
+    std::vector<int> keys(int numTanks, DISTRIBUTION dist, int count) {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<int> result(count);
+
+        for (int& key : result) {
+            double u = unit(m_generator);
+            if (dist == SKEWED) {
+                u = u * u * u * u;
+            }
+            key = (int)(u * numTanks);
+            if (key >= numTanks) {
+                key = numTanks - 1;
+            }
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: selected
+     * ------------------
+     * name: Benchmark name, including its parameters
+     * size: Number of tanks in the system
+     *
+     * Checked before the system is built, so a benchmark left out costs nothing. Sizes past
+     * the first one that exceeds the time budget per operation are skipped
+     *
+     * return: True if the benchmark matches the filter and is still within the budget
+     */
+    bool selected(const string& name, int size) {
+        if (m_filter.size() != 0 && name.find(m_filter) == string::npos) {
+            return false;
+        }
+        if (m_tooSlow.count(name) != 0) {
+            cout << name << "/" << size << " skipped, smaller size exceeded the budget\n";
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Function: measure
+     * -----------------
+     * name: Benchmark name, including its parameters
+     * size: Number of tanks in the system
+     * op: Runs the operation once, given the iteration number
+     *
+     * Repeats the operation until it has run for the minimum time
+     */
+    void measure(const string& name, int size, const std::function<void(int)>& op) {
+        const double minTime = 0.1;
+        const double budget = 2.0;
+        long long iterations = 0;
+        long long allocations = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        m_pausedTime = 0.0;
+        m_pausedAllocations = 0;
+
+        while (elapsed < minTime && iterations < 10000000) {
+            op((int)iterations);
+            iterations++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                - m_pausedTime;
+        }
+
+        allocations = g_allocations.load() - allocations - m_pausedAllocations;
+        double nsPerOp = elapsed * 1e9 / iterations;
+
+        cout << name << "/" << size << "  iterations: " << iterations
+            << "  ns/op: " << nsPerOp
+            << "  allocs/op: " << (double)allocations / iterations;
+
+        //Slope of the log-log scaling curve against the previous size
+        auto previous = m_last.find(name);
+        if (previous != m_last.end()) {
+            double slope = std::log(nsPerOp / previous->second.second)
+                / std::log((double)size / previous->second.first);
+            cout << "  scaling: n^" << slope;
+        }
+        cout << "\n";
+
+        m_last[name] = { size, nsPerOp };
+        if (elapsed / iterations > budget) {
+            m_tooSlow[name] = true;
+        }
+    }
+
+    // exclude setup work done inside an operation from the measurement
+    void pause() {
+        m_pauseStart = std::chrono::steady_clock::now();
+        m_pauseAllocations = g_allocations.load();
+    }
+
+    void resume() {
+        m_pausedTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_pauseStart).count();
+        m_pausedAllocations += g_allocations.load() - m_pauseAllocations;
+    }
+
+    void benchAddTank(int size) {
+        string name = "addTank";
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, 1);
+        measure(name, size, [&](int i) {
+            sys.addTank(size + i, DEFCAP);
+        });
+    }
+
+    void benchFindTank(int size, DISTRIBUTION dist) {
+        string name = string("findTank/") + distName(dist);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, 1);
+        std::vector<int> ids = keys(size, dist, 4096);
+        measure(name, size, [&](int i) {
+            g_sink = g_sink + sys.findTank(ids[i & 4095]);
+        });
+    }
+
+    void benchFill(int size, DISTRIBUTION dist) {
+        string name = string("fill/") + distName(dist);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, 1);
+        std::vector<int> ids = keys(size, dist, 4096);
+        measure(name, size, [&](int i) {
+            sys.fill(ids[i & 4095], 1);
+        });
+    }
+
+    void benchDrain(int size, DISTRIBUTION dist, int degree) {
+        string name = string("drain/") + distName(dist) + "/degree:" + std::to_string(degree);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, degree);
+        std::vector<int> ids = keys(size, dist, 4096);
+        measure(name, size, [&](int i) {
+            sys.drain(ids[i & 4095], i % degree, 1);
+        });
+    }
+
+    void benchRemoveTank(int size, int degree) {
+        string name = "removeTank/degree:" + std::to_string(degree);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, degree);
+        std::vector<int> ids(size);
+        for (int tankID = 0; tankID < size; tankID++) {
+            ids[tankID] = tankID;
+        }
+        std::shuffle(ids.begin(), ids.end(), m_generator);
+        //Rebuilds the system once every tank has been removed so the loop can keep going
+        measure(name, size, [&](int i) {
+            if (i % size == 0 && i != 0) {
+                pause();
+                build(sys, size, degree);
+                resume();
+            }
+            sys.removeTank(ids[i % size]);
+        });
+    }
+
+    //Each operation removes every other tank in one call, from a freshly built system
+    void benchRemoveTanks(int size, int degree) {
+        string name = "removeTanks/half/degree:" + std::to_string(degree);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        std::vector<int> ids[2];
+        for (int tankID = 0; tankID < size; tankID++) {
+            ids[tankID % 2].push_back(tankID);
+        }
+        measure(name, size, [&](int) {
+            pause();
+            build(sys, size, degree);
+            resume();
+            sys.removeTanks(ids[0]);
+            pause();
+            sys.removeTanks(ids[1]);
+            resume();
+        });
+    }
+
+    //Rebalances the largest group of tanks that pump into each other, alternating weights
+    //of 1 and 2 so every other tank swaps between a large and a small share each time
+    void benchRebalance(int size, int degree) {
+        string name = "rebalance/degree:" + std::to_string(degree);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, degree);
+        std::vector<int> group;
+        for (const std::vector<int>& cycle : sys.pumpCycles()) {
+            if (cycle.size() > group.size()) {
+                group = cycle;
+            }
+        }
+        std::vector<double> weights[2];
+        for (size_t i = 0; i < group.size(); i++) {
+            weights[0].push_back(1.0 + i % 2);
+            weights[1].push_back(2.0 - i % 2);
+        }
+        measure(name, size, [&](int i) {
+            g_sink = g_sink + sys.rebalance(group, weights[i % 2]);
+        });
+    }
+
+    void benchAssign(int size, int degree) {
+        string name = "operator=/degree:" + std::to_string(degree);
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys source;
+        FuelSys destination;
+        build(source, size, degree);
+        measure(name, size, [&](int) {
+            destination = source;
+        });
+    }
+
+    void benchTotalFuel(int size) {
+        string name = "totalFuel";
+        if (!selected(name, size)) {
+            return;
+        }
+        FuelSys sys;
+        build(sys, size, 1);
+        measure(name, size, [&](int) {
+            g_sink = g_sink + sys.totalFuel();
+        });
+    }
+
+    /*
+     * Function: benchMemory
+     * ---------------------
+     * name: Storage mode
+     * sys: Empty system of that mode
+     * size: Tanks to add, each then gets MEMORYDEGREE pumps
+     *
+     * Reports the bytes memoryUsage accounts per tank and per pump, the heap growth
+     * malloc reports for comparison, and the breakdown of the full system. Bytes per tank
+     * include the object itself, so storage reserved up front shows there
+     */
+    template <class S>
+    void benchMemory(const string& name, S& sys, int size) {
+        if (m_filter.size() != 0 && ("memory/" + name).find(m_filter) == string::npos) {
+            return;
+        }
+
+        std::uniform_int_distribution<int> pickTank(0, size - 1);
+        long long heap = heapInUse();
+
+        for (int tankID = 0; tankID < size; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+        MemoryUsage tanks = sys.memoryUsage();
+        long long tankHeap = heapInUse();
+
+        for (int tankID = 0; tankID < size && size > 1; tankID++) {
+            for (int pumpID = 0; pumpID < MEMORYDEGREE; pumpID++) {
+                int target = pickTank(m_generator);
+                while (target == tankID) {
+                    target = pickTank(m_generator);
+                }
+                sys.addPump(tankID, pumpID, target);
+            }
+        }
+        MemoryUsage full = sys.memoryUsage();
+        long long pumps = (long long)size * MEMORYDEGREE;
+
+        cout << "memory/" << name << "/" << size
+            << "  bytes/tank: " << (double)tanks.total() / size
+            << "  bytes/pump: " << (double)(full.total() - tanks.total()) / pumps
+            << "  heap bytes/tank: " << (double)(tankHeap - heap) / size
+            << "  heap bytes/pump: " << (double)(heapInUse() - tankHeap) / pumps << "\n";
+        cout << "  system: " << full.system << "  tanks: " << full.tanks << "  pumps: " << full.pumps
+            << "  levels: " << full.levels << "  reach: " << full.reach << "  alarms: " << full.alarms << "  ids: " << full.ids
+            << "  slack: " << full.slack << "  total: " << full.total() << "\n";
+    }
+
+    void runMemory(int size) {
+        FuelSys sys;
+        FuelSys64 sys64;
+        FuelSysGrams sysGrams;
+        CompactFuelSys compact;
+        std::unique_ptr<MemoryFuelSys> fixed(new MemoryFuelSys());
+
+        benchMemory("FuelSys", sys, size);
+        benchMemory("FuelSys64", sys64, size);
+        benchMemory("FuelSysGrams", sysGrams, size);
+        benchMemory("CompactFuelSys", compact, size);
+        benchMemory("StaticFuelSys", *fixed, size);
+    }
+
+    void runAll() {
+        for (int size = 10; size <= m_maxSize; size *= 10) {
+            benchAddTank(size);
+            benchFindTank(size, UNIFORM);
+            benchFindTank(size, SKEWED);
+            benchFill(size, UNIFORM);
+            benchFill(size, SKEWED);
+            for (int degree : { 1, 4, 16 }) {
+                benchDrain(size, UNIFORM, degree);
+                benchDrain(size, SKEWED, degree);
+                benchRemoveTank(size, degree);
+                benchRemoveTanks(size, degree);
+                benchRebalance(size, degree);
+                benchAssign(size, degree);
+            }
+            benchTotalFuel(size);
+            if (size <= MEMORYSIZE) {
+                runMemory(size);
+            }
+        }
+    }
+
+private:
+    int m_maxSize;
+    string m_filter;
+    std::mt19937 m_generator;
+    std::map<string, std::pair<int, double>> m_last; // previous size and ns/op of each benchmark
+    std::map<string, bool> m_tooSlow;
+    std::chrono::steady_clock::time_point m_pauseStart;
+    long long m_pauseAllocations = 0;
+    double m_pausedTime = 0.0;
+    long long m_pausedAllocations = 0;
+
+    static const char* distName(DISTRIBUTION dist) {
+        return dist == UNIFORM ? "uniform" : "skewed";
+    }
+};
+
+/*
+ * Usage: bench [maxSize] [filter]
+ * maxSize: Largest number of tanks, sizes go up by 10x from 10 (default 1000000)
+ * filter: Only run benchmarks whose name contains this text
+ */
+int main(int argc, char** argv) {
+    int maxSize = 1000000;
+    string filter;
+
+    if (argc > 1) {
+        maxSize = std::atoi(argv[1]);
+    }
+    if (argc > 2) {
+        filter = argv[2];
+    }
+
+    Bench bench(maxSize, filter);
+    bench.runAll();
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "changes.h"
+#include <algorithm>
+
+template <class Q>
+ChangeFeed<Q>::Subscription::Subscription(int capacity) : m_head(0), m_tail(0), m_flushed(0), m_waiting(0), m_coalesced(0) {
+	size_t size = 2;
+	while ((int)size < capacity) {
+		size *= 2;
+	}
+
+	m_ring.resize(size);
+	m_mask = size - 1;
+}
+
+/*
+ * Function: push
+ * --------------
+ * return: True if the delta fit in the ring
+ */
+template <class Q>
+bool ChangeFeed<Q>::Subscription::push(const LevelDelta<Q>& delta) {
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+		return false;
+	}
+
+	m_ring[tail & m_mask] = delta;
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+/*
+ * Function: pop
+ * -------------
+ * Drops the oldest overflow entry, the caller holds m_lock. Pending entries are kept by
+ * position since the first overflow, so the ones left need no renumbering
+ */
+template <class Q>
+void ChangeFeed<Q>::Subscription::pop() {
+	m_pending.erase(m_overflow.front().tankID);
+	m_overflow.pop_front();
+	m_flushed++;
+	m_waiting.store(m_overflow.size(), std::memory_order_release);
+}
+
+/*
+ * Function: flush
+ * ---------------
+ * Moves coalesced deltas into the ring in the order their tanks first overflowed
+ */
+template <class Q>
+void ChangeFeed<Q>::Subscription::flush() {
+	if (m_waiting.load(std::memory_order_acquire) == 0) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	while (!m_overflow.empty() && push(m_overflow.front())) {
+		pop();
+	}
+}
+
+/*
+ * Function: record
+ * ----------------
+ * Once anything is waiting in the overflow, new deltas go there too so the reader
+ * never sees a tank's changes out of order
+ */
+template <class Q>
+void ChangeFeed<Q>::Subscription::record(const LevelDelta<Q>& delta) {
+	if (m_waiting.load(std::memory_order_acquire) == 0 && push(delta)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	while (!m_overflow.empty() && push(m_overflow.front())) {
+		pop();
+	}
+	if (m_overflow.empty() && push(delta)) {
+		return;
+	}
+
+	auto found = m_pending.find(delta.tankID);
+	if (found == m_pending.end()) {
+		m_pending[delta.tankID] = m_flushed + m_overflow.size();
+		m_overflow.push_back(delta);
+		m_waiting.store(m_overflow.size(), std::memory_order_release);
+		return;
+	}
+
+	LevelDelta<Q>& merged = m_overflow[found->second - m_flushed];
+	merged.newLevel = delta.newLevel;
+	merged.cause = delta.cause;
+	m_coalesced.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Function: take
+ * --------------
+ * return: Number of deltas moved from the ring into out, at most max
+ */
+template <class Q>
+int ChangeFeed<Q>::Subscription::take(std::vector<LevelDelta<Q>>& out, int max) {
+	size_t head = m_head.load(std::memory_order_relaxed);
+	size_t tail = m_tail.load(std::memory_order_acquire);
+	size_t count = std::min(tail - head, (size_t)std::max(max, 0));
+
+	for (size_t i = 0; i < count; i++) {
+		out.push_back(m_ring[(head + i) & m_mask]);
+	}
+	m_head.store(head + count, std::memory_order_release);
+
+	return (int)count;
+}
+
+/*
+ * Function: poll
+ * --------------
+ * out: Deltas are appended here, oldest first
+ * max: Most deltas to take
+ *
+ * Only the subscriber's thread may call this. Once the ring is empty, deltas still
+ * waiting in the overflow are taken from there, so they arrive without the producer
+ * recording or flushing again
+ *
+ * return: Number of deltas taken
+ */
+template <class Q>
+int ChangeFeed<Q>::Subscription::poll(std::vector<LevelDelta<Q>>& out, int max) {
+	int taken = take(out, max);
+	if (taken >= max || m_waiting.load(std::memory_order_acquire) == 0) {
+		return taken;
+	}
+
+	//While anything waits, the producer reaches the ring only under the lock, so
+	//whatever it moved there before the lock is older and comes first
+	std::lock_guard<std::mutex> lock(m_lock);
+	taken += take(out, max - taken);
+	while (taken < max && !m_overflow.empty()) {
+		out.push_back(m_overflow.front());
+		pop();
+		taken++;
+	}
+
+	return taken;
+}
+
+template <class Q>
+typename ChangeFeed<Q>::Subscription* ChangeFeed<Q>::subscribe(int capacity) {
+	m_subscriptions.push_back(std::unique_ptr<Subscription>(new Subscription(capacity)));
+	return m_subscriptions.back().get();
+}
+
+template <class Q>
+void ChangeFeed<Q>::unsubscribe(Subscription* subscription) {
+	for (size_t i = 0; i < m_subscriptions.size(); i++) {
+		if (m_subscriptions[i].get() == subscription) {
+			m_subscriptions.erase(m_subscriptions.begin() + i);
+			return;
+		}
+	}
+}
+
+template <class Q>
+void ChangeFeed<Q>::record(int tankID, Q oldLevel, Q newLevel, CHANGE cause) {
+	LevelDelta<Q> delta = LevelDelta<Q>{ tankID, oldLevel, newLevel, cause };
+
+	for (std::unique_ptr<Subscription>& subscription : m_subscriptions) {
+		subscription->record(delta);
+	}
+}
+
+template <class Q>
+void ChangeFeed<Q>::flush() {
+	for (std::unique_ptr<Subscription>& subscription : m_subscriptions) {
+		subscription->flush();
+	}
+}
+
+template class ChangeFeed<int>;
+template class ChangeFeed<long long>;
+template class ChangeFeed<Grams>;
@@ -0,0 +1,72 @@
+#ifndef CHANGES_H
+#define CHANGES_H
+#include "quantity.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+// why a tank's level changed; a removed tank reports a new level of 0
+enum CHANGE { FILLCHANGE, DRAINCHANGE, REMOVECHANGE };
+template <class Q>
+struct LevelDelta {
+    int tankID;
+    Q oldLevel;
+    Q newLevel;
+    CHANGE cause;
+};
+// ChangeFeed streams every change of a tank's level to its subscribers.
+// FuelSys calls record on its own thread; each subscriber reads its own
+// bounded single-producer single-consumer ring at its own pace. When a
+// subscriber falls behind and its ring is full, further deltas are
+// coalesced per tank in an overflow (first old level, latest new level
+// and cause), so the backlog never grows past one entry per tank. The
+// producer moves them into the ring on its next record or flush, and a
+// poll that empties the ring takes the rest itself, so a reader sees every
+// tank's latest level even once FuelSys stops changing. The overflow is
+// behind a lock; recording into a ring with room and nothing waiting takes
+// no lock.
+template <class Q>
+class ChangeFeed {
+public:
+    class Subscription {
+    public:
+        // move up to max deltas into out, return how many
+        int poll(std::vector<LevelDelta<Q>>& out, int max = 1 << 30);
+        // deltas merged into an earlier one because the ring was full
+        long long coalesced() const { return m_coalesced.load(std::memory_order_relaxed); }
+        // deltas waiting in the overflow
+        int waiting() const { return (int)m_waiting.load(std::memory_order_acquire); }
+    private:
+        friend class ChangeFeed;
+        Subscription(int capacity);
+        bool push(const LevelDelta<Q>& delta);
+        void flush();
+        void record(const LevelDelta<Q>& delta);
+        std::vector<LevelDelta<Q>> m_ring;
+        size_t m_mask;
+        alignas(64) std::atomic<size_t> m_head; // next delta the reader takes
+        alignas(64) std::atomic<size_t> m_tail; // next slot the producer writes
+        // overflow, guarded by m_lock
+        std::mutex m_lock;
+        std::unordered_map<int, size_t> m_pending; // tank ID to position of its entry, m_flushed + index in m_overflow
+        std::deque<LevelDelta<Q>> m_overflow;
+        size_t m_flushed; // entries ever taken out of m_overflow
+        std::atomic<size_t> m_waiting; // m_overflow.size(), only the producer raises it from 0
+        std::atomic<long long> m_coalesced;
+        int take(std::vector<LevelDelta<Q>>& out, int max);
+        void pop();
+    };
+    // subscribe and unsubscribe on the producer thread; capacity is rounded up to a power of two
+    Subscription* subscribe(int capacity = 1024);
+    void unsubscribe(Subscription* subscription);
+    // called by FuelSys for every change of a level
+    void record(int tankID, Q oldLevel, Q newLevel, CHANGE cause);
+    // move coalesced deltas into rings that have room again; polls take them anyway
+    void flush();
+    int subscribers() const { return (int)m_subscriptions.size(); }
+private:
+    std::vector<std::unique_ptr<Subscription>> m_subscriptions;
+};
+#endif
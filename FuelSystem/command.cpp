@@ -0,0 +1,270 @@
+#include "command.h"
+#include "trace.h"
+
+// times a thread with nothing to do yields before it sleeps
+const int SPINS = 64;
+
+CommandQueue::CommandQueue(FuelSys& sys, int capacity) : m_sys(sys), m_tail(0), m_applied(0), m_running(false),
+	m_idle(false), m_posts(0), m_full(0), m_frees(0), m_trace(nullptr) {
+	size_t size = 2;
+	while ((int)size < capacity) {
+		size *= 2;
+	}
+
+	m_slots.reset(new Slot[size]);
+	for (size_t i = 0; i < size; i++) {
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	m_mask = size - 1;
+	m_head = 0;
+}
+
+CommandQueue::~CommandQueue() {
+	stop();
+}
+
+/*
+ * Function: tryPost
+ * -----------------
+ * command: Call to make on the system
+ * done: Called on the owner thread with the result, may be empty
+ *
+ * A slot is free for position pos when its sequence equals pos. The producer claims the
+ * position by advancing the tail, fills the slot and sets the sequence to pos + 1 to hand
+ * it to the owner
+ *
+ * return: True if the command was queued, false if the ring is full
+ */
+bool CommandQueue::tryPost(const Command& command, Callback done) {
+	Task none;
+	return tryPost(command, done, none);
+}
+
+/*
+ * Function: tryPost
+ * -----------------
+ * Moves the callback and task into the slot only once a slot is claimed, so a caller
+ * that finds the ring full can retry with them. Wakes the owner if it went to sleep
+ * before the slot was published
+ */
+bool CommandQueue::tryPost(const Command& command, Callback& done, Task& task) {
+	size_t pos = m_tail.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+
+	while (true) {
+		slot = &m_slots[pos & m_mask];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		long long diff = (long long)sequence - (long long)pos;
+
+		if (diff == 0) {
+			if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			return false;
+		}
+		else {
+			pos = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->command = command;
+	slot->done = std::move(done);
+	slot->task = std::move(task);
+	slot->sequence.store(pos + 1, std::memory_order_release);
+
+	//Pairs with the fence in sleep: either the owner sees this slot or this sees it idle
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_idle.load()) {
+		m_posts.fetch_add(1);
+		m_posts.notify_one();
+	}
+	return true;
+}
+
+void CommandQueue::post(const Command& command, Callback done) {
+	Task none;
+	post(command, done, none);
+}
+
+/*
+ * Function: post
+ * --------------
+ * Retries a full ring for a while, then sleeps until the owner frees a slot
+ */
+void CommandQueue::post(const Command& command, Callback& done, Task& task) {
+	for (int tries = 1; !tryPost(command, done, task); tries++) {
+		if (tries < SPINS) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		unsigned frees = m_frees.load();
+		m_full.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		bool posted = tryPost(command, done, task);
+		if (!posted) {
+			m_frees.wait(frees);
+		}
+		m_full.fetch_sub(1);
+		if (posted) {
+			return;
+		}
+	}
+}
+
+/*
+ * Function: submit
+ * ----------------
+ * return: Future that becomes ready once the owner has applied the command
+ */
+std::future<bool> CommandQueue::submit(const Command& command) {
+	std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+	std::future<bool> result = promise->get_future();
+
+	post(command, [promise](bool done) {
+		promise->set_value(done);
+	});
+
+	return result;
+}
+
+void CommandQueue::execute(Task task) {
+	Command command = Command{ RUNTASK, 0, 0, 0, 0 };
+	Callback none;
+	post(command, none, task);
+}
+
+/*
+ * Function: process
+ * -----------------
+ * maxBatch: Most commands to take off the ring
+ *
+ * Takes a batch of ready commands off the ring and frees their slots before applying
+ * them, so producers can refill the ring while the batch runs. Callbacks run after the
+ * whole batch has been applied
+ *
+ * return: Number of commands applied
+ */
+int CommandQueue::process(int maxBatch) {
+	m_batch.clear();
+	m_callbacks.clear();
+	m_tasks.clear();
+
+	while ((int)m_batch.size() < maxBatch) {
+		Slot& slot = m_slots[m_head & m_mask];
+		if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+			break;
+		}
+
+		m_batch.push_back(slot.command);
+		m_callbacks.push_back(std::move(slot.done));
+		m_tasks.push_back(std::move(slot.task));
+		slot.done = nullptr;
+		slot.task = nullptr;
+		slot.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+		m_head++;
+	}
+
+	//Pairs with the fence in post: either a waiting producer sees the free slots or this sees it waiting
+	if (!m_batch.empty()) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_full.load() > 0) {
+			m_frees.fetch_add(1);
+			m_frees.notify_all();
+		}
+	}
+
+	m_results.resize(m_batch.size());
+	for (size_t i = 0; i < m_batch.size(); i++) {
+		m_results[i] = apply(m_batch[i], m_tasks[i]);
+		if (m_trace != nullptr) {
+			m_trace->record(m_batch[i], m_results[i]);
+		}
+	}
+	m_applied.fetch_add((long long)m_batch.size(), std::memory_order_relaxed);
+
+	for (size_t i = 0; i < m_callbacks.size(); i++) {
+		if (m_callbacks[i]) {
+			m_callbacks[i](m_results[i]);
+		}
+	}
+
+	return (int)m_batch.size();
+}
+
+/*
+ * Function: start
+ * ---------------
+ * Starts the owner thread. From then on only it may touch the system. The thread yields
+ * between empty batches for a while, then sleeps until a command is posted or stop
+ */
+void CommandQueue::start(int maxBatch) {
+	if (m_running.exchange(true)) {
+		return;
+	}
+
+	m_owner = std::thread([this, maxBatch]() {
+		int empty = 0;
+		while (m_running.load(std::memory_order_acquire)) {
+			if (process(maxBatch) > 0) {
+				empty = 0;
+			}
+			else if (++empty < SPINS) {
+				std::this_thread::yield();
+			}
+			else {
+				sleep();
+				empty = 0;
+			}
+		}
+		while (process(maxBatch) > 0) {
+		}
+	});
+}
+
+void CommandQueue::stop() {
+	if (!m_running.exchange(false)) {
+		return;
+	}
+
+	m_posts.fetch_add(1);
+	m_posts.notify_one();
+	m_owner.join();
+}
+
+//True if the next slot the owner takes has been published
+bool CommandQueue::ready() const {
+	return m_slots[m_head & m_mask].sequence.load(std::memory_order_acquire) == m_head + 1;
+}
+
+/*
+ * Function: sleep
+ * ---------------
+ * Marks the owner idle, then checks the ring and the running flag once more before
+ * waiting, so a post or stop that came in between is never missed
+ */
+void CommandQueue::sleep() {
+	unsigned posts = m_posts.load();
+	m_idle.store(true);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!ready() && m_running.load()) {
+		m_posts.wait(posts);
+	}
+	m_idle.store(false, std::memory_order_relaxed);
+}
+
+/*
+ * Function: apply
+ * ---------------
+ * return: What the matching FuelSys call returned, true for a task
+ */
+bool CommandQueue::apply(const Command& command, Task& task) {
+	if (command.type == RUNTASK) {
+		task(m_sys);
+		return true;
+	}
+
+	return applyCommand(m_sys, command);
+}
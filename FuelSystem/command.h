@@ -0,0 +1,107 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+#include "fuel.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+enum COMMAND { ADDTANK, REMOVETANK, ADDPUMP, REMOVEPUMP, FILLTANK, DRAINTANK, RUNTASK };
+// one call on the system: amount is the capacity for ADDTANK and the fuel
+// for FILLTANK and DRAINTANK, target is the target tank for ADDPUMP.
+// RUNTASK commands are posted through execute and carry a function instead
+struct Command {
+    COMMAND type;
+    int tankID;
+    int pumpID;
+    int target;
+    int amount;
+};
+class Trace;
+// make the call a command describes on any system with the FuelSys interface
+template <class S>
+bool applyCommand(S& sys, const Command& command) {
+    switch (command.type) {
+    case ADDTANK:
+        return sys.addTank(command.tankID, command.amount);
+    case REMOVETANK:
+        return sys.removeTank(command.tankID);
+    case ADDPUMP:
+        return sys.addPump(command.tankID, command.pumpID, command.target);
+    case REMOVEPUMP:
+        return sys.removePump(command.tankID, command.pumpID);
+    case FILLTANK:
+        return sys.fill(command.tankID, command.amount);
+    case DRAINTANK:
+        return sys.drain(command.tankID, command.pumpID, command.amount);
+    default:
+        return false;
+    }
+}
+// CommandQueue lets many threads change one FuelSys without locks in
+// fuel.cpp. Producers post commands into a bounded ring; only the owner
+// thread touches the system, taking commands off the ring in batches and
+// reporting each result through a callback or a future. Each ring slot
+// carries a sequence number (Vyukov's bounded queue): a producer claims a
+// position with one compare-and-swap and publishes the slot by bumping its
+// sequence, so producers never wait for each other or for the owner unless
+// the ring is full. An idle owner, or a producer facing a full ring, spins
+// for a while and then sleeps on an atomic wait until the other side wakes
+// it, so quiet queues and shards cost no CPU.
+class CommandQueue {
+public:
+    typedef std::function<void(bool)> Callback;
+    typedef std::function<void(FuelSys&)> Task;
+    // capacity is rounded up to a power of two
+    CommandQueue(FuelSys& sys, int capacity = 1024);
+    ~CommandQueue();
+    // add a command, false if the ring is full
+    bool tryPost(const Command& command, Callback done = nullptr);
+    // add a command, waiting for space if the ring is full
+    void post(const Command& command, Callback done = nullptr);
+    // add a command and get its result as a future
+    std::future<bool> submit(const Command& command);
+    // run a function on the system on the owner thread, waiting for space if the ring is full
+    void execute(Task task);
+    // apply up to maxBatch commands on the calling thread, return how many ran
+    int process(int maxBatch = 256);
+    // run process on a dedicated owner thread until stop
+    void start(int maxBatch = 256);
+    // apply what is left and join the owner thread
+    void stop();
+    // commands applied so far
+    long long applied() const { return m_applied.load(std::memory_order_relaxed); }
+    // record every command with its result in the order the owner applies it, nullptr to stop
+    void setTrace(Trace* trace) { m_trace = trace; }
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence;
+        Command command;
+        Callback done;
+        Task task;
+    };
+    FuelSys& m_sys;
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_tail; // next position producers claim
+    alignas(64) size_t m_head;              // next position the owner takes
+    std::atomic<long long> m_applied;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_idle;      // the owner is going to sleep, producers must wake it
+    std::atomic<unsigned> m_posts; // bumped to wake the owner
+    std::atomic<int> m_full;       // producers asleep until a slot frees
+    std::atomic<unsigned> m_frees; // bumped to wake them
+    std::thread m_owner;
+    Trace* m_trace; // owner thread only
+    std::vector<Command> m_batch;
+    std::vector<Callback> m_callbacks;
+    std::vector<Task> m_tasks;
+    std::vector<char> m_results;
+    bool tryPost(const Command& command, Callback& done, Task& task);
+    void post(const Command& command, Callback& done, Task& task);
+    bool ready() const;
+    void sleep();
+    bool apply(const Command& command, Task& task);
+};
+#endif
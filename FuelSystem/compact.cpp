@@ -0,0 +1,418 @@
+#include "compact.h"
+
+CompactFuelSys::CompactFuelSys() {
+	m_current = NONE;
+	m_freeTanks = NONE;
+	m_freePumps = NONE;
+	m_liveTanks = 0;
+	m_livePumps = 0;
+}
+
+void CompactFuelSys::reserve(int numTanks, int numPumps) {
+	m_tanks.reserve(numTanks);
+	m_pumps.reserve(numPumps);
+}
+
+/*
+ * Function: newTank
+ * -----------------
+ * return: Index of a tank node taken from the free list, or appended to the pool
+ */
+uint32_t CompactFuelSys::newTank(int tankID, int capacity) {
+	uint32_t tank = m_freeTanks;
+
+	if (tank == NONE) {
+		tank = (uint32_t)m_tanks.size();
+		m_tanks.push_back(TankNode());
+	}
+	else {
+		m_freeTanks = m_tanks[tank].m_next;
+	}
+
+	m_tanks[tank] = TankNode{ tankID, capacity, 0, NONE, NONE };
+	m_liveTanks++;
+	return tank;
+}
+
+/*
+ * Function: newPump
+ * -----------------
+ * return: Index of a pump node taken from the free list, or appended to the pool
+ */
+uint32_t CompactFuelSys::newPump(int pumpID, int target) {
+	uint32_t pump = m_freePumps;
+
+	if (pump == NONE) {
+		pump = (uint32_t)m_pumps.size();
+		m_pumps.push_back(PumpNode());
+	}
+	else {
+		m_freePumps = m_pumps[pump].m_next;
+	}
+
+	m_pumps[pump] = PumpNode{ pumpID, target, NONE };
+	m_livePumps++;
+	return pump;
+}
+
+void CompactFuelSys::freeTank(uint32_t tank) {
+	m_tanks[tank].m_next = m_freeTanks;
+	m_freeTanks = tank;
+	m_liveTanks--;
+}
+
+void CompactFuelSys::freePump(uint32_t pump) {
+	m_pumps[pump].m_next = m_freePumps;
+	m_freePumps = pump;
+	m_livePumps--;
+}
+
+/*
+ * Function: addTank
+ * -----------------
+ * tankID: Unique ID to assign new tank
+ * capacity: How much fuel the tank can hold
+ *
+ * return: True if a tank was successfully created else false
+ */
+bool CompactFuelSys::addTank(int tankID, int capacity) {
+	if (tankID < 0 || capacity < MINCAP) {
+		return false;
+	}
+
+	if (m_current == NONE) {
+		m_current = newTank(tankID, capacity);
+		return true;
+	}
+
+	if (!findTank(tankID)) {
+		uint32_t endTank = m_current;
+		while (m_tanks[endTank].m_next != NONE) {
+			endTank = m_tanks[endTank].m_next;
+		}
+
+		uint32_t tank = newTank(tankID, capacity);
+		m_tanks[endTank].m_next = tank;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Function: removeTank
+ * --------------------
+ * tankID: ID of the tank to remove
+ *
+ * Removes the tank, its pumps and every pump of other tanks that targets it
+ *
+ * return: True if the tank is removed from the list, else false
+ */
+bool CompactFuelSys::removeTank(int tankID) {
+	uint32_t currentTank = m_current;
+	uint32_t previousTank = NONE;
+
+	while (currentTank != NONE && m_tanks[currentTank].m_tankID != tankID) {
+		previousTank = currentTank;
+		currentTank = m_tanks[currentTank].m_next;
+	}
+
+	if (currentTank == NONE) {
+		return false;
+	}
+
+	if (previousTank == NONE) {
+		m_current = m_tanks[currentTank].m_next;
+	}
+	else {
+		m_tanks[previousTank].m_next = m_tanks[currentTank].m_next;
+	}
+
+	uint32_t pump = m_tanks[currentTank].m_pumps;
+	while (pump != NONE) {
+		uint32_t nextPump = m_pumps[pump].m_next;
+		freePump(pump);
+		pump = nextPump;
+	}
+	freeTank(currentTank);
+
+	//Delete pumps from other tanks that target this tank
+	for (uint32_t tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+		uint32_t* link = &m_tanks[tank].m_pumps;
+
+		while (*link != NONE) {
+			uint32_t linkPump = *link;
+			if (m_pumps[linkPump].m_target == tankID) {
+				*link = m_pumps[linkPump].m_next;
+				freePump(linkPump);
+			}
+			else {
+				link = &m_pumps[linkPump].m_next;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Function: addPump
+ * -----------------
+ * tankID: Tank to add the pump to
+ * pumpID: Unique ID to assign the new pump
+ * targetID: Tank that the pump drains to
+ *
+ * return: True if the pump was added, else false
+ */
+bool CompactFuelSys::addPump(int tankID, int pumpID, int targetTank) {
+	if (pumpID < 0 || tankID == targetTank) {
+		return false;
+	}
+
+	if (findTank(targetTank) && findTank(tankID)) {
+		uint32_t tank = foundTank();
+
+		if (getPump(tank, pumpID) == NONE) {
+			uint32_t pump = newPump(pumpID, targetTank);
+			uint32_t* link = &m_tanks[tank].m_pumps;
+
+			while (*link != NONE) {
+				link = &m_pumps[*link].m_next;
+			}
+			*link = pump;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Function: removePump
+ * --------------------
+ * tankID: Tank to remove the pump from
+ * pumpID: Pump to be removed
+ *
+ * return: True if the pump is removed, else false
+ */
+bool CompactFuelSys::removePump(int tankID, int pumpID) {
+	uint32_t tank = getTank(tankID);
+	if (tank == NONE) {
+		return false;
+	}
+
+	uint32_t* link = &m_tanks[tank].m_pumps;
+	while (*link != NONE) {
+		uint32_t pump = *link;
+		if (m_pumps[pump].m_pumpID == pumpID) {
+			*link = m_pumps[pump].m_next;
+			freePump(pump);
+			return true;
+		}
+		link = &m_pumps[pump].m_next;
+	}
+
+	return false;
+}
+
+/*
+ * Function: fill
+ * --------------
+ * tankID: Tank to add fuel to
+ * fuel: Amount of fuel to add
+ *
+ * return: True if some amount of fuel was added to the tank, false if the tank could not be found or it's full
+ */
+bool CompactFuelSys::fill(int tankID, int fuel) {
+	if (fuel < 0) {
+		return false;
+	}
+
+	if (findTank(tankID)) {
+		TankNode& fillTank = m_tanks[foundTank()];
+		int neededFuel = fillTank.m_tankCapacity - fillTank.m_tankFuel;
+
+		if (neededFuel != 0) {
+			fillTank.m_tankFuel += fuel > neededFuel ? neededFuel : fuel;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Function: drain
+ * ---------------
+ * tankID: Source tank to drain fuel from
+ * pumpID: Pump used to transfer from source to destination tank
+ * fuel: Amount of fuel to take from the source
+ *
+ * return: True if fuel was transferred
+ */
+bool CompactFuelSys::drain(int tankID, int pumpID, int fuel) {
+	if (fuel < 0) {
+		return false;
+	}
+
+	if (findTank(tankID)) {
+		uint32_t sourceTank = foundTank();
+
+		if (fuel > m_tanks[sourceTank].m_tankFuel) {
+			fuel = m_tanks[sourceTank].m_tankFuel;
+		}
+
+		uint32_t pump = getPump(sourceTank, pumpID);
+		if (pump != NONE) {
+			int targetID = m_pumps[pump].m_target;
+			uint32_t destinationTank = getTank(targetID);
+			int neededFuel = m_tanks[destinationTank].m_tankCapacity - m_tanks[destinationTank].m_tankFuel;
+
+			if (neededFuel != 0) {
+				if (fuel > neededFuel) {
+					fuel = neededFuel;
+				}
+				m_tanks[sourceTank].m_tankFuel -= fuel;
+				return fill(targetID, fuel);
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Function: findTank
+ * ------------------
+ * tankID: ID of the target tank
+ *
+ * Searches the list for the ID. If found, it becomes the next of the current tank
+ *
+ * return: True if the tank is found, false otherwise
+ */
+bool CompactFuelSys::findTank(int tankID) {
+	uint32_t currentTank = m_current;
+	uint32_t previousTank = m_current;
+
+	while (currentTank != NONE) {
+		if (m_tanks[currentTank].m_tankID == tankID) {
+			TankNode& head = m_tanks[m_current];
+
+			//If it's the first tank, swap it with the second if it exists
+			if (head.m_tankID == tankID) {
+				if (head.m_next != NONE) {
+					uint32_t second = head.m_next;
+					head.m_next = m_tanks[second].m_next;
+					m_tanks[second].m_next = m_current;
+					m_current = second;
+				}
+			}
+			//If the tank is past the second tank, move it to second
+			else if (m_tanks[head.m_next].m_tankID != tankID) {
+				m_tanks[previousTank].m_next = m_tanks[currentTank].m_next;
+				m_tanks[currentTank].m_next = head.m_next;
+				head.m_next = currentTank;
+			}
+			return true;
+		}
+
+		previousTank = currentTank;
+		currentTank = m_tanks[currentTank].m_next;
+	}
+
+	return false;
+}
+
+/*
+ * Function: foundTank
+ * -------------------
+ * return: The tank findTank just moved, second in the list unless it is the only tank
+ */
+uint32_t CompactFuelSys::foundTank() const {
+	uint32_t second = m_tanks[m_current].m_next;
+	return second == NONE ? m_current : second;
+}
+
+/*
+ * Function: getTank
+ * -----------------
+ * return: Index of the tank with the ID, NONE if it is not in the list
+ */
+uint32_t CompactFuelSys::getTank(int tankID) const {
+	for (uint32_t tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+		if (m_tanks[tank].m_tankID == tankID) {
+			return tank;
+		}
+	}
+
+	return NONE;
+}
+
+/*
+ * Function: getPump
+ * -----------------
+ * return: Index of the tank's pump with the ID, NONE if it does not have one
+ */
+uint32_t CompactFuelSys::getPump(uint32_t tank, int pumpID) const {
+	for (uint32_t pump = m_tanks[tank].m_pumps; pump != NONE; pump = m_pumps[pump].m_next) {
+		if (m_pumps[pump].m_pumpID == pumpID) {
+			return pump;
+		}
+	}
+
+	return NONE;
+}
+
+/*
+ * Function: totalFuel
+ * -------------------
+ * return: The total fuel in the system
+ */
+long long CompactFuelSys::totalFuel() const {
+	long long totalFuel = 0;
+
+	for (uint32_t tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+		totalFuel += m_tanks[tank].m_tankFuel;
+	}
+
+	return totalFuel;
+}
+
+/*
+ * Function: memoryUsage
+ * ---------------------
+ * return: Bytes held, each pool being one allocation whose free and reserved nodes are slack
+ */
+MemoryUsage CompactFuelSys::memoryUsage() const {
+	MemoryUsage usage = MemoryUsage{};
+	HeapBytes tanks, pumps;
+
+	tanks.vector(m_tanks);
+	pumps.vector(m_pumps);
+
+	usage.system = sizeof(*this);
+	usage.tanks = m_liveTanks * sizeof(TankNode);
+	usage.pumps = m_livePumps * sizeof(PumpNode);
+	usage.slack = tanks.used + tanks.slack + pumps.used + pumps.slack - usage.tanks - usage.pumps;
+	return usage;
+}
+
+/*
+ * Function: dumpSys
+ * -----------------
+ * Outputs the list of tanks and their info in the same format as FuelSys
+ */
+void CompactFuelSys::dumpSys() const {
+	cout << "Tank List:\n";
+
+	for (uint32_t tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+		const TankNode& node = m_tanks[tank];
+		cout << "Tank: " << node.m_tankID << " Capacity: " << node.m_tankCapacity << " Current Fuel: " << node.m_tankFuel << "\n";
+
+		for (uint32_t pump = node.m_pumps; pump != NONE; pump = m_pumps[pump].m_next) {
+			cout << "Pumps: " << m_pumps[pump].m_pumpID << " Target Tank: " << m_pumps[pump].m_target << "\n";
+		}
+	}
+
+	cout << "Total Fuel: " << totalFuel() << "\n";
+}
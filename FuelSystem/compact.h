@@ -0,0 +1,65 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+#include "fuel.h"
+#include <cstdint>
+#include <vector>
+// CompactFuelSys behaves exactly like FuelSys, including the order findTank
+// leaves the list in, but keeps tanks and pumps in two indexed pools that
+// link through 32-bit indices instead of pointers. A tank node is 20 bytes
+// instead of 32 and a pump node 12 bytes instead of 16. Freed nodes are
+// chained through m_next and reused before the pools grow.
+class CompactFuelSys {
+public:
+    friend class Tester;
+    CompactFuelSys();
+    // reserve pool space up front to avoid regrowth
+    void reserve(int numTanks, int numPumps);
+    // add to the tank list
+    bool addTank(int tankID, int capacity);
+    // remove from the tank list
+    bool removeTank(int tankID);
+    // add pump to the pump list of the tank
+    bool addPump(int tankID, int pumpID, int targetTank);
+    // remove from the pump list of the tank
+    bool removePump(int tankID, int pumpID);
+    // fill the tank with fuel
+    bool fill(int tankID, int fuel);
+    // transfer fuel from the tank through the pump
+    bool drain(int tankID, int pumpID, int fuel);
+    // if the ID is found, it must become the next of current
+    bool findTank(int tankID);
+    // return the sum of fuel in all tanks
+    long long totalFuel() const;
+    // bytes held per component, reserved but unused nodes count as slack
+    MemoryUsage memoryUsage() const;
+    void dumpSys() const;
+private:
+    static const uint32_t NONE = 0xFFFFFFFF;
+    struct TankNode {
+        int m_tankID;
+        int m_tankCapacity;
+        int m_tankFuel;
+        uint32_t m_pumps;
+        uint32_t m_next;
+    };
+    struct PumpNode {
+        int m_pumpID;
+        int m_target;
+        uint32_t m_next;
+    };
+    std::vector<TankNode> m_tanks;
+    std::vector<PumpNode> m_pumps;
+    uint32_t m_current;   // head of the tank list
+    uint32_t m_freeTanks; // head of the free tank nodes
+    uint32_t m_freePumps; // head of the free pump nodes
+    size_t m_liveTanks;   // nodes in use, the rest of each pool is free
+    size_t m_livePumps;
+    uint32_t newTank(int tankID, int capacity);
+    uint32_t newPump(int pumpID, int target);
+    void freeTank(uint32_t tank);
+    void freePump(uint32_t pump);
+    uint32_t getTank(int tankID) const;
+    uint32_t getPump(uint32_t tank, int pumpID) const;
+    uint32_t foundTank() const;
+};
+#endif
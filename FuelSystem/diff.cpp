@@ -0,0 +1,196 @@
+#include "diff.h"
+
+typedef std::unordered_map<int, Tank*> TankMap;
+
+TankMap SysDiff::indexTanks(const FuelSys& sys) {
+	TankMap tanks;
+	tanks.reserve(sys.m_levels.size());
+
+	for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+		tanks[tank->m_tankID] = tank;
+	}
+
+	return tanks;
+}
+
+/*
+ * Function: diff
+ * --------------
+ * from: System the patch will be applied to
+ * to: System it should end up equal to
+ *
+ * Removals come first so IDs are free again, then new tanks, then levels, and pumps
+ * last so every target exists. A pump into a removed tank is not listed since removing
+ * the tank removes it
+ *
+ * return: The changes, empty if the systems are equal
+ */
+Patch SysDiff::diff(const FuelSys& from, const FuelSys& to) {
+	TankMap fromTanks = indexTanks(from);
+	TankMap toTanks = indexTanks(to);
+	std::vector<PatchOp> removals, additions, levels, pumps;
+	std::unordered_map<int, int> oldPumps; // pump ID to target
+
+	for (Tank* tank = from.m_current; tank != nullptr; tank = tank->m_next) {
+		if (toTanks.count(tank->m_tankID) == 0) {
+			removals.push_back(PatchOp{ PATCH_REMOVETANK, tank->m_tankID, 0, 0 });
+		}
+	}
+
+	for (Tank* tank = to.m_current; tank != nullptr; tank = tank->m_next) {
+		int tankID = tank->m_tankID;
+		auto found = fromTanks.find(tankID);
+
+		if (found == fromTanks.end()) {
+			additions.push_back(PatchOp{ PATCH_ADDTANK, tankID, 0, tank->m_tankCapacity });
+			if (tank->m_tankFuel != 0) {
+				levels.push_back(PatchOp{ PATCH_SETFUEL, tankID, 0, tank->m_tankFuel });
+			}
+			for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+				pumps.push_back(PatchOp{ PATCH_ADDPUMP, tankID, pump->m_pumpID, to.targetID(pump) });
+			}
+			continue;
+		}
+
+		//A tank shrinking below its old level is drained first so it never holds more than it fits
+		Tank* old = found->second;
+		bool shrinks = tank->m_tankCapacity < old->m_tankFuel;
+		if (shrinks && old->m_tankFuel != tank->m_tankFuel) {
+			levels.push_back(PatchOp{ PATCH_SETFUEL, tankID, 0, tank->m_tankFuel });
+		}
+		if (old->m_tankCapacity != tank->m_tankCapacity) {
+			levels.push_back(PatchOp{ PATCH_SETCAPACITY, tankID, 0, tank->m_tankCapacity });
+		}
+		if (!shrinks && old->m_tankFuel != tank->m_tankFuel) {
+			levels.push_back(PatchOp{ PATCH_SETFUEL, tankID, 0, tank->m_tankFuel });
+		}
+
+		oldPumps.clear();
+		for (Pump* pump = old->m_pumps; pump != nullptr; pump = pump->m_next) {
+			if (toTanks.count(from.targetID(pump)) > 0) {
+				oldPumps[pump->m_pumpID] = from.targetID(pump);
+			}
+		}
+
+		for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+			auto oldPump = oldPumps.find(pump->m_pumpID);
+			if (oldPump == oldPumps.end()) {
+				pumps.push_back(PatchOp{ PATCH_ADDPUMP, tankID, pump->m_pumpID, to.targetID(pump) });
+				continue;
+			}
+			if (oldPump->second != to.targetID(pump)) {
+				pumps.push_back(PatchOp{ PATCH_RETARGET, tankID, pump->m_pumpID, to.targetID(pump) });
+			}
+			oldPumps.erase(oldPump);
+		}
+
+		for (const auto& pump : oldPumps) {
+			removals.push_back(PatchOp{ PATCH_REMOVEPUMP, tankID, pump.first, 0 });
+		}
+	}
+
+	Patch patch;
+	patch.ops.reserve(removals.size() + additions.size() + levels.size() + pumps.size());
+	patch.ops.insert(patch.ops.end(), removals.begin(), removals.end());
+	patch.ops.insert(patch.ops.end(), additions.begin(), additions.end());
+	patch.ops.insert(patch.ops.end(), levels.begin(), levels.end());
+	patch.ops.insert(patch.ops.end(), pumps.begin(), pumps.end());
+	return patch;
+}
+
+/*
+ * Function: apply
+ * ---------------
+ * sys: System to change
+ * patch: Changes made by diff against a system equal to sys
+ *
+ * Tanks are resolved through one index built up front, and new tanks and pumps are
+ * linked at the end of their lists without a search. Removals go through removeTank and
+ * removePump. Ops before a failing one stay applied
+ *
+ * return: True if every op applied
+ */
+bool SysDiff::apply(FuelSys& sys, const Patch& patch) {
+	TankMap tanks = indexTanks(sys);
+	Tank* last = nullptr;
+
+	for (const PatchOp& op : patch.ops) {
+		auto found = tanks.find(op.tankID);
+		Tank* tank = found == tanks.end() ? nullptr : found->second;
+
+		if (op.type == PATCH_REMOVETANK) {
+			if (tank == nullptr || !sys.removeTank(op.tankID)) {
+				return false;
+			}
+			tanks.erase(found);
+			if (tank == last) {
+				last = nullptr;
+			}
+		}
+		else if (op.type == PATCH_REMOVEPUMP) {
+			if (tank == nullptr || !sys.removePump(op.tankID, op.pumpID)) {
+				return false;
+			}
+		}
+		else if (op.type == PATCH_ADDTANK) {
+			if (tank != nullptr || op.tankID < 0 || op.value < MINCAP) {
+				return false;
+			}
+
+			if (last == nullptr) {
+				for (last = sys.m_current; last != nullptr && last->m_next != nullptr; last = last->m_next) {
+				}
+			}
+			Tank* added = sys.newTank(op.tankID, op.value);
+			if (last == nullptr) {
+				sys.m_current = added;
+			}
+			else {
+				last->m_next = added;
+			}
+			last = added;
+			tanks[op.tankID] = added;
+		}
+		else if (op.type == PATCH_SETCAPACITY) {
+			if (tank == nullptr || op.value < MINCAP || op.value < tank->m_tankFuel) {
+				return false;
+			}
+			sys.resizeTank(tank, op.value);
+		}
+		else if (op.type == PATCH_SETFUEL) {
+			if (tank == nullptr || op.value < 0 || op.value > tank->m_tankCapacity) {
+				return false;
+			}
+			sys.setFuel(tank, op.value, op.value > tank->m_tankFuel ? FILLCHANGE : DRAINCHANGE);
+		}
+		else {
+			if (tank == nullptr || tanks.count(op.value) == 0 || op.value == op.tankID) {
+				return false;
+			}
+
+			Pump* pump = sys.getPump(tank, op.pumpID);
+			if (op.type == PATCH_RETARGET) {
+				if (pump == nullptr) {
+					return false;
+				}
+				sys.m_reach.removeEdge(op.tankID, sys.targetID(pump));
+				sys.m_reach.addEdge(op.tankID, op.value);
+				pump->m_target = sys.indexOf(op.value);
+				continue;
+			}
+
+			if (pump != nullptr || op.pumpID < 0) {
+				return false;
+			}
+			Pump* added = sys.newPump(op.tankID, op.pumpID, op.value);
+			if (tank->m_pumps == nullptr) {
+				tank->m_pumps = added;
+			}
+			else {
+				sys.getEndPump(tank)->m_next = added;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,34 @@
+#ifndef DIFF_H
+#define DIFF_H
+#include "fuel.h"
+#include <unordered_map>
+#include <vector>
+enum PATCHOP { PATCH_REMOVETANK, PATCH_REMOVEPUMP, PATCH_ADDTANK, PATCH_SETCAPACITY, PATCH_SETFUEL,
+    PATCH_ADDPUMP, PATCH_RETARGET };
+// one change: value is the capacity, fuel or pump target
+struct PatchOp {
+    PATCHOP type;
+    int tankID;
+    int pumpID;
+    int value;
+};
+// a list of changes in the order they must be applied
+struct Patch {
+    std::vector<PatchOp> ops;
+    bool empty() const { return ops.empty(); }
+};
+// SysDiff finds what differs between two systems and turns one into the
+// other. Both sides are indexed by ID in one walk, so diff is linear in
+// the number of tanks and pumps. The order of tanks in the list and of
+// pumps in a tank is not compared.
+class SysDiff {
+public:
+    // the changes that turn from into to
+    static Patch diff(const FuelSys& from, const FuelSys& to);
+    // apply a patch made against a system equal to sys, false at the first op that does not fit
+    static bool apply(FuelSys& sys, const Patch& patch);
+private:
+    // every tank of the system by ID, in one walk of the list
+    static std::unordered_map<int, Tank*> indexTanks(const FuelSys& sys);
+};
+#endif
@@ -0,0 +1,341 @@
+#include "event.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+
+//Orders the heap so the earliest event is on top
+static bool later(const Event& a, const Event& b) {
+	if (a.time != b.time) {
+		return a.time > b.time;
+	}
+	return a.seq > b.seq;
+}
+
+//Packs a tank and pump ID into one key
+static long long flowKey(int tankID, int pumpID) {
+	return ((long long)tankID << 32) | (unsigned)pumpID;
+}
+
+EventSim::EventSim(FuelSys& sys) : m_sys(sys) {
+	m_now = 0;
+	m_seq = 0;
+}
+
+/*
+ * Function: schedule
+ * ------------------
+ * time: When the event happens in seconds
+ * type: Fill, drain, pump start or pump stop
+ * tankID: Tank the event applies to
+ * pumpID: Pump for drains, starts and stops
+ * amount: Fuel for fills and drains, rate for pump starts
+ *
+ * return: True if the event was added, false if it is in the past or the amount is negative
+ */
+bool EventSim::schedule(long long time, EVENT type, int tankID, int pumpID, int amount) {
+	if (time < m_now || amount < 0) {
+		return false;
+	}
+
+	m_heap.push_back(Event{ time, m_seq++, tankID, pumpID, amount, type });
+	std::push_heap(m_heap.begin(), m_heap.end(), later);
+	return true;
+}
+
+/*
+ * Function: runUntil
+ * ------------------
+ * time: Last time to process
+ *
+ * Pops events in time order. Running pumps are not settled at the end, call sync for that
+ *
+ * return: Number of events processed
+ */
+int EventSim::runUntil(long long time) {
+	int processed = 0;
+
+	while (!m_heap.empty() && m_heap.front().time <= time) {
+		std::pop_heap(m_heap.begin(), m_heap.end(), later);
+		Event event = m_heap.back();
+		m_heap.pop_back();
+
+		m_now = event.time;
+		process(event);
+		processed++;
+	}
+
+	if (time > m_now) {
+		m_now = time;
+	}
+
+	return processed;
+}
+
+/*
+ * Function: run
+ * -------------
+ * return: Number of events processed
+ */
+int EventSim::run() {
+	int processed = 0;
+
+	while (!m_heap.empty()) {
+		processed += runUntil(m_heap.front().time);
+	}
+
+	return processed;
+}
+
+/*
+ * Function: sync
+ * --------------
+ * Brings every running pump up to the current time
+ */
+void EventSim::sync() {
+	std::vector<int> flows;
+	for (auto& entry : m_flowIndex) {
+		flows.push_back(entry.second);
+	}
+
+	settleFlows(flows);
+}
+
+/*
+ * Function: process
+ * -----------------
+ * Settles the flows of the tanks the event touches, then applies it
+ */
+void EventSim::process(const Event& event) {
+	int target = -1;
+
+	switch (event.type) {
+	case FILLEVENT:
+		settleTank(event.tankID);
+		m_sys.fill(event.tankID, event.amount);
+		break;
+	case DRAINEVENT:
+		target = pumpTarget(event.tankID, event.pumpID);
+		if (target >= 0) {
+			settleTank(event.tankID);
+			settleTank(target);
+			m_sys.drain(event.tankID, event.pumpID, event.amount);
+		}
+		break;
+	case PUMPSTART:
+		target = pumpTarget(event.tankID, event.pumpID);
+		if (target >= 0) {
+			settleTank(event.tankID);
+			settleTank(target);
+			startFlow(event.tankID, event.pumpID, target, event.amount);
+		}
+		break;
+	case PUMPSTOP:
+		settleTank(event.tankID);
+		stopFlow(event.tankID, event.pumpID);
+		break;
+	}
+}
+
+/*
+ * Function: pumpTarget
+ * --------------------
+ * return: ID of the tank the pump drains to, -1 if the pump does not exist
+ */
+int EventSim::pumpTarget(int tankID, int pumpID) {
+	Tank* tank = m_sys.getTank(tankID);
+	if (tank == nullptr) {
+		return -1;
+	}
+
+	Pump* pump = m_sys.getPump(tank, pumpID);
+	if (pump == nullptr) {
+		return -1;
+	}
+
+	return m_sys.targetID(pump);
+}
+
+/*
+ * Function: settle
+ * ----------------
+ * Drains the fuel the pump moved since it was last settled, clamped the same way as drain.
+ * The amount is capped at INT_MAX before multiplying, so a long idle stretch cannot overflow
+ */
+void EventSim::settle(Flow& flow) {
+	long long elapsed = m_now - flow.since;
+	flow.since = m_now;
+
+	if (flow.rate > 0 && elapsed > 0) {
+		long long amount = elapsed > INT_MAX / flow.rate ? INT_MAX : flow.rate * elapsed;
+		m_sys.drain(flow.source, flow.pumpID, (int)amount);
+	}
+}
+
+/*
+ * Function: settleTank
+ * --------------------
+ * Settles every running pump linked to the tank through a chain of running pumps, so a
+ * chain is always settled as a whole no matter which of its tanks the event touches
+ */
+void EventSim::settleTank(int tankID) {
+	if (m_touching.find(tankID) == m_touching.end()) {
+		return;
+	}
+
+	std::vector<int> flows;
+	std::vector<int> tanks(1, tankID);
+	std::unordered_set<int> reached(tanks.begin(), tanks.end());
+	std::unordered_set<int> added;
+
+	for (size_t i = 0; i < tanks.size(); i++) {
+		for (int flow : m_touching.find(tanks[i])->second) {
+			if (!added.insert(flow).second) {
+				continue;
+			}
+			flows.push_back(flow);
+			for (int end : { m_flows[flow].source, m_flows[flow].target }) {
+				if (reached.insert(end).second) {
+					tanks.push_back(end);
+				}
+			}
+		}
+	}
+
+	settleFlows(flows);
+}
+
+/*
+ * Function: settleFlows
+ * ---------------------
+ * flows: Running pumps to bring up to the current time
+ *
+ * Settles each pump only after the pumps draining out of its target, so fuel arriving in a
+ * tank is not passed on in the same settlement. Pumps that are ready together, and a loop
+ * of running pumps that is never ready, go in order of source tank and pump ID, which makes
+ * the result independent of the order the flows were found in
+ */
+void EventSim::settleFlows(std::vector<int>& flows) {
+	std::sort(flows.begin(), flows.end(), [this](int a, int b) {
+		const Flow& x = m_flows[a];
+		const Flow& y = m_flows[b];
+		return x.source != y.source ? x.source < y.source : x.pumpID < y.pumpID;
+	});
+
+	std::unordered_map<int, int> outgoing;                // unsettled pumps draining each tank
+	std::unordered_map<int, std::vector<size_t>> into;    // pumps draining into each tank
+	for (size_t i = 0; i < flows.size(); i++) {
+		outgoing[m_flows[flows[i]].source]++;
+		into[m_flows[flows[i]].target].push_back(i);
+	}
+
+	std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+	for (size_t i = 0; i < flows.size(); i++) {
+		if (outgoing[m_flows[flows[i]].target] == 0) {
+			ready.push(i);
+		}
+	}
+
+	std::vector<char> done(flows.size(), 0);
+	size_t next = 0;
+	for (size_t settled = 0; settled < flows.size(); settled++) {
+		while (!ready.empty() && done[ready.top()]) {
+			ready.pop();
+		}
+		//Only loops are left, so break one at the first pump in order
+		if (ready.empty()) {
+			while (done[next]) {
+				next++;
+			}
+			ready.push(next);
+		}
+
+		size_t i = ready.top();
+		ready.pop();
+		done[i] = 1;
+
+		Flow& flow = m_flows[flows[i]];
+		settle(flow);
+		if (--outgoing[flow.source] == 0) {
+			for (size_t upstream : into[flow.source]) {
+				if (!done[upstream]) {
+					ready.push(upstream);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Function: startFlow
+ * -------------------
+ * Starts the pump or changes its rate if it is already running
+ */
+void EventSim::startFlow(int tankID, int pumpID, int target, int rate) {
+	long long key = flowKey(tankID, pumpID);
+	auto found = m_flowIndex.find(key);
+
+	if (found != m_flowIndex.end()) {
+		m_flows[found->second].rate = rate;
+		return;
+	}
+
+	int flow = 0;
+	if (m_freeFlows.empty()) {
+		flow = (int)m_flows.size();
+		m_flows.push_back(Flow());
+	}
+	else {
+		flow = m_freeFlows.back();
+		m_freeFlows.pop_back();
+	}
+
+	m_flows[flow] = Flow{ tankID, pumpID, target, rate, m_now };
+	m_flowIndex[key] = flow;
+	m_touching[tankID].push_back(flow);
+	m_touching[target].push_back(flow);
+}
+
+/*
+ * Function: stopFlow
+ * ------------------
+ * Stops a running pump, the caller has already settled it
+ */
+void EventSim::stopFlow(int tankID, int pumpID) {
+	auto found = m_flowIndex.find(flowKey(tankID, pumpID));
+	if (found == m_flowIndex.end()) {
+		return;
+	}
+
+	int flow = found->second;
+	m_flowIndex.erase(found);
+	untouch(m_flows[flow].source, flow);
+	untouch(m_flows[flow].target, flow);
+	m_freeFlows.push_back(flow);
+}
+
+/*
+ * Function: untouch
+ * -----------------
+ * Removes a flow from the tank's list of running flows
+ */
+void EventSim::untouch(int tankID, int flow) {
+	auto found = m_touching.find(tankID);
+	if (found == m_touching.end()) {
+		return;
+	}
+
+	std::vector<int>& flows = found->second;
+	for (size_t i = 0; i < flows.size(); i++) {
+		if (flows[i] == flow) {
+			flows[i] = flows.back();
+			flows.pop_back();
+			break;
+		}
+	}
+
+	if (flows.empty()) {
+		m_touching.erase(found);
+	}
+}
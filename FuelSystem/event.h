@@ -0,0 +1,63 @@
+#ifndef EVENT_H
+#define EVENT_H
+#include "fuel.h"
+#include <vector>
+#include <unordered_map>
+enum EVENT { FILLEVENT, DRAINEVENT, PUMPSTART, PUMPSTOP };
+// a scheduled operation, amount is the fuel for fills and drains
+// and the rate in kg per second for pump starts
+struct Event {
+    long long time;
+    unsigned seq;    // breaks ties so events at the same time run in order
+    int tankID;
+    int pumpID;
+    int amount;
+    EVENT type;
+};
+// EventSim plays back a schedule of events against a fuel system.
+// Running pumps are settled lazily: the fuel moved since the last
+// settlement is drained only when an event touches the source or the
+// target tank, so idle tanks cost nothing. A chain of running pumps is
+// settled together, downstream first, so in A to B to C the fuel B passes
+// on over a stretch is what it held at the start of it, not what A sent
+// during it, whichever of the three tanks the event touched.
+class EventSim {
+public:
+    EventSim(FuelSys& sys);
+    // add an event to the schedule, rejected if it is in the past
+    bool schedule(long long time, EVENT type, int tankID, int pumpID = 0, int amount = 0);
+    // process every event scheduled up to and including time
+    int runUntil(long long time);
+    // process every scheduled event
+    int run();
+    // settle all running pumps up to the current time
+    void sync();
+    long long now() const { return m_now; }
+    int pending() const { return (int)m_heap.size(); }
+    int running() const { return (int)m_flowIndex.size(); }
+private:
+    struct Flow {
+        int source;
+        int pumpID;
+        int target;
+        int rate;
+        long long since; // time the flow was last settled
+    };
+    FuelSys& m_sys;
+    long long m_now;
+    unsigned m_seq;
+    std::vector<Event> m_heap;
+    std::vector<Flow> m_flows;
+    std::vector<int> m_freeFlows;
+    std::unordered_map<long long, int> m_flowIndex;          // (tank, pump) to flow
+    std::unordered_map<int, std::vector<int>> m_touching;    // tank to flows in or out
+    void process(const Event& event);
+    int pumpTarget(int tankID, int pumpID);
+    void settle(Flow& flow);
+    void settleTank(int tankID);
+    void settleFlows(std::vector<int>& flows);
+    void startFlow(int tankID, int pumpID, int target, int rate);
+    void stopFlow(int tankID, int pumpID);
+    void untouch(int tankID, int flow);
+};
+#endif
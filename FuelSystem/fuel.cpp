@@ -1,13 +1,20 @@
 #include "fuel.h"
-
-FuelSys::FuelSys() {
+#include "stats.h"
+#include "balance.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+template <class Q>
+BasicFuelSys<Q>::BasicFuelSys() {
 	m_current = nullptr;
+	m_feed = nullptr;
+	m_pumpCount = 0;
 }
 
-FuelSys::~FuelSys() {
-	while (m_current != nullptr) {
-		removeTank(m_current->m_tankID);
-	}
+template <class Q>
+BasicFuelSys<Q>::~BasicFuelSys() {
+	clearTanks();
 }
 
 /*
@@ -15,50 +22,74 @@ FuelSys::~FuelSys() {
  * -------------------
  * rhs: Existing Fuel System
  * 
- * Copy the tanks and pumps from an existing fuel system to this system
+ * Copy the tanks and pumps from an existing fuel system to this system. A tank whose ID
+ * is also in rhs keeps its alarm and reports one change from its old level to the feed,
+ * the other tanks of this system are reported removed
  */ 
-const FuelSys& FuelSys::operator=(const FuelSys& rhs) {
+template <class Q>
+const BasicFuelSys<Q>& BasicFuelSys<Q>::operator=(const BasicFuelSys& rhs) {
+	FUEL_TIMER(STAT_COPY);
 	//If it's the same system, no change
 	if (this == &rhs)
 	{
 		return *this;
 	}
 
-	//Clears this system
-	while (m_current != nullptr) {
-		removeTank(m_current->m_tankID);
+	//Clears this system, remembering the levels of the tanks that stay
+	std::unordered_map<int, Q> keptLevels;
+	for (Tank* currentTank = m_current; currentTank != nullptr; currentTank = currentTank->m_next) {
+		if (rhs.indexOf(currentTank->m_tankID) >= 0) {
+			keptLevels[currentTank->m_tankID] = currentTank->m_tankFuel;
+		}
 	}
+	clearTanks(&rhs);
 
 	Tank* currentCopyTank = rhs.m_current;
 
 	//Creates tanks in this system using existing IDs, capacities, and current fuel
 	while (currentCopyTank != nullptr) {
 		int tankID = currentCopyTank->m_tankID;
-		int capacity = currentCopyTank->m_tankCapacity;
+		Q capacity = currentCopyTank->m_tankCapacity;
 		addTank(tankID, capacity);
 
 		Tank* currentTank = getTank(tankID);
-		currentTank->m_tankFuel = currentCopyTank->m_tankFuel;
+		auto kept = keptLevels.find(tankID);
+		if (kept != keptLevels.end()) {
+			//Start from the level subscribers last saw, and check the alarm even if only the capacity changed
+			m_levels.update(tankID, capacity, 0, kept->second);
+			currentTank->m_tankFuel = kept->second;
+			setFuel(currentTank, currentCopyTank->m_tankFuel, FILLCHANGE);
+			if (!m_alarms.empty()) {
+				m_alarms.check(tankID, toKg(currentTank->m_tankFuel) / toKg(capacity));
+			}
+		}
+		else {
+			setFuel(currentTank, currentCopyTank->m_tankFuel, FILLCHANGE);
+		}
+		currentCopyTank = currentCopyTank->m_next;
+	}
 
+	//Pumps come second since they point at tanks by index, so every target must exist
+	for (currentCopyTank = rhs.m_current; currentCopyTank != nullptr; currentCopyTank = currentCopyTank->m_next) {
+		int tankID = currentCopyTank->m_tankID;
+		Tank* currentTank = getTank(tankID);
 		Pump* currentCopyPump = currentCopyTank->m_pumps;
 
 		//Creates pumps in respective tanks using existing IDs and targets
 		while (currentCopyPump != nullptr) {
 			int pumpID = currentCopyPump->m_pumpID;
-			int targetID = currentCopyPump->m_target;
+			int targetID = rhs.targetID(currentCopyPump);
 
 			if (currentTank->m_pumps == nullptr) {
-				currentTank->m_pumps = new Pump(pumpID, targetID);
+				currentTank->m_pumps = newPump(tankID, pumpID, targetID);
 			}
 			else {
 				Pump* endPump = getEndPump(currentTank);
-				endPump->m_next = new Pump(pumpID, targetID);
+				endPump->m_next = newPump(tankID, pumpID, targetID);
 			}
 
 			currentCopyPump = currentCopyPump->m_next;
 		}
-
-		currentCopyTank = currentCopyTank->m_next;
 	}
 
 	return *this;
@@ -74,19 +105,21 @@ const FuelSys& FuelSys::operator=(const FuelSys& rhs) {
  *
  * return: True if a tank was successfully created else false
  */
-bool FuelSys::addTank(int tankID, int capacity) {
+template <class Q>
+bool BasicFuelSys<Q>::addTank(int tankID, Q capacity) {
+	FUEL_TIMER(STAT_ADDTANK);
 	if (tankID < 0 || capacity < MINCAP) {
 		return false;
 	}
 
 	if (m_current == nullptr) {
-		m_current = new Tank(tankID, capacity);
+		m_current = newTank(tankID, capacity);
 		return true;
 	}
 
 	if (!findTank(tankID)) {
 		Tank* endTank = getEndTank(tankID);
-		endTank->m_next = new Tank(tankID, capacity);
+		endTank->m_next = newTank(tankID, capacity);
 		return true;
 	}
 
@@ -101,7 +134,8 @@ bool FuelSys::addTank(int tankID, int capacity) {
  *
  * return: Last tank in the list if no duplicate ID else nullptr
  */
-Tank* FuelSys::getEndTank(int tankID) {
+template <class Q>
+BasicTank<Q>* BasicFuelSys<Q>::getEndTank(int tankID) {
 	Tank* currentTank = m_current; //Current tank in the list to check against the ID
 
 	while (currentTank->m_next != nullptr) {
@@ -120,7 +154,9 @@ Tank* FuelSys::getEndTank(int tankID) {
  * 
  * return: True if the tank is removed from the list, else false
  */
-bool FuelSys::removeTank(int tankID) {
+template <class Q>
+bool BasicFuelSys<Q>::removeTank(int tankID) {
+	FUEL_TIMER(STAT_REMOVETANK);
 	Tank* currentTank = m_current;
 	Tank* previousTank = m_current;
 
@@ -149,41 +185,108 @@ bool FuelSys::removeTank(int tankID) {
 		previousTank->m_next = currentTank->m_next;
 	}
 
-	//Delete each of the pumps
-	Pump* currentPump = currentTank->m_pumps;
-	Pump* nextPump = nullptr;
+	//Delete pumps from other tanks that target this tank
+	{
+		FUEL_TIMER(STAT_PUMPSWEEP);
+		long long visited = 0;
+		Tank* linkTank = m_current;
+
+		while (linkTank != nullptr) {
+			Pump* linkPump = linkTank->m_pumps;
+
+			while (linkPump != nullptr) {
+				visited++;
+				//removePump frees the pump, so step past it first
+				Pump* nextPump = linkPump->m_next;
+				if (linkPump->m_target == currentTank->m_index) {
+					removePump(linkTank->m_tankID, linkPump->m_pumpID);
+				}
+				linkPump = nextPump;
+			}
+			
+			linkTank = linkTank->m_next;
+		}
 
-	while (currentPump != nullptr) {
-		nextPump = currentPump->m_next;
-		removePump(currentTank->m_tankID, currentPump->m_pumpID);
-		currentPump = nextPump;
+		FUEL_PROBE(STAT_PUMPSWEEP, visited);
 	}
 
-	//Delete pumps from other tanks that target this tank
-	Tank* linkTank = m_current;
+	freeTank(currentTank);
+	currentTank = nullptr;
 
-	while (linkTank != nullptr) {
-		Pump* linkPump = linkTank->m_pumps;
+	return true;
+}
 
-		while (linkPump != nullptr) {
-			if (linkPump->m_target == tankID) {
-				removePump(linkTank->m_tankID, linkPump->m_pumpID);
-			}
-			if (findPump(linkTank, linkPump->m_pumpID)){
-				linkPump = linkPump->m_next;
+/*
+ * Function: removeTanks
+ * ---------------------
+ * tankIDs: Tanks to remove, IDs that do not exist or repeat are skipped
+ *
+ * Marks the victims by index, then one walk of the list unlinks them and drops every
+ * surviving pump into one of them, so the cost is one pass over all pumps however many
+ * tanks go. Removing them one at a time sweeps every pump once per tank
+ *
+ * return: Number of tanks removed
+ */
+template <class Q>
+int BasicFuelSys<Q>::removeTanks(std::span<const int> tankIDs) {
+	FUEL_TIMER(STAT_REMOVETANKS);
+	std::vector<char> doomed(m_byIndex.size(), 0);
+	std::vector<Tank*> victims;
+
+	for (int tankID : tankIDs) {
+		Tank* tank = getTank(tankID);
+		if (tank != nullptr && !doomed[tank->m_index]) {
+			doomed[tank->m_index] = 1;
+			victims.push_back(tank);
+		}
+	}
+
+	if (victims.empty()) {
+		return 0;
+	}
+
+	long long visited = 0;
+	Tank* previousTank = nullptr;
+	Tank* currentTank = m_current;
+
+	while (currentTank != nullptr) {
+		Tank* nextTank = currentTank->m_next;
+
+		if (doomed[currentTank->m_index]) {
+			if (previousTank == nullptr) {
+				m_current = nextTank;
 			}
 			else {
-				linkPump = linkTank->m_pumps;
+				previousTank->m_next = nextTank;
+			}
+		}
+		else {
+			//The reachability index drops these edges when it removes the victims
+			Pump** link = &currentTank->m_pumps;
+			while (*link != nullptr) {
+				visited++;
+				Pump* pump = *link;
+				if (doomed[pump->m_target]) {
+					*link = pump->m_next;
+					delete pump;
+					m_pumpCount--;
+				}
+				else {
+					link = &pump->m_next;
+				}
 			}
+			previousTank = currentTank;
 		}
-		
-		linkTank = linkTank->m_next;
+
+		currentTank = nextTank;
 	}
+	FUEL_PROBE(STAT_REMOVETANKS, visited);
 
-	delete currentTank;
-	currentTank = nullptr;
+	for (Tank* tank : victims) {
+		freeTank(tank);
+	}
 
-	return true;
+	return (int)victims.size();
 }
 
 /*
@@ -197,7 +300,9 @@ bool FuelSys::removeTank(int tankID) {
  * 
  * return: True if the pump was added, else false
  */
-bool FuelSys::addPump(int tankID, int pumpID, int targetTank) {
+template <class Q>
+bool BasicFuelSys<Q>::addPump(int tankID, int pumpID, int targetTank) {
+	FUEL_TIMER(STAT_ADDPUMP);
 	if (pumpID < 0 || tankID == targetTank) {
 		return false;
 	}
@@ -215,12 +320,12 @@ bool FuelSys::addPump(int tankID, int pumpID, int targetTank) {
 			Tank* tank = currentTank;
 
 			if (tank->m_pumps == nullptr) {
-				tank->m_pumps = new Pump(pumpID, targetTank);
+				tank->m_pumps = newPump(tankID, pumpID, targetTank);
 				return true;
 			}
 
 			Pump* endPump = getEndPump(tank);
-			endPump->m_next = new Pump(pumpID, targetTank);
+			endPump->m_next = newPump(tankID, pumpID, targetTank);
 			return true;
 		}
 	}
@@ -238,7 +343,9 @@ bool FuelSys::addPump(int tankID, int pumpID, int targetTank) {
  * 
  * return: True if the pump is removed, else false
  */
-bool FuelSys::removePump(int tankID, int pumpID) {
+template <class Q>
+bool BasicFuelSys<Q>::removePump(int tankID, int pumpID) {
+	FUEL_TIMER(STAT_REMOVEPUMP);
 	Tank* targetTank = getTank(tankID);
 
 	if (targetTank == nullptr || targetTank->m_pumps == nullptr) {
@@ -269,12 +376,72 @@ bool FuelSys::removePump(int tankID, int pumpID) {
 		previousPump->m_next = currentPump->m_next;
 	}
 
+	m_reach.removeEdge(tankID, targetID(currentPump));
 	delete currentPump;
 	currentPump = nullptr;
+	m_pumpCount--;
 	
 	return true;
 }
 
+/*
+ * Function: removePumps
+ * ---------------------
+ * pumps: (tank ID, pump ID) of each pump to remove, missing ones are skipped
+ *
+ * Sorts the requests by tank index so each tank's pump list is walked once, looking up
+ * every pump in its tank's sorted run
+ *
+ * return: Number of pumps removed
+ */
+template <class Q>
+int BasicFuelSys<Q>::removePumps(std::span<const std::pair<int, int>> pumps) {
+	FUEL_TIMER(STAT_REMOVEPUMPS);
+	std::vector<std::pair<int, int>> byIndex; // tank index and pump ID
+	byIndex.reserve(pumps.size());
+
+	for (const std::pair<int, int>& pump : pumps) {
+		int index = indexOf(pump.first);
+		if (index >= 0) {
+			byIndex.push_back({ index, pump.second });
+		}
+	}
+	std::sort(byIndex.begin(), byIndex.end());
+
+	int removed = 0;
+	long long visited = 0;
+	size_t begin = 0;
+
+	while (begin < byIndex.size()) {
+		size_t end = begin;
+		while (end < byIndex.size() && byIndex[end].first == byIndex[begin].first) {
+			end++;
+		}
+
+		Tank* tank = m_byIndex[byIndex[begin].first];
+		Pump** link = &tank->m_pumps;
+		while (*link != nullptr) {
+			visited++;
+			Pump* pump = *link;
+			if (std::binary_search(byIndex.begin() + begin, byIndex.begin() + end, std::make_pair(tank->m_index, pump->m_pumpID))) {
+				*link = pump->m_next;
+				m_reach.removeEdge(tank->m_tankID, targetID(pump));
+				delete pump;
+				m_pumpCount--;
+				removed++;
+			}
+			else {
+				link = &pump->m_next;
+			}
+		}
+
+		begin = end;
+	}
+	FUEL_PROBE(STAT_REMOVEPUMPS, visited);
+
+	return removed;
+}
+
 /*
  * Function: fill
  * --------------
@@ -285,7 +452,19 @@ bool FuelSys::removePump(int tankID, int pumpID) {
  * 
  * return: True if some amount of fuel was added to the tank, false if the tank could be found or it's full
  */
-bool FuelSys::fill(int tankID, int fuel) {
+template <class Q>
+bool BasicFuelSys<Q>::fill(int tankID, Q fuel) {
+	return fillTank(tankID, fuel, FILLCHANGE);
+}
+
+/*
+ * Function: fillTank
+ * ------------------
+ * cause: Reported to the change feed, drain fills its target with DRAINCHANGE
+ */
+template <class Q>
+bool BasicFuelSys<Q>::fillTank(int tankID, Q fuel, CHANGE cause) {
+	FUEL_TIMER(STAT_FILL);
 	if (fuel < 0) {
 		return false;
 	}
@@ -298,14 +477,15 @@ bool FuelSys::fill(int tankID, int fuel) {
 		else {
 			fillTank = m_current->m_next;
 		}
-		int neededFuel = fillTank->m_tankCapacity - fillTank->m_tankFuel;
+		Q neededFuel = fillTank->m_tankCapacity - fillTank->m_tankFuel;
 		//Tank is full
 		if (neededFuel != 0) {
 			if (fuel > neededFuel) {
-				fillTank->m_tankFuel += neededFuel;
+				FUEL_EVENT(STAT_FILLCLAMP);
+				setFuel(fillTank, fillTank->m_tankFuel + neededFuel, cause);
 			}
 			else {
-				fillTank->m_tankFuel += fuel;
+				setFuel(fillTank, fillTank->m_tankFuel + fuel, cause);
 			}
 
 			return true;
@@ -326,7 +506,9 @@ bool FuelSys::fill(int tankID, int fuel) {
  * 
  * return: True if fuel was transferred
  */
-bool FuelSys::drain(int tankID, int pumpID, int fuel) {
+template <class Q>
+bool BasicFuelSys<Q>::drain(int tankID, int pumpID, Q fuel) {
+	FUEL_TIMER(STAT_DRAIN);
 	if (fuel < 0) {
 		return false;
 	}
@@ -341,22 +523,24 @@ bool FuelSys::drain(int tankID, int pumpID, int fuel) {
 		}
 		//Decrease the amount of fuel if there is not enough in the tnak
 		if (fuel > sourceTank->m_tankFuel) {
+			FUEL_EVENT(STAT_SOURCECLAMP);
 			fuel = sourceTank->m_tankFuel;
 		}
 		if (findPump(sourceTank, pumpID)) {
 			Pump* sourcePump = getPump(sourceTank, pumpID);
-			Tank* destinationTank = getTank(sourcePump->m_target);
-			int neededFuel = destinationTank->m_tankCapacity - destinationTank->m_tankFuel;
+			Tank* destinationTank = targetOf(sourcePump);
+			Q neededFuel = destinationTank->m_tankCapacity - destinationTank->m_tankFuel;
 			
 			if (neededFuel != 0){
 				//Decrease the amount of fuel if there is not enough space available
 				if (fuel > neededFuel) {
-					sourceTank->m_tankFuel -= neededFuel;
-					return fill(destinationTank->m_tankID, neededFuel);
+					FUEL_EVENT(STAT_DESTCLAMP);
+					setFuel(sourceTank, sourceTank->m_tankFuel - neededFuel, DRAINCHANGE);
+					return fillTank(destinationTank->m_tankID, neededFuel, DRAINCHANGE);
 				}
 				else {
-					sourceTank->m_tankFuel -= fuel;
-					return fill(destinationTank->m_tankID, fuel);
+					setFuel(sourceTank, sourceTank->m_tankFuel - fuel, DRAINCHANGE);
+					return fillTank(destinationTank->m_tankID, fuel, DRAINCHANGE);
 				}
 			}
 		}
@@ -365,6 +549,26 @@ bool FuelSys::drain(int tankID, int pumpID, int fuel) {
 	return false;
 }
 
+/*
+ * Function: setCapacity
+ * ---------------------
+ * tankID: Tank to resize
+ * capacity: How much fuel the tank can hold from now on
+ *
+ * return: True if the tank exists and the capacity is at least MINCAP and the fuel in the tank
+ */
+template <class Q>
+bool BasicFuelSys<Q>::setCapacity(int tankID, Q capacity) {
+	FUEL_TIMER(STAT_SETCAPACITY);
+	Tank* tank = getTank(tankID);
+	if (tank == nullptr || capacity < MINCAP || capacity < tank->m_tankFuel) {
+		return false;
+	}
+
+	resizeTank(tank, capacity);
+	return true;
+}
+
 /*
  * Function: findTank
  * ------------------
@@ -374,12 +578,17 @@ bool FuelSys::drain(int tankID, int pumpID, int fuel) {
  * 
  * return: True if the tank is found, false otherwise
  */
-bool FuelSys::findTank(int tankID) {
+template <class Q>
+bool BasicFuelSys<Q>::findTank(int tankID) {
+	FUEL_TIMER(STAT_FINDTANK);
 	Tank* currentTank = m_current;
 	Tank* previousTank = m_current;
+	long long walked = 0;
 
 	while (currentTank != nullptr) {
+		walked++;
 		if (currentTank->m_tankID == tankID) {
+			FUEL_PROBE(STAT_FINDTANK, walked);
 			//If it's the first tank, swap it with the second if it exists
 			if (m_current->m_tankID == tankID) {
 				if (m_current->m_next != nullptr) {
@@ -403,6 +612,7 @@ bool FuelSys::findTank(int tankID) {
 		currentTank = currentTank->m_next;
 	}
 
+	FUEL_PROBE(STAT_FINDTANK, walked);
 	return false;
 }
 
@@ -414,7 +624,8 @@ bool FuelSys::findTank(int tankID) {
  * 
  * return: true if the pump was found, false otherwise
  */
-bool FuelSys::findPump(Tank* tank, int pumpID) {
+template <class Q>
+bool BasicFuelSys<Q>::findPump(Tank* tank, int pumpID) {
 	Pump* currentPump = tank->m_pumps;
 
 	while (currentPump != nullptr) {
@@ -433,7 +644,8 @@ bool FuelSys::findPump(Tank* tank, int pumpID) {
  * --------------------
  * return: Last pump in the list
  */
-Pump* FuelSys::getEndPump(Tank* tank) {
+template <class Q>
+Pump* BasicFuelSys<Q>::getEndPump(Tank* tank) {
 	Pump* currentPump = tank->m_pumps;
 
 	while (currentPump->m_next != nullptr) {
@@ -448,22 +660,31 @@ Pump* FuelSys::getEndPump(Tank* tank) {
  * -----------------
  * tankID: ID of the target tank
  * 
- * Search the tank list for the target ID and return the tank
+ * Looks the ID up in the index map instead of walking the list
  * 
  * return: The tank object if found in list, else null
  */
-Tank* FuelSys::getTank(int tankID) {
-	Tank* currentTank = m_current;
+template <class Q>
+BasicTank<Q>* BasicFuelSys<Q>::getTank(int tankID) {
+	FUEL_TIMER(STAT_GETTANK);
+	FUEL_PROBE(STAT_GETTANK, 1);
+	auto found = m_indexOf.find(tankID);
+	return found == m_indexOf.end() ? nullptr : m_byIndex[found->second];
+}
 
-	while (currentTank != nullptr) {
-		if (currentTank->m_tankID == tankID) {
-			return currentTank;
-		}
+template <class Q>
+int BasicFuelSys<Q>::indexOf(int tankID) const {
+	auto found = m_indexOf.find(tankID);
+	return found == m_indexOf.end() ? -1 : found->second;
+}
 
-		currentTank = currentTank->m_next;
+template <class Q>
+int BasicFuelSys<Q>::tankAt(int index) const {
+	if (index < 0 || index >= (int)m_byIndex.size() || m_byIndex[index] == nullptr) {
+		return -1;
 	}
 
-	return nullptr;
+	return m_byIndex[index]->m_tankID;
 }
 
 /*
@@ -476,7 +697,8 @@ Tank* FuelSys::getTank(int tankID) {
  * 
  * return: Pump object if found in the tank, else null
  */
-Pump* FuelSys::getPump(Tank* tank, int pumpID) {
+template <class Q>
+Pump* BasicFuelSys<Q>::getPump(Tank* tank, int pumpID) {
 	Pump* currentPump = tank->m_pumps;
 
 	while (currentPump != nullptr) {
@@ -490,6 +712,519 @@ Pump* FuelSys::getPump(Tank* tank, int pumpID) {
 	return nullptr;
 }
 
+/*
+ * Function: newTank
+ * -----------------
+ * tankID: ID of the new tank
+ * capacity: How much fuel the tank can hold
+ *
+ * Creates an empty tank, gives it the most recently freed index or a new one, and adds
+ * it to the level index. The caller links it into the list
+ *
+ * return: The new tank
+ */
+template <class Q>
+BasicTank<Q>* BasicFuelSys<Q>::newTank(int tankID, Q capacity) {
+	m_levels.insert(tankID, capacity, 0);
+	m_reach.addTank(tankID);
+	Tank* tank = new Tank(tankID, capacity);
+
+	if (m_freeIndices.empty()) {
+		tank->m_index = (int)m_byIndex.size();
+		m_byIndex.push_back(tank);
+	}
+	else {
+		tank->m_index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+		m_byIndex[tank->m_index] = tank;
+	}
+	m_indexOf[tankID] = tank->m_index;
+
+	return tank;
+}
+
+/*
+ * Function: freeTank
+ * ------------------
+ * tank: Tank already unlinked from the list, with no pumps of other tanks left into it
+ *
+ * Deletes the tank and its own pumps and drops it from the indexes
+ */
+template <class Q>
+void BasicFuelSys<Q>::freeTank(Tank* tank) {
+	int tankID = tank->m_tankID;
+	Pump* currentPump = tank->m_pumps;
+
+	while (currentPump != nullptr) {
+		Pump* nextPump = currentPump->m_next;
+		delete currentPump;
+		m_pumpCount--;
+		currentPump = nextPump;
+	}
+
+	m_levels.erase(tankID, tank->m_tankCapacity, tank->m_tankFuel);
+	m_reach.removeTank(tankID);
+	m_byIndex[tank->m_index] = nullptr;
+	m_freeIndices.push_back(tank->m_index);
+	m_indexOf.erase(tankID);
+	m_alarms.unwatch(tankID);
+	if (m_feed != nullptr) {
+		m_feed->record(tankID, tank->m_tankFuel, 0, REMOVECHANGE);
+	}
+	delete tank;
+}
+
+/*
+ * Function: clearTanks
+ * --------------------
+ * keep: System whose tank IDs keep their alarms and feed entries, nullptr for none
+ *
+ * Deletes every tank and pump in one walk of the list and empties the indexes once,
+ * where removing the tanks one at a time sweeps every pump once per tank. A tank not
+ * kept leaves the change feed as a removal and its alarm is dropped
+ */
+template <class Q>
+void BasicFuelSys<Q>::clearTanks(const BasicFuelSys* keep) {
+	while (m_current != nullptr) {
+		Tank* tank = m_current;
+		Pump* currentPump = tank->m_pumps;
+		m_current = tank->m_next;
+
+		while (currentPump != nullptr) {
+			Pump* nextPump = currentPump->m_next;
+			delete currentPump;
+			currentPump = nextPump;
+		}
+
+		if (keep == nullptr || keep->indexOf(tank->m_tankID) < 0) {
+			m_alarms.unwatch(tank->m_tankID);
+			if (m_feed != nullptr) {
+				m_feed->record(tank->m_tankID, tank->m_tankFuel, 0, REMOVECHANGE);
+			}
+		}
+		delete tank;
+	}
+
+	m_pumpCount = 0;
+	m_levels.clear();
+	m_reach.clear();
+	m_byIndex.clear();
+	m_freeIndices.clear();
+	m_indexOf.clear();
+}
+
+/*
+ * Function: newPump
+ * -----------------
+ * tankID: Tank the pump belongs to
+ * pumpID: ID of the new pump
+ * target: Tank the pump drains to
+ *
+ * Creates a pump and adds it to the reachability index. The target must exist. The caller
+ * links the pump into the tank's list
+ *
+ * return: The new pump
+ */
+template <class Q>
+Pump* BasicFuelSys<Q>::newPump(int tankID, int pumpID, int target) {
+	m_reach.addEdge(tankID, target);
+	m_pumpCount++;
+	return new Pump(pumpID, m_indexOf[target]);
+}
+
+/*
+ * Function: setFuel
+ * -----------------
+ * tank: Tank whose level changes
+ * fuel: New amount of fuel in the tank
+ * cause: What changed it, for the change feed
+ *
+ * Every change to a tank's level goes through here so the level index, change feed and alarms stay current
+ */
+template <class Q>
+void BasicFuelSys<Q>::setFuel(Tank* tank, Q fuel, CHANGE cause) {
+	if (fuel == tank->m_tankFuel) {
+		return;
+	}
+	m_levels.update(tank->m_tankID, tank->m_tankCapacity, tank->m_tankFuel, fuel);
+	if (m_feed != nullptr) {
+		m_feed->record(tank->m_tankID, tank->m_tankFuel, fuel, cause);
+	}
+	tank->m_tankFuel = fuel;
+	if (!m_alarms.empty()) {
+		m_alarms.check(tank->m_tankID, toKg(fuel) / toKg(tank->m_tankCapacity));
+	}
+}
+
+/*
+ * Function: resizeTank
+ * --------------------
+ * tank: Tank whose capacity changes
+ * capacity: New capacity, the caller checks it
+ *
+ * The fill ratio moves with the capacity, so the level index and alarms are updated as for a level change
+ */
+template <class Q>
+void BasicFuelSys<Q>::resizeTank(Tank* tank, Q capacity) {
+	m_levels.erase(tank->m_tankID, tank->m_tankCapacity, tank->m_tankFuel);
+	tank->m_tankCapacity = capacity;
+	m_levels.insert(tank->m_tankID, tank->m_tankCapacity, tank->m_tankFuel);
+	if (!m_alarms.empty()) {
+		m_alarms.check(tank->m_tankID, toKg(tank->m_tankFuel) / toKg(capacity));
+	}
+}
+
+/*
+ * Function: tanksByFill
+ * ---------------------
+ * low, high: Bounds of the fill ratio, 0.1 is 10% full
+ *
+ * return: IDs of the tanks in range, emptiest first
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::tanksByFill(double low, double high) const {
+	return m_levels.byRatio(low, high);
+}
+
+/*
+ * Function: emptiestTanks
+ * -----------------------
+ * return: IDs of the k tanks with the lowest fill ratio, emptiest first
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::emptiestTanks(int k) const {
+	return m_levels.emptiest(k);
+}
+
+/*
+ * Function: fullestTanks
+ * ----------------------
+ * return: IDs of the k tanks with the highest fill ratio, fullest first
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::fullestTanks(int k) const {
+	return m_levels.fullest(k);
+}
+
+/*
+ * Function: tanksWithSpace
+ * ------------------------
+ * return: IDs of the tanks with at least space free, least free space first
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::tanksWithSpace(Q space) const {
+	return m_levels.withSpace(space);
+}
+
+/*
+ * Function: mostSpaceTanks
+ * ------------------------
+ * return: IDs of the k tanks with the most free space, most first
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::mostSpaceTanks(int k) const {
+	return m_levels.mostSpace(k);
+}
+
+/*
+ * Function: canReach
+ * ------------------
+ * sourceID: Tank fuel starts in
+ * targetID: Tank fuel should end up in
+ *
+ * return: True if both tanks exist and a chain of pumps leads from source to target, or
+ * they are the same tank whether or not it is on a cycle
+ */
+template <class Q>
+bool BasicFuelSys<Q>::canReach(int sourceID, int targetID) const {
+	return m_reach.reachable(sourceID, targetID);
+}
+
+/*
+ * Function: sameComponent
+ * -----------------------
+ * return: True if fuel can flow from each tank to the other
+ */
+template <class Q>
+bool BasicFuelSys<Q>::sameComponent(int firstID, int secondID) const {
+	return m_reach.sameComponent(firstID, secondID);
+}
+
+/*
+ * Function: isolatedTanks
+ * -----------------------
+ * return: IDs of the tanks no pump drains from or into, in increasing order
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::isolatedTanks() const {
+	return m_reach.isolated();
+}
+
+/*
+ * Function: hasCycle
+ * ------------------
+ * return: True if fuel can be pumped around a loop back into a tank
+ */
+template <class Q>
+bool BasicFuelSys<Q>::hasCycle() const {
+	return m_reach.hasCycle();
+}
+
+/*
+ * Function: pumpCycles
+ * --------------------
+ * return: Each group of tanks that can all pump into each other, ordered by smallest ID
+ */
+template <class Q>
+std::vector<std::vector<int>> BasicFuelSys<Q>::pumpCycles() const {
+	return m_reach.cycles();
+}
+
+/*
+ * Function: drainOrder
+ * --------------------
+ * Tanks without pumps come last
+ *
+ * return: IDs of the tanks on no cycle, each before every tank it can pump into
+ */
+template <class Q>
+std::vector<int> BasicFuelSys<Q>::drainOrder() const {
+	return m_reach.topologicalOrder();
+}
+
+/*
+ * Function: cascadeDrain
+ * ----------------------
+ * steps: Drains to run, each clamped like drain
+ *
+ * Orders the steps by the drain order of their source tank, keeping the given order
+ * for steps from the same tank, so fuel moved into a tank is there before it is drained
+ * onwards. The tanks are resolved in one walk of the list. Nothing is drained unless
+ * every step names an existing pump with a non-negative amount and no source or target
+ * is on a cycle
+ *
+ * return: True if the cascade ran
+ */
+template <class Q>
+bool BasicFuelSys<Q>::cascadeDrain(const std::vector<DrainStep>& steps) {
+	FUEL_TIMER(STAT_CASCADE);
+	struct Resolved {
+		int rank;
+		Tank* source;
+		Tank* target;
+		Q fuel;
+	};
+
+	std::unordered_map<int, int> rank;
+	std::vector<int> order = m_reach.topologicalOrder();
+	for (int i = 0; i < (int)order.size(); i++) {
+		rank[order[i]] = i;
+	}
+
+	std::unordered_map<int, Tank*> tanks;
+	for (Tank* tank = m_current; tank != nullptr; tank = tank->m_next) {
+		tanks[tank->m_tankID] = tank;
+	}
+
+	std::vector<Resolved> resolved;
+	for (const DrainStep& step : steps) {
+		auto source = tanks.find(step.tankID);
+		if (step.fuel < 0 || source == tanks.end()) {
+			return false;
+		}
+
+		Pump* pump = getPump(source->second, step.pumpID);
+		if (pump == nullptr) {
+			return false;
+		}
+
+		auto sourceRank = rank.find(step.tankID);
+		if (sourceRank == rank.end() || rank.count(targetID(pump)) == 0) {
+			return false;
+		}
+
+		resolved.push_back(Resolved{ sourceRank->second, source->second, targetOf(pump), step.fuel });
+	}
+
+	std::stable_sort(resolved.begin(), resolved.end(), [](const Resolved& a, const Resolved& b) {
+		return a.rank < b.rank;
+	});
+
+	for (const Resolved& step : resolved) {
+		Q fuel = step.fuel;
+		if (fuel > step.source->m_tankFuel) {
+			FUEL_EVENT(STAT_SOURCECLAMP);
+			fuel = step.source->m_tankFuel;
+		}
+
+		Q neededFuel = step.target->m_tankCapacity - step.target->m_tankFuel;
+		if (fuel > neededFuel) {
+			FUEL_EVENT(STAT_DESTCLAMP);
+			fuel = neededFuel;
+		}
+
+		setFuel(step.source, step.source->m_tankFuel - fuel, DRAINCHANGE);
+		setFuel(step.target, step.target->m_tankFuel + fuel, DRAINCHANGE);
+	}
+
+	return true;
+}
+
+/*
+ * Function: rebalance
+ * -------------------
+ * tankIDs: Tanks to level out, only pumps between them are used
+ * weights: Share of the total for each tank, empty to share it by capacity so every tank
+ *          ends at the same fill ratio
+ * transfers: Receives the transfers made if set, each tank's inflows before its outflows
+ *
+ * Shares are rounded down to whole units and the remainder goes one unit each to the
+ * tanks with the largest fractions. BalanceFlow plans the transfers over the pumps, and
+ * each tank is then set to its share once, so a tank that passes fuel on is never
+ * briefly over capacity or empty and the feed and alarms see one change per tank
+ *
+ * return: True if every tank now holds its share. False with nothing moved if a tank is
+ * missing or repeated, the weights are invalid, a share exceeds its tank's capacity, or
+ * some surplus cannot reach a tank short of its share
+ */
+template <class Q>
+bool BasicFuelSys<Q>::rebalance(std::span<const int> tankIDs, std::span<const double> weights,
+	std::vector<DrainStep>* transfers) {
+	FUEL_TIMER(STAT_REBALANCE);
+	int size = (int)tankIDs.size();
+	if (!weights.empty() && (int)weights.size() != size) {
+		return false;
+	}
+
+	std::vector<Tank*> group(size);
+	std::vector<long double> weight(size);
+	std::unordered_map<int, int> local; // tank index to position in the group
+	long long total = 0;
+	long double weightSum = 0;
+
+	for (int i = 0; i < size; i++) {
+		Tank* tank = getTank(tankIDs[i]);
+		if (tank == nullptr || !local.insert({ tank->m_index, i }).second) {
+			return false;
+		}
+		weight[i] = weights.empty() ? toKg(tank->m_tankCapacity) : weights[i];
+		if (!(weight[i] >= 0) || std::isinf(weight[i])) {
+			return false;
+		}
+		group[i] = tank;
+		total += toUnits(tank->m_tankFuel);
+		weightSum += weight[i];
+	}
+
+	if (size == 0) {
+		return true;
+	}
+	if (weightSum <= 0) {
+		return false;
+	}
+
+	std::vector<long long> share(size);
+	std::vector<std::pair<long double, int>> fractions(size);
+	long long remainder = total;
+
+	for (int i = 0; i < size; i++) {
+		long double exact = total * weight[i] / weightSum;
+		long long capacity = toUnits(group[i]->m_tankCapacity);
+		if (exact >= capacity + 1) {
+			return false;
+		}
+		share[i] = std::min((long long)exact, capacity);
+		fractions[i] = { share[i] - exact, i };
+		remainder -= share[i];
+	}
+
+	//Largest fractions first. Rounding error can leave the remainder a little off either way,
+	//so a negative one is taken back from the smallest fractions
+	std::sort(fractions.begin(), fractions.end());
+	while (remainder != 0) {
+		bool placed = false;
+		for (int k = 0; k < size && remainder != 0; k++) {
+			if (remainder > 0) {
+				int i = fractions[k].second;
+				if (share[i] < toUnits(group[i]->m_tankCapacity)) {
+					share[i]++;
+					remainder--;
+					placed = true;
+				}
+			}
+			else {
+				int i = fractions[size - 1 - k].second;
+				if (share[i] > 0) {
+					share[i]--;
+					remainder++;
+					placed = true;
+				}
+			}
+		}
+		if (!placed) {
+			return false;
+		}
+	}
+
+	BalanceFlow flow(size);
+	for (int i = 0; i < size; i++) {
+		flow.setExcess(i, toUnits(group[i]->m_tankFuel) - share[i]);
+		for (Pump* pump = group[i]->m_pumps; pump != nullptr; pump = pump->m_next) {
+			auto target = local.find(pump->m_target);
+			if (target != local.end()) {
+				flow.addPump(i, target->second, pump->m_pumpID);
+			}
+		}
+	}
+
+	std::vector<BalanceFlow::Transfer> plan;
+	if (!flow.solve(plan)) {
+		return false;
+	}
+
+	for (int i = 0; i < size; i++) {
+		Q fuel = fromUnits<Q>(share[i]);
+		if (fuel != group[i]->m_tankFuel) {
+			setFuel(group[i], fuel, DRAINCHANGE);
+		}
+	}
+
+	if (transfers != nullptr) {
+		transfers->clear();
+		for (const BalanceFlow::Transfer& transfer : plan) {
+			transfers->push_back(DrainStep{ group[transfer.from]->m_tankID, transfer.pumpID, fromUnits<Q>(transfer.amount) });
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Function: setAlarm
+ * ------------------
+ * tankID: Tank to watch
+ * low, high: Fill ratios that raise the low and high alarms
+ * hysteresis: How far back past a threshold the ratio must go to clear the alarm
+ *
+ * The current level is checked at once, so a tank already past a threshold raises its alarm here
+ *
+ * return: True if the tank exists and the thresholds are valid
+ */
+template <class Q>
+bool BasicFuelSys<Q>::setAlarm(int tankID, double low, double high, double hysteresis) {
+	Tank* tank = getTank(tankID);
+	if (tank == nullptr) {
+		return false;
+	}
+
+	return m_alarms.watch(tankID, low, high, hysteresis, toKg(tank->m_tankFuel) / toKg(tank->m_tankCapacity));
+}
+
+template <class Q>
+bool BasicFuelSys<Q>::clearAlarm(int tankID) {
+	return m_alarms.unwatch(tankID);
+}
+
 /*
  * Function: totalFuel
  * -------------------
@@ -497,9 +1232,11 @@ Pump* FuelSys::getPump(Tank* tank, int pumpID) {
  * 
  * return: The total fuel in the system
  */
-int FuelSys::totalFuel() const {
+template <class Q>
+typename BasicFuelSys<Q>::Wide BasicFuelSys<Q>::totalFuel() const {
+	FUEL_TIMER(STAT_TOTALFUEL);
 	Tank* currentTank = m_current;
-	int totalFuel = 0;
+	Wide totalFuel = 0;
 
 	while (currentTank != nullptr) {
 		totalFuel += currentTank->m_tankFuel;
@@ -509,12 +1246,46 @@ int FuelSys::totalFuel() const {
 	return totalFuel;
 }
 
+/*
+ * Function: memoryUsage
+ * ---------------------
+ * Tanks are counted by the level index and pumps by m_pumpCount, each node a separate
+ * allocation. The indexes report their own containers
+ *
+ * return: Bytes held by the system and its indexes, not counting a change feed it reports to
+ */
+template <class Q>
+MemoryUsage BasicFuelSys<Q>::memoryUsage() const {
+	MemoryUsage usage = MemoryUsage{};
+	HeapBytes tanks, pumps, levels, reach, alarms, ids;
+
+	tanks.nodes(m_levels.size(), sizeof(Tank));
+	pumps.nodes(m_pumpCount, sizeof(Pump));
+	m_levels.memory(levels);
+	m_reach.memory(reach);
+	m_alarms.memory(alarms);
+	ids.vector(m_byIndex);
+	ids.vector(m_freeIndices);
+	ids.hash(m_indexOf);
+
+	usage.system = sizeof(*this);
+	usage.tanks = tanks.used;
+	usage.pumps = pumps.used;
+	usage.levels = levels.used;
+	usage.reach = reach.used;
+	usage.alarms = alarms.used;
+	usage.ids = ids.used;
+	usage.slack = tanks.slack + pumps.slack + levels.slack + reach.slack + alarms.slack + ids.slack;
+	return usage;
+}
+
 /*
  * Function: dumpSys
  * -----------------
  * Outputs the list of tanks and their info
  */
-void FuelSys::dumpSys() const {
+template <class Q>
+void BasicFuelSys<Q>::dumpSys() const {
 	Tank* currentTank = m_current;
 
 	cout << "Tank List:\n";
@@ -535,9 +1306,14 @@ void FuelSys::dumpSys() const {
  * 
  * Outputs the list of pumps and their target tanks
  */
-void FuelSys::dumpPumps(Pump* pumps) const {
+template <class Q>
+void BasicFuelSys<Q>::dumpPumps(Pump* pumps) const {
 	while (pumps != nullptr) {
-		cout << "Pumps: " << pumps->m_pumpID << " Target Tank: " << pumps->m_target << "\n";
+		cout << "Pumps: " << pumps->m_pumpID << " Target Tank: " << targetID(pumps) << "\n";
 		pumps = pumps->m_next;
 	}
-}
\ No newline at end of file
+}
+
+template class BasicFuelSys<int>;
+template class BasicFuelSys<long long>;
+template class BasicFuelSys<Grams>;
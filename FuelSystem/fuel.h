@@ -2,6 +2,16 @@
 #ifndef FUEL_H
 #define FUEL_H
 #include <iostream>
+#include "quantity.h"
+#include "level.h"
+#include "reach.h"
+#include "changes.h"
+#include "alarm.h"
+#include "memory.h"
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 using namespace std;
 // default capacity of a tank in kg
 const int MINCAP = 2000;
@@ -9,29 +19,64 @@ const int DEFCAP = 5000;
 class Grader;//this class is for grading purposes, no need to do anything
 class Tester;//this is your tester class, you add your test functions in this class
 class Pump;  //forward declaration
-class FuelSys;//forward declaration
-class Tank {
+template <class Q> class BasicFuelSys;//forward declaration
+class FlowSim;//time-stepped simulation engine
+class EventSim;//discrete-event simulation engine
+class MonteCarlo;//parallel scenario runner
+class Bench;//benchmark driver, builds large systems directly
+class RefillPlanner;//batched delivery planner
+class SnapshotPublisher;//publishes copies for concurrent readers
+class ShardedFuelSys;//plant split across shard threads
+class TransferScheduler;//coroutine transfers over simulated time
+class SysDiff;//diff and patch between two systems
+class Fuzz;//differential fuzz target over every storage mode
+// Tanks and the system are templated on the fuel quantity type Q: int (the
+// default), long long for very large plants, or Grams for gram precision
+template <class Q = int>
+class BasicTank {
 public:
     friend class Tester;
-    friend class FuelSys;
-    Tank();
-    Tank(int ID, int tankCap, int tankFuel = 0,
-        Pump* pumpList = nullptr, Tank* nextTank = nullptr)
+    template <class> friend class BasicFuelSys;
+    friend class FlowSim;
+    friend class EventSim;
+    friend class MonteCarlo;
+    friend class Bench;
+    friend class RefillPlanner;
+    friend class SnapshotPublisher;
+    friend class ShardedFuelSys;
+    friend class TransferScheduler;
+    friend class SysDiff;
+    friend class Fuzz;
+    BasicTank();
+    BasicTank(int ID, Q tankCap, Q tankFuel = 0,
+        Pump* pumpList = nullptr, BasicTank* nextTank = nullptr)
     {
-        m_tankID = ID; m_tankCapacity = tankCap; m_tankFuel = tankFuel;
+        m_tankID = ID; m_index = -1; m_tankCapacity = tankCap; m_tankFuel = tankFuel;
         m_pumps = pumpList; m_next = nextTank;
     }
 private:
     int m_tankID;
-    int m_tankCapacity; // maximum capacity of the tank
-    int m_tankFuel;     // current amount of fuel in the tank
+    int m_index;      // slot in the system's tank table
+    Q m_tankCapacity; // maximum capacity of the tank
+    Q m_tankFuel;     // current amount of fuel in the tank
     Pump* m_pumps;
-    Tank* m_next;
+    BasicTank* m_next;
 };
+// pumps hold no fuel, so they are the same for every quantity type
 class Pump {
 public:
     friend class Tester;
-    friend class FuelSys;
+    template <class> friend class BasicFuelSys;
+    friend class FlowSim;
+    friend class EventSim;
+    friend class MonteCarlo;
+    friend class Bench;
+    friend class RefillPlanner;
+    friend class SnapshotPublisher;
+    friend class ShardedFuelSys;
+    friend class TransferScheduler;
+    friend class SysDiff;
+    friend class Fuzz;
     Pump();
     Pump(int ID, int target, Pump* nextPump = nullptr) {
         m_pumpID = ID; m_target = target;
@@ -39,43 +84,140 @@ public:
     }
 private:
     int m_pumpID;
-    int m_target; // ID of the target tank for transfer
+    int m_target; // index of the target tank in the system's tank table
     Pump* m_next;
 };
-class FuelSys {
+template <class Q = int>
+class BasicFuelSys {
 public:
     friend class Tester;
     friend class Grader;
-    FuelSys();
-    ~FuelSys();
-    // overloaded assignment operator
-    const FuelSys& operator=(const FuelSys& rhs);
+    friend class FlowSim;
+    friend class EventSim;
+    friend class MonteCarlo;
+    friend class Bench;
+    friend class RefillPlanner;
+    friend class SnapshotPublisher;
+    friend class ShardedFuelSys;
+    friend class TransferScheduler;
+    friend class SysDiff;
+    friend class Fuzz;
+    typedef BasicTank<Q> Tank;
+    typedef typename FuelTraits<Q>::Wide Wide; // accumulator for sums over tanks
+    // one drain of a cascade
+    struct DrainStep {
+        int tankID;
+        int pumpID;
+        Q fuel;
+    };
+    BasicFuelSys();
+    ~BasicFuelSys();
+    // overloaded assignment operator; tanks whose IDs are also in rhs keep their alarms and
+    // report one level change to the feed, the others are reported removed and lose their alarms
+    const BasicFuelSys& operator=(const BasicFuelSys& rhs);
     // add to the tank list
-    bool addTank(int tankID, int capacity);
+    bool addTank(int tankID, Q capacity);
     // remove from the tank list
     bool removeTank(int tankID);
     // add pump to the pump list of the tank
     bool addPump(int tankID, int pumpID, int targetTank);
     // remove from the pump list of the tank
     bool removePump(int tankID, int pumpID);
+    // remove every listed tank and the pumps into them in one sweep, return how many were removed
+    int removeTanks(std::span<const int> tankIDs);
+    // remove every listed (tank ID, pump ID) pump, each tank's list walked once, return how many were removed
+    int removePumps(std::span<const std::pair<int, int>> pumps);
     // fill the tank with fuel
-    bool fill(int tankID, int fuel);
+    bool fill(int tankID, Q fuel);
     // transfer fuel from the tank through the pump
-    bool drain(int tankID, int pumpID, int fuel);
+    bool drain(int tankID, int pumpID, Q fuel);
+    // change how much the tank holds, false if below MINCAP or the fuel already in it
+    bool setCapacity(int tankID, Q capacity);
     // if the ID is found, it must become the next of current
     bool findTank(int tankID);
     // return the sum of fuel in all tanks
-    int totalFuel() const;
+    Wide totalFuel() const;
+    // IDs of tanks with fill ratio in [low, high], emptiest first
+    std::vector<int> tanksByFill(double low, double high) const;
+    // IDs of the k emptiest tanks by fill ratio
+    std::vector<int> emptiestTanks(int k) const;
+    // IDs of the k fullest tanks by fill ratio
+    std::vector<int> fullestTanks(int k) const;
+    // IDs of tanks with at least space free, least free space first
+    std::vector<int> tanksWithSpace(Q space) const;
+    // IDs of the k tanks with the most free space
+    std::vector<int> mostSpaceTanks(int k) const;
+    // true if fuel in the source tank can reach the target through one or more pumps, or they
+    // are the same existing tank, even one with no pumps
+    bool canReach(int sourceID, int targetID) const;
+    // true if fuel can flow both ways between the tanks
+    bool sameComponent(int firstID, int secondID) const;
+    // IDs of tanks with no pumps in or out
+    std::vector<int> isolatedTanks() const;
+    // true if fuel can be pumped around a loop back into a tank
+    bool hasCycle() const;
+    // groups of tanks that pump into each other, each sorted by ID
+    std::vector<std::vector<int>> pumpCycles() const;
+    // IDs of tanks on no cycle, every tank before the tanks it pumps into
+    std::vector<int> drainOrder() const;
+    // run the drains with each source after the tanks that feed it, fails if a step is invalid or on a cycle
+    bool cascadeDrain(const std::vector<DrainStep>& steps);
+    // move fuel over the pumps between the tanks so each holds its share of their total, by
+    // capacity (equal fill ratio) or by weight. Nothing moves and it returns false if a share
+    // does not fit its tank or cannot be reached. The transfers, inflows first, go to transfers
+    bool rebalance(std::span<const int> tankIDs, std::span<const double> weights = {},
+        std::vector<DrainStep>* transfers = nullptr);
+    // report every level change to the feed, nullptr to stop
+    void setFeed(ChangeFeed<Q>* feed) { m_feed = feed; }
+    // raise alarms when the tank's fill ratio reaches low or high, false if the tank or bounds are invalid
+    bool setAlarm(int tankID, double low, double high, double hysteresis = 0.0);
+    // stop watching the tank
+    bool clearAlarm(int tankID);
+    // alarms are passed to the callback instead of queued
+    void onAlarm(std::function<void(const Alarm&)> callback) { m_alarms.onAlarm(callback); }
+    // queued alarms, oldest first
+    std::vector<Alarm> takeAlarms() { return m_alarms.take(); }
+    // bytes held per component, from counters and container sizes without walking the lists
+    MemoryUsage memoryUsage() const;
+    // Every tank has a dense index in [0, indexBound()) while it exists. A
+    // removed tank's index is handed to a later tank, so per-tank arrays
+    // sized to indexBound() can be indexed directly
+    int indexOf(int tankID) const;
+    // ID of the tank at the index, -1 if the index is free
+    int tankAt(int index) const;
+    int indexBound() const { return (int)m_byIndex.size(); }
     // the dump function is provided to facilitate debugging
     // using dump function for test cases is not accepted
     void dumpSys() const;
     void dumpPumps(Pump* pumps) const;
 private:
     Tank* m_current;
+    LevelIndex<Q> m_levels; // tanks ordered by fill ratio and free space
+    ReachIndex m_reach;     // reachability over the pump graph
+    ChangeFeed<Q>* m_feed;  // level changes are streamed here if set
+    AlarmIndex m_alarms;    // fill-ratio thresholds per tank
+    size_t m_pumpCount;     // pumps in every tank's list
+    std::vector<Tank*> m_byIndex;          // tank table, nullptr at free indices
+    std::vector<int> m_freeIndices;        // free indices, reused last freed first
+    std::unordered_map<int, int> m_indexOf; // tank ID to index
+    Tank* newTank(int tankID, Q capacity);
+    Pump* newPump(int tankID, int pumpID, int target);
+    void freeTank(Tank* tank);
+    void clearTanks(const BasicFuelSys* keep = nullptr);
+    void setFuel(Tank* tank, Q fuel, CHANGE cause);
+    void resizeTank(Tank* tank, Q capacity);
+    bool fillTank(int tankID, Q fuel, CHANGE cause);
     Tank* getEndTank(int tankID);
     Tank* getTank(int tankID);
+    // the tank a pump drains into, one array access
+    Tank* targetOf(const Pump* pump) const { return m_byIndex[pump->m_target]; }
+    int targetID(const Pump* pump) const { return m_byIndex[pump->m_target]->m_tankID; }
     Pump* getPump(Tank* tank, int pumpID);
     Pump* getEndPump(Tank* tank);
     bool findPump(Tank* tank, int pumpID);
 };
-#endif
\ No newline at end of file
+typedef BasicTank<int> Tank;
+typedef BasicFuelSys<int> FuelSys;
+typedef BasicFuelSys<long long> FuelSys64;
+typedef BasicFuelSys<Grams> FuelSysGrams;
+#endif
@@ -0,0 +1,694 @@
+#include "fuel.h"
+#include "command.h"
+#include "compact.h"
+#include "staticfuel.h"
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Differential fuzz target: FuelSys is the reference and every other storage
+// mode must give the same result for each call and hold the same total. An
+// input is a list of 4-byte calls (kind, tank, pump or target, amount), so
+// any byte string is a valid test case and libFuzzer mutations stay meaningful.
+//
+// The batch and group calls only the FuelSys types have (removeTanks,
+// removePumps, setCapacity, rebalance, cascadeDrain and operator=) are
+// checked against a plain model of the reference's tanks, worked out one
+// tank and pump at a time. CompactFuelSys and StaticFuelSys make the
+// removals one call at a time and are rebuilt from the model after the rest.
+//
+// Build with -DFUEL_LIBFUZZER -fsanitize=fuzzer for libFuzzer, otherwise main
+// runs random inputs for a number of seconds or replays saved inputs.
+
+const int FUZZTANKS = 32;   // tank IDs 0 to 31 plus a few edge IDs
+const int HOTTANKS = 8;     // most calls name tanks 0 to 7, so pumps between them build up
+const int FUZZPUMPS = 5;    // pump IDs -1 to 3
+const int FINDTANK = DRAINTANK + 1;
+const int REMOVETANKS = FINDTANK + 1;
+const int REMOVEPUMPS = REMOVETANKS + 1;
+const int SETCAPACITY = REMOVEPUMPS + 1;
+const int REBALANCE = SETCAPACITY + 1;
+const int CASCADE = REBALANCE + 1;
+const int ASSIGN = CASCADE + 1;
+const int KINDS = ASSIGN + 1;
+const int BATCHBYTES = 208; // kind bytes from here on pick the calls above FINDTANK, so tanks outlive them
+//Every tank ID the decoder can produce, so the static system never runs out of room
+const int EDGETANKS = 2;
+static const int EDGEIDS[EDGETANKS + 1] = { -1, 1000000, INT_MAX };
+typedef StaticFuelSys<FUZZTANKS + EDGETANKS, (FUZZTANKS + EDGETANKS) * FUZZPUMPS> FixedFuelSys;
+
+static const char* const KINDNAMES[KINDS] = { "addTank", "removeTank", "addPump", "removePump", "fill", "drain", "findTank",
+    "removeTanks", "removePumps", "setCapacity", "rebalance", "cascadeDrain", "operator=" };
+
+class Fuzz {
+public:
+    /*
+     * Function: run
+     * -------------
+     * data, size: One input, trailing bytes that do not make a whole call are ignored
+     *
+     * Applies every call to all systems on fresh copies, checking after each one that the
+     * results and totals agree and that fuel is conserved: a drain never changes the total,
+     * a fill adds at most the amount asked for, and pump changes leave it alone
+     *
+     * return: True if every property held, otherwise the failure is in message()
+     */
+    bool run(const uint8_t* data, size_t size) {
+        Systems systems;
+        FuelSys& reference = systems.reference;
+        long long total = 0;
+
+        for (size_t i = 0; i + 4 <= size; i += 4) {
+            int kind = data[i] < BATCHBYTES ? data[i] % (FINDTANK + 1) : FINDTANK + 1 + data[i] % (KINDS - FINDTANK - 1);
+            Command command = decode(kind, data + i);
+            bool expected = false;
+            bool results[4];
+
+            if (kind > FINDTANK) {
+                string wrong = batch(kind, command, systems, expected);
+                if (!wrong.empty()) {
+                    return fail(i / 4, kind, command, wrong);
+                }
+            }
+            else {
+                if (kind == FINDTANK) {
+                    expected = reference.findTank(command.tankID);
+                    results[0] = systems.wide.findTank(command.tankID);
+                    results[1] = systems.grams.findTank(command.tankID);
+                    results[2] = systems.compact.findTank(command.tankID);
+                    results[3] = systems.fixed.findTank(command.tankID);
+                }
+                else {
+                    expected = applyCommand(reference, command);
+                    results[0] = applyCommand(systems.wide, command);
+                    results[1] = applyCommand(systems.grams, command);
+                    results[2] = applyCommand(systems.compact, command);
+                    results[3] = applyCommand(systems.fixed, command);
+                }
+
+                const char* names[4] = { "FuelSys64", "FuelSysGrams", "CompactFuelSys", "StaticFuelSys" };
+                for (int j = 0; j < 4; j++) {
+                    if (results[j] != expected) {
+                        return fail(i / 4, kind, command, string(names[j]) + " returned " + (results[j] ? "true" : "false"));
+                    }
+                }
+            }
+            m_calls++;
+
+            long long after = reference.totalFuel();
+            if (systems.wide.totalFuel() != after || systems.grams.totalFuel() != Grams(after)
+                || systems.compact.totalFuel() != after || systems.fixed.totalFuel() != after) {
+                return fail(i / 4, kind, command, "totals differ from " + std::to_string(after));
+            }
+
+            long long added = after - total;
+            bool conserved = true;
+            if (kind == FILLTANK) {
+                conserved = added >= 0 && (added == 0 || (expected && added <= command.amount));
+            }
+            else if (kind == REMOVETANK || kind == REMOVETANKS) {
+                conserved = added <= 0 && (expected || added == 0);
+            }
+            else {
+                conserved = added == 0;
+            }
+            if (!conserved) {
+                return fail(i / 4, kind, command, "total went from " + std::to_string(total) + " to " + std::to_string(after));
+            }
+            total = after;
+        }
+
+        return true;
+    }
+
+    const string& message() const { return m_message; }
+    long long calls() const { return m_calls; }
+
+private:
+    // every storage mode, each given the same calls
+    struct Systems {
+        FuelSys reference;
+        FuelSys64 wide;
+        FuelSysGrams grams;
+        CompactFuelSys compact;
+        FixedFuelSys fixed;
+        FuelSys scratch; // operator= copies the reference here and back
+    };
+    // a tank as the model keeps it, amounts in the system's smallest unit
+    struct ModelTank {
+        long long capacity;
+        long long fuel;
+        std::vector<std::pair<int, int>> pumps; // pump ID and target ID, in list order
+        bool operator==(const ModelTank& rhs) const = default;
+    };
+    typedef std::map<int, ModelTank> Model;
+
+    string m_message;
+    long long m_calls = 0;
+
+    /*
+     * Function: batch
+     * ---------------
+     * kind: One of the calls only the FuelSys types have
+     * changed: Set to whether the call reported doing anything
+     *
+     * Works out the call's result and the tanks after it on a model of the reference,
+     * makes the call on every FuelSys type and checks each against the model. The
+     * other storage modes make a removal one tank or pump at a time and are rebuilt
+     * from the model after any other call that changed something
+     *
+     * return: Empty if everything agreed, otherwise what did not
+     */
+    string batch(int kind, const Command& command, Systems& systems, bool& changed) {
+        Model model = capture(systems.reference);
+        int count = 0;
+        bool rebuilt = false;
+        string wrong;
+
+        if (kind == REMOVETANKS) {
+            std::vector<int> tankIDs = { command.tankID, command.target, command.tankID };
+            for (int tankID : tankIDs) {
+                count += (int)model.erase(tankID);
+            }
+            for (auto& [tankID, tank] : model) {
+                std::erase_if(tank.pumps, [&](const std::pair<int, int>& pump) { return model.count(pump.second) == 0; });
+            }
+
+            int removed[5] = { systems.reference.removeTanks(tankIDs), systems.wide.removeTanks(tankIDs),
+                systems.grams.removeTanks(tankIDs), 0, 0 };
+            for (int tankID : tankIDs) {
+                removed[3] += systems.compact.removeTank(tankID);
+                removed[4] += systems.fixed.removeTank(tankID);
+            }
+            wrong = counted(removed, count);
+        }
+        else if (kind == REMOVEPUMPS) {
+            //The call's pump twice, then every pump of a tank that has some so whole lists go too
+            std::vector<std::pair<int, int>> pumps = { { command.tankID, command.pumpID }, { command.tankID, command.pumpID } };
+            int target = withPumps(model, command.target);
+            if (model.count(target) != 0) {
+                for (const std::pair<int, int>& pump : model[target].pumps) {
+                    pumps.push_back({ target, pump.first });
+                }
+            }
+            for (const std::pair<int, int>& pump : pumps) {
+                auto tank = model.find(pump.first);
+                if (tank != model.end()) {
+                    count += (int)std::erase_if(tank->second.pumps, [&](const std::pair<int, int>& own) { return own.first == pump.second; });
+                }
+            }
+
+            int removed[5] = { systems.reference.removePumps(pumps), systems.wide.removePumps(pumps),
+                systems.grams.removePumps(pumps), 0, 0 };
+            for (const std::pair<int, int>& pump : pumps) {
+                removed[3] += systems.compact.removePump(pump.first, pump.second);
+                removed[4] += systems.fixed.removePump(pump.first, pump.second);
+            }
+            wrong = counted(removed, count);
+        }
+        else if (kind == SETCAPACITY) {
+            auto tank = model.find(command.tankID);
+            count = tank != model.end() && command.amount >= MINCAP && command.amount >= tank->second.fuel;
+            if (count != 0) {
+                tank->second.capacity = command.amount;
+            }
+
+            bool results[3] = { systems.reference.setCapacity(command.tankID, command.amount),
+                systems.wide.setCapacity(command.tankID, command.amount), systems.grams.setCapacity(command.tankID, command.amount) };
+            wrong = agreed(results, count != 0);
+            rebuilt = count != 0;
+        }
+        else if (kind == REBALANCE) {
+            wrong = rebalance(command, systems, model, count);
+            rebuilt = count != 0;
+        }
+        else if (kind == CASCADE) {
+            wrong = cascade(command, systems, model, count);
+            rebuilt = count != 0;
+        }
+        else {
+            systems.scratch = systems.reference;
+            wrong = verify(systems.scratch, model);
+            if (!wrong.empty()) {
+                return "copy: " + wrong;
+            }
+            //Every tank of the reference is kept, so nothing may change
+            systems.reference = systems.scratch;
+            count = 1;
+        }
+
+        if (wrong.empty()) {
+            wrong = verify(systems.reference, model);
+        }
+        if (wrong.empty() && capture(systems.wide) != model) {
+            wrong = "FuelSys64 differs from the model";
+        }
+        if (wrong.empty() && capture(systems.grams) != scaled(model, 1000)) {
+            wrong = "FuelSysGrams differs from the model";
+        }
+        if (wrong.empty() && rebuilt) {
+            rebuild(systems.compact, model);
+            rebuild(systems.fixed, model);
+        }
+
+        changed = count != 0;
+        return wrong;
+    }
+
+    /*
+     * Function: rebalance
+     * -------------------
+     * Levels out the tanks with IDs in a window from the call's tank, by capacity, with the
+     * first one repeated if the pump ID is -1. The model checks every share is the exact
+     * one rounded down or up by one unit, and that the transfers, made one by one on the
+     * model, give the tanks the reference ends with. FuelSysGrams splits grams instead
+     * of kilograms and may find a share it cannot reach, so its shares are checked in
+     * grams and it is then rebuilt from the model
+     *
+     * return: Empty if the rebalance matched the model, otherwise what did not
+     */
+    string rebalance(const Command& command, Systems& systems, Model& model, int& count) {
+        int window = 2 + (int)((unsigned)command.amount % 7);
+        std::vector<int> tankIDs;
+        for (auto tank = model.lower_bound(command.tankID); tank != model.end() && tank->first - window < command.tankID; tank++) {
+            tankIDs.push_back(tank->first);
+        }
+        if (tankIDs.empty()) {
+            tankIDs.push_back(command.tankID);
+        }
+        bool valid = model.count(tankIDs[0]) != 0;
+        if (command.pumpID < 0) {
+            tankIDs.push_back(tankIDs[0]);
+            valid = false;
+        }
+
+        std::vector<FuelSys::DrainStep> transfers;
+        bool result = systems.reference.rebalance(tankIDs, {}, &transfers);
+        if (result && !valid) {
+            return "rebalance accepted a missing or repeated tank";
+        }
+        if (systems.wide.rebalance(tankIDs) != result) {
+            return string("FuelSys64 returned ") + (result ? "false" : "true");
+        }
+        if (systems.grams.rebalance(tankIDs)) {
+            string wrong = valid ? shares(capture(systems.grams), tankIDs) : "FuelSysGrams accepted a missing or repeated tank";
+            if (!wrong.empty()) {
+                return "FuelSysGrams: " + wrong;
+            }
+        }
+        rebuild(systems.grams, model);
+        if (!result) {
+            return transfers.empty() ? "" : "rebalance failed but reported transfers";
+        }
+
+        //Inflows come before outflows, so no tank receives after it has sent
+        std::map<int, bool> sent;
+        for (const FuelSys::DrainStep& step : transfers) {
+            auto source = model.find(step.tankID);
+            int target = -1;
+            if (source != model.end()) {
+                for (const std::pair<int, int>& pump : source->second.pumps) {
+                    target = pump.first == step.pumpID ? pump.second : target;
+                }
+            }
+            if (target < 0 || step.fuel <= 0 || std::count(tankIDs.begin(), tankIDs.end(), target) == 0
+                || std::count(tankIDs.begin(), tankIDs.end(), step.tankID) == 0 || sent[target]) {
+                return "transfer of " + std::to_string(step.fuel) + " from tank " + std::to_string(step.tankID)
+                    + " through pump " + std::to_string(step.pumpID) + " is not valid";
+            }
+            sent[step.tankID] = true;
+            source->second.fuel -= step.fuel;
+            model[target].fuel += step.fuel;
+        }
+
+        count = 1;
+        rebuild(systems.grams, model);
+        return shares(model, tankIDs);
+    }
+
+    // empty if each tank holds its exact share by capacity, rounded down or up by one unit
+    static string shares(const Model& model, const std::vector<int>& tankIDs) {
+        long long capacity = 0;
+        long long total = 0;
+        for (int tankID : tankIDs) {
+            capacity += model.at(tankID).capacity;
+            total += model.at(tankID).fuel;
+        }
+        for (int tankID : tankIDs) {
+            __int128 exact = (__int128)total * model.at(tankID).capacity;
+            long long share = (long long)(exact / capacity);
+            long long fuel = model.at(tankID).fuel;
+            if (fuel < share || fuel > share + (exact % capacity != 0)) {
+                return "tank " + std::to_string(tankID) + " holds " + std::to_string(fuel) + " instead of its share " + std::to_string(share);
+            }
+        }
+        return "";
+    }
+
+    /*
+     * Function: cascade
+     * -----------------
+     * Drains the call's amount from a tank with pumps through one of them, then half of it
+     * onwards through the first pump of the tank that pump leads to if it has one, given in
+     * that order or the other way round. A pump ID of -1 adds a step through a missing pump. The model refuses the cascade if a step is invalid or
+     * touches a cycle, checks the drain order it is given, and otherwise runs the steps
+     * in that order as separate clamped drains
+     *
+     * return: Empty if the cascade matched the model, otherwise what did not
+     */
+    string cascade(const Command& command, Systems& systems, Model& model, int& count) {
+        std::vector<FuelSys::DrainStep> steps = { { command.tankID, command.pumpID, command.amount } };
+        int source = withPumps(model, command.tankID);
+        if (model.count(source) != 0 && !model[source].pumps.empty()) {
+            const std::vector<std::pair<int, int>>& pumps = model[source].pumps;
+            const std::pair<int, int>& pump = pumps[(command.pumpID + 1) % pumps.size()];
+            steps[0] = { source, pump.first, command.amount };
+            if (!model[pump.second].pumps.empty()) {
+                FuelSys::DrainStep onwards = { pump.second, model[pump.second].pumps[0].first, command.amount / 2 };
+                steps.insert(command.target % 2 == 0 ? steps.end() : steps.begin(), onwards);
+            }
+        }
+        //Pump -1 never exists, so this step spoils the whole cascade
+        if (command.pumpID < 0) {
+            steps.push_back({ command.target, -1, command.amount / 2 });
+        }
+        std::vector<FuelSys64::DrainStep> wideSteps;
+        std::vector<FuelSysGrams::DrainStep> gramSteps;
+        for (const FuelSys::DrainStep& step : steps) {
+            wideSteps.push_back({ step.tankID, step.pumpID, step.fuel });
+            gramSteps.push_back({ step.tankID, step.pumpID, step.fuel });
+        }
+
+        std::vector<int> order = systems.reference.drainOrder();
+        std::map<int, int> rank;
+        for (int i = 0; i < (int)order.size(); i++) {
+            rank[order[i]] = i;
+        }
+        for (const auto& [tankID, tank] : model) {
+            bool onCycle = reaches(model, tankID, tankID, true);
+            if (onCycle == (rank.count(tankID) != 0)) {
+                return "drainOrder is wrong about tank " + std::to_string(tankID);
+            }
+            for (const std::pair<int, int>& pump : tank.pumps) {
+                if (!onCycle && rank.count(pump.second) != 0 && rank[tankID] > rank[pump.second]) {
+                    return "drainOrder puts tank " + std::to_string(tankID) + " after tank " + std::to_string(pump.second);
+                }
+            }
+        }
+
+        //Each step with its pump's target, in the order the cascade runs them
+        std::vector<std::pair<int, FuelSys::DrainStep>> resolved;
+        bool valid = true;
+        for (const FuelSys::DrainStep& step : steps) {
+            auto source = model.find(step.tankID);
+            int target = -1;
+            if (source != model.end()) {
+                for (const std::pair<int, int>& pump : source->second.pumps) {
+                    target = pump.first == step.pumpID ? pump.second : target;
+                }
+            }
+            valid = valid && step.fuel >= 0 && target >= 0 && rank.count(step.tankID) != 0 && rank.count(target) != 0;
+            resolved.push_back({ target, step });
+        }
+        std::stable_sort(resolved.begin(), resolved.end(), [&](const auto& a, const auto& b) {
+            return valid && rank[a.second.tankID] < rank[b.second.tankID];
+        });
+
+        bool results[3] = { systems.reference.cascadeDrain(steps), systems.wide.cascadeDrain(wideSteps),
+            systems.grams.cascadeDrain(gramSteps) };
+        string wrong = agreed(results, valid);
+        if (!wrong.empty() || !valid) {
+            return wrong;
+        }
+
+        for (const auto& [targetID, step] : resolved) {
+            ModelTank& source = model[step.tankID];
+            ModelTank& target = model[targetID];
+            long long fuel = std::min((long long)step.fuel, std::min(source.fuel, target.capacity - target.fuel));
+            source.fuel -= fuel;
+            target.fuel += fuel;
+        }
+
+        count = 1;
+        return "";
+    }
+
+    // the first tank from tankID on, wrapping around, that has pumps, or tankID if none has
+    static int withPumps(const Model& model, int tankID) {
+        auto tank = model.lower_bound(tankID);
+        for (size_t i = 0; i < model.size(); i++, tank++) {
+            if (tank == model.end()) {
+                tank = model.begin();
+            }
+            if (!tank->second.pumps.empty()) {
+                return tank->first;
+            }
+        }
+        return tankID;
+    }
+
+    // results of the FuelSys, FuelSys64 and FuelSysGrams calls against the model's
+    static string agreed(const bool results[3], bool expected) {
+        const char* names[3] = { "FuelSys", "FuelSys64", "FuelSysGrams" };
+        for (int i = 0; i < 3; i++) {
+            if (results[i] != expected) {
+                return string(names[i]) + " returned " + (results[i] ? "true" : "false");
+            }
+        }
+        return "";
+    }
+
+    // counts removed by each storage mode against the model's
+    static string counted(const int removed[5], int expected) {
+        const char* names[5] = { "FuelSys", "FuelSys64", "FuelSysGrams", "CompactFuelSys", "StaticFuelSys" };
+        for (int i = 0; i < 5; i++) {
+            if (removed[i] != expected) {
+                return string(names[i]) + " removed " + std::to_string(removed[i]) + ", the model " + std::to_string(expected);
+            }
+        }
+        return "";
+    }
+
+    template <class Q>
+    static Model capture(const BasicFuelSys<Q>& sys) {
+        Model model;
+        for (const BasicTank<Q>* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+            ModelTank& entry = model[tank->m_tankID];
+            entry.capacity = toUnits(tank->m_tankCapacity);
+            entry.fuel = toUnits(tank->m_tankFuel);
+            for (const Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+                entry.pumps.push_back({ pump->m_pumpID, sys.targetID(pump) });
+            }
+        }
+        return model;
+    }
+
+    static Model scaled(Model model, long long units) {
+        for (auto& [tankID, tank] : model) {
+            tank.capacity *= units;
+            tank.fuel *= units;
+        }
+        return model;
+    }
+
+    // true if a chain of one or more pumps leads from source to target, or they are the same tank unless cycle is set
+    static bool reaches(const Model& model, int source, int target, bool cycle = false) {
+        if (model.count(source) == 0 || model.count(target) == 0) {
+            return false;
+        }
+        std::map<int, bool> seen;
+        std::vector<int> frontier = { source };
+        while (!frontier.empty()) {
+            int tankID = frontier.back();
+            frontier.pop_back();
+            for (const std::pair<int, int>& pump : model.at(tankID).pumps) {
+                if (!seen[pump.second]) {
+                    seen[pump.second] = true;
+                    frontier.push_back(pump.second);
+                }
+            }
+        }
+        return seen[target] || (!cycle && source == target);
+    }
+
+    /*
+     * Function: verify
+     * ----------------
+     * Compares the system's tanks, levels and pumps with the model, then its level index
+     * and reachability answers with ones worked out from the model
+     *
+     * return: Empty if they agree, otherwise what did not
+     */
+    static string verify(const FuelSys& sys, const Model& model) {
+        if (capture(sys) != model) {
+            return "tanks differ from the model";
+        }
+
+        std::vector<int> byFill = sys.tanksByFill(0.0, 1.0);
+        if (byFill.size() != model.size()) {
+            return "the level index holds " + std::to_string(byFill.size()) + " tanks";
+        }
+        for (size_t i = 0; i < byFill.size(); i++) {
+            if (model.count(byFill[i]) == 0) {
+                return "the level index holds missing tank " + std::to_string(byFill[i]);
+            }
+            if (i > 0) {
+                const ModelTank& before = model.at(byFill[i - 1]);
+                const ModelTank& tank = model.at(byFill[i]);
+                if ((__int128)before.fuel * tank.capacity > (__int128)tank.fuel * before.capacity) {
+                    return "the level index has tank " + std::to_string(byFill[i]) + " out of order";
+                }
+            }
+        }
+
+        bool cycle = false;
+        for (const auto& [source, tank] : model) {
+            cycle = cycle || reaches(model, source, source, true);
+            for (const auto& [target, other] : model) {
+                if (sys.canReach(source, target) != reaches(model, source, target)) {
+                    return "canReach(" + std::to_string(source) + ", " + std::to_string(target) + ") is wrong";
+                }
+            }
+        }
+        if (sys.hasCycle() != cycle) {
+            return "hasCycle is wrong";
+        }
+
+        return "";
+    }
+
+    // removes every tank the decoder can name and adds the model's
+    template <class S>
+    static void rebuild(S& sys, const Model& model) {
+        for (int tankID = 0; tankID < FUZZTANKS; tankID++) {
+            sys.removeTank(tankID);
+        }
+        for (int tankID : EDGEIDS) {
+            sys.removeTank(tankID);
+        }
+        for (const auto& [tankID, tank] : model) {
+            sys.addTank(tankID, (int)tank.capacity);
+            sys.fill(tankID, (int)tank.fuel);
+        }
+        for (const auto& [tankID, tank] : model) {
+            for (const std::pair<int, int>& pump : tank.pumps) {
+                sys.addPump(tankID, pump.first, pump.second);
+            }
+        }
+    }
+
+    /*
+     * Function: decode
+     * ----------------
+     * Tank IDs are mostly 0 to 7 so calls hit the same tanks, then up to 31, with -1 and two
+     * far IDs for the error and ordering paths. Amounts are mostly a few hundred kg with 0, -1, MINCAP - 1 and
+     * INT_MAX mixed in
+     */
+    static Command decode(int kind, const uint8_t* call) {
+        Command command = Command{ kind >= FINDTANK ? FILLTANK : (COMMAND)kind, 0, 0, 0, 0 };
+
+        command.tankID = tankID(call[1]);
+        command.pumpID = call[2] % FUZZPUMPS - 1;
+        command.target = tankID(call[2]);
+
+        int amount = call[3];
+        if (amount >= 250) {
+            static const int EDGEAMOUNTS[6] = { 0, -1, MINCAP - 1, MINCAP, INT_MAX, DEFCAP };
+            command.amount = EDGEAMOUNTS[amount - 250];
+        }
+        else if (kind == ADDTANK || kind == SETCAPACITY) {
+            command.amount = MINCAP + amount * 40;
+        }
+        else {
+            command.amount = amount * 20;
+        }
+
+        return command;
+    }
+
+    static int tankID(uint8_t byte) {
+        if (byte < 160) {
+            return byte % HOTTANKS;
+        }
+        return byte < 240 ? byte % FUZZTANKS : EDGEIDS[byte % (EDGETANKS + 1)];
+    }
+
+    bool fail(size_t index, int kind, const Command& command, const string& what) {
+        m_message = "call " + std::to_string(index) + " " + KINDNAMES[kind] + "(" + std::to_string(command.tankID)
+            + ", " + std::to_string(command.pumpID) + ", " + std::to_string(command.target) + ", "
+            + std::to_string(command.amount) + "): " + what;
+        return false;
+    }
+};
+
+#ifdef FUEL_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    Fuzz fuzz;
+    if (!fuzz.run(data, size)) {
+        cout << fuzz.message() << "\n";
+        std::abort();
+    }
+    return 0;
+}
+#else
+/*
+ * Function: main
+ * --------------
+ * fuzz [seconds] [seed] runs random inputs of 64 to 1024 calls until the time is up and
+ * writes the first failing input to fuzz-failure.bin. fuzz <file>... replays saved inputs
+ */
+int main(int argc, char** argv) {
+    char* end = nullptr;
+    if (argc > 1 && (std::strtod(argv[1], &end) <= 0 || *end != '\0')) {
+        int failed = 0;
+        for (int i = 1; i < argc; i++) {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            Fuzz fuzz;
+            if (!fuzz.run(input.data(), input.size())) {
+                cout << argv[i] << ": " << fuzz.message() << "\n";
+                failed++;
+            }
+        }
+        cout << argc - 1 - failed << " of " << argc - 1 << " inputs passed\n";
+        return failed == 0 ? 0 : 1;
+    }
+
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    std::mt19937 gen(argc > 2 ? std::atoi(argv[2]) : 46);
+    std::uniform_int_distribution<int> pickLength(64, 1024);
+    std::uniform_int_distribution<int> pickByte(0, 255);
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    long long inputs = 0;
+    Fuzz fuzz;
+
+    while (elapsed < seconds) {
+        std::vector<uint8_t> input(4 * pickLength(gen));
+        for (uint8_t& byte : input) {
+            byte = (uint8_t)pickByte(gen);
+        }
+
+        if (!fuzz.run(input.data(), input.size())) {
+            std::ofstream file("fuzz-failure.bin", std::ios::binary);
+            file.write((const char*)input.data(), (std::streamsize)input.size());
+            cout << "input " << inputs << ": " << fuzz.message() << "\nsaved to fuzz-failure.bin\n";
+            return 1;
+        }
+
+        inputs++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    cout << "inputs: " << inputs << "  calls: " << fuzz.calls() << "  calls/s: " << fuzz.calls() / elapsed << "\n";
+    return 0;
+}
+#endif
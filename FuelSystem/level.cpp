@@ -0,0 +1,134 @@
+#include "level.h"
+
+template <class Q>
+void LevelIndex<Q>::insert(int tankID, Q capacity, Q fuel) {
+	m_byRatio.insert({ ratio(capacity, fuel), tankID });
+	m_bySpace.insert({ capacity - fuel, tankID });
+}
+
+template <class Q>
+void LevelIndex<Q>::erase(int tankID, Q capacity, Q fuel) {
+	m_byRatio.erase({ ratio(capacity, fuel), tankID });
+	m_bySpace.erase({ capacity - fuel, tankID });
+}
+
+/*
+ * Function: update
+ * ----------------
+ * Moves a tank to its new position in both orders, the old level must be the one it was inserted with.
+ * Each entry is unlinked, rekeyed and linked back in its own node, so a level change does not allocate
+ */
+template <class Q>
+void LevelIndex<Q>::update(int tankID, Q capacity, Q oldFuel, Q newFuel) {
+	if (oldFuel == newFuel) {
+		return;
+	}
+
+	auto byRatio = m_byRatio.extract({ ratio(capacity, oldFuel), tankID });
+	if (byRatio.empty()) {
+		m_byRatio.insert({ ratio(capacity, newFuel), tankID });
+	}
+	else {
+		byRatio.value().first = ratio(capacity, newFuel);
+		m_byRatio.insert(std::move(byRatio));
+	}
+
+	auto bySpace = m_bySpace.extract({ capacity - oldFuel, tankID });
+	if (bySpace.empty()) {
+		m_bySpace.insert({ capacity - newFuel, tankID });
+	}
+	else {
+		bySpace.value().first = capacity - newFuel;
+		m_bySpace.insert(std::move(bySpace));
+	}
+}
+
+template <class Q>
+void LevelIndex<Q>::clear() {
+	m_byRatio.clear();
+	m_bySpace.clear();
+}
+
+/*
+ * Function: byRatio
+ * -----------------
+ * low, high: Bounds of the fill ratio, 0.1 is 10% full
+ *
+ * return: IDs of the tanks in range, emptiest first, none if either bound is NaN
+ */
+template <class Q>
+std::vector<int> LevelIndex<Q>::byRatio(double low, double high) const {
+	std::vector<int> ids;
+	//A NaN low compares equal to every key, so lower_bound would start at the first tank
+	if (!(low <= high)) {
+		return ids;
+	}
+
+	for (auto entry = m_byRatio.lower_bound({ low, -1 });
+		entry != m_byRatio.end() && entry->first <= high; ++entry) {
+		ids.push_back(entry->second);
+	}
+
+	return ids;
+}
+
+template <class Q>
+std::vector<int> LevelIndex<Q>::emptiest(int k) const {
+	std::vector<int> ids;
+
+	for (auto entry = m_byRatio.begin(); entry != m_byRatio.end() && (int)ids.size() < k; ++entry) {
+		ids.push_back(entry->second);
+	}
+
+	return ids;
+}
+
+template <class Q>
+std::vector<int> LevelIndex<Q>::fullest(int k) const {
+	std::vector<int> ids;
+
+	for (auto entry = m_byRatio.rbegin(); entry != m_byRatio.rend() && (int)ids.size() < k; ++entry) {
+		ids.push_back(entry->second);
+	}
+
+	return ids;
+}
+
+/*
+ * Function: withSpace
+ * -------------------
+ * space: Smallest amount of free space to report
+ *
+ * return: IDs of the tanks with at least that much free, least free space first
+ */
+template <class Q>
+std::vector<int> LevelIndex<Q>::withSpace(Q space) const {
+	std::vector<int> ids;
+
+	for (auto entry = m_bySpace.lower_bound({ space, -1 }); entry != m_bySpace.end(); ++entry) {
+		ids.push_back(entry->second);
+	}
+
+	return ids;
+}
+
+template <class Q>
+std::vector<int> LevelIndex<Q>::mostSpace(int k) const {
+	std::vector<int> ids;
+
+	for (auto entry = m_bySpace.rbegin(); entry != m_bySpace.rend() && (int)ids.size() < k; ++entry) {
+		ids.push_back(entry->second);
+	}
+
+	return ids;
+}
+
+template <class Q>
+void LevelIndex<Q>::memory(HeapBytes& heap) const {
+	heap.tree(m_byRatio);
+	heap.tree(m_bySpace);
+}
+
+template class LevelIndex<int>;
+template class LevelIndex<long long>;
+template class LevelIndex<Grams>;
@@ -0,0 +1,36 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+#include "memory.h"
+#include "quantity.h"
+#include <set>
+#include <utility>
+#include <vector>
+// LevelIndex keeps every tank ordered by fill ratio (fuel / capacity) and
+// by free space (capacity - fuel). FuelSys updates it whenever a level
+// changes, so range scans and top-k queries cost O(log n + k) instead of
+// a walk over the whole tank list.
+template <class Q>
+class LevelIndex {
+public:
+    void insert(int tankID, Q capacity, Q fuel);
+    void erase(int tankID, Q capacity, Q fuel);
+    void update(int tankID, Q capacity, Q oldFuel, Q newFuel);
+    void clear();
+    int size() const { return (int)m_byRatio.size(); }
+    // tanks with fill ratio in [low, high], emptiest first
+    std::vector<int> byRatio(double low, double high) const;
+    // the k tanks with the lowest fill ratio, emptiest first
+    std::vector<int> emptiest(int k) const;
+    // the k tanks with the highest fill ratio, fullest first
+    std::vector<int> fullest(int k) const;
+    // tanks with at least space free, least free space first
+    std::vector<int> withSpace(Q space) const;
+    // the k tanks with the most free space, most first
+    std::vector<int> mostSpace(int k) const;
+    void memory(HeapBytes& heap) const;
+private:
+    std::set<std::pair<double, int>> m_byRatio;
+    std::set<std::pair<Q, int>> m_bySpace;
+    static double ratio(Q capacity, Q fuel) { return toKg(fuel) / toKg(capacity); }
+};
+#endif
@@ -0,0 +1,63 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <cstddef>
+// bytes a system holds, by component
+struct MemoryUsage {
+    size_t system; // the object itself
+    size_t tanks;  // live tank nodes
+    size_t pumps;  // live pump nodes
+    size_t levels; // fill-ratio and free-space index
+    size_t reach;  // pump graph and its reachability cache
+    size_t alarms; // alarm thresholds and queue
+    size_t ids;    // tank table and ID to index map
+    size_t slack;  // allocator headers and rounding, and storage reserved but not in use
+    size_t total() const { return system + tanks + pumps + levels + reach + alarms + ids + slack; }
+};
+// heap cost of one allocation with glibc malloc on 64-bit: an 8-byte header,
+// rounded up to 16 bytes, 32 bytes at least
+inline size_t heapChunk(size_t bytes) {
+    size_t chunk = (bytes + 8 + 15) & ~(size_t)15;
+    return chunk < 32 ? 32 : chunk;
+}
+// HeapBytes adds up what standard containers hold from their sizes and
+// capacities alone, so the cost does not depend on how many elements there
+// are. Node sizes follow libstdc++: a tree node is a colour word and three
+// links before the value, a hash node one link before it, and a hash table
+// with one bucket keeps it inside the container.
+struct HeapBytes {
+    size_t used = 0;
+    size_t slack = 0;
+    // count separate allocations of bytes each
+    void nodes(size_t count, size_t bytes) {
+        used += count * bytes;
+        slack += count * (heapChunk(bytes) - bytes);
+    }
+    // one allocation of bytes, none if bytes is 0
+    void block(size_t bytes) {
+        if (bytes != 0) {
+            nodes(1, bytes);
+        }
+    }
+    template <class Set>
+    void tree(const Set& set) {
+        nodes(set.size(), 4 * sizeof(void*) + sizeof(typename Set::value_type));
+    }
+    template <class Map>
+    void hash(const Map& map) {
+        nodes(map.size(), sizeof(void*) + sizeof(typename Map::value_type));
+        if (map.bucket_count() > 1) {
+            block(map.bucket_count() * sizeof(void*));
+        }
+    }
+    // the spare capacity counts as slack
+    template <class Vector>
+    void vector(const Vector& vector) {
+        size_t size = vector.size() * sizeof(typename Vector::value_type);
+        size_t capacity = vector.capacity() * sizeof(typename Vector::value_type);
+        if (capacity != 0) {
+            used += size;
+            slack += heapChunk(capacity) - size;
+        }
+    }
+};
+#endif
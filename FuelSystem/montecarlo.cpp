@@ -0,0 +1,140 @@
+#include "montecarlo.h"
+#include <atomic>
+#include <random>
+#include <thread>
+
+MonteCarlo::MonteCarlo(const FuelSys& base, int numThreads) : m_base(base) {
+	m_threads = numThreads;
+	if (m_threads <= 0) {
+		m_threads = (int)std::thread::hardware_concurrency();
+	}
+	if (m_threads <= 0) {
+		m_threads = 1;
+	}
+
+	for (Tank* tank = base.m_current; tank != nullptr; tank = tank->m_next) {
+		m_tanks.push_back(tank->m_tankID);
+
+		for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+			m_pumps.push_back({ tank->m_tankID, pump->m_pumpID });
+		}
+	}
+}
+
+/*
+ * Function: run
+ * -------------
+ * scenarios: Number of replicas to simulate
+ * seed: Base seed of the run
+ * config: Shape of the random schedule applied to each replica
+ *
+ * Workers claim scenarios from a shared counter and keep their statistics
+ * locally, then add them to the shared totals with one atomic add per field.
+ * Each worker copies the base once; after a scenario it undoes the level
+ * changes that scenario logged, latest first, so the next one starts from the base
+ *
+ * return: Statistics summed over all scenarios
+ */
+ScenarioStats MonteCarlo::run(int scenarios, unsigned seed, const ScenarioConfig& config) {
+	std::atomic<int> next(0);
+	std::atomic<long long> shortfalls(0), shortfallKg(0), overflows(0), overflowKg(0), finalFuel(0);
+
+	auto worker = [&]() {
+		FuelSys replica;
+		ScenarioStats local;
+		std::vector<std::pair<Tank*, int>> changed;
+		bool copied = false;
+
+		for (int scenario = next++; scenario < scenarios; scenario = next++) {
+			if (!copied) {
+				replica = m_base;
+				copied = true;
+			}
+			runScenario(replica, scenario, seed, config, local, changed);
+			for (auto entry = changed.rbegin(); entry != changed.rend(); ++entry) {
+				replica.setFuel(entry->first, entry->second, FILLCHANGE);
+			}
+			changed.clear();
+		}
+
+		shortfalls.fetch_add(local.shortfalls, std::memory_order_relaxed);
+		shortfallKg.fetch_add(local.shortfallKg, std::memory_order_relaxed);
+		overflows.fetch_add(local.overflows, std::memory_order_relaxed);
+		overflowKg.fetch_add(local.overflowKg, std::memory_order_relaxed);
+		finalFuel.fetch_add(local.finalFuel, std::memory_order_relaxed);
+	};
+
+	std::vector<std::thread> threads;
+	for (int thread = 1; thread < m_threads && thread < scenarios; thread++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	ScenarioStats stats;
+	stats.scenarios = scenarios < 0 ? 0 : scenarios;
+	stats.shortfalls = shortfalls;
+	stats.shortfallKg = shortfallKg;
+	stats.overflows = overflows;
+	stats.overflowKg = overflowKg;
+	stats.finalFuel = finalFuel;
+	return stats;
+}
+
+/*
+ * Function: runScenario
+ * ---------------------
+ * replica: Copy of the base system to mutate
+ * scenario: Index of the scenario, selects its RNG stream
+ * changed: Receives each tank the scenario may change with its level just before
+ *
+ * Applies random deliveries to random tanks and random transfers through random pumps
+ */
+void MonteCarlo::runScenario(FuelSys& replica, int scenario, unsigned seed, const ScenarioConfig& config,
+	ScenarioStats& stats, std::vector<std::pair<Tank*, int>>& changed) const {
+	std::seed_seq seq{ seed, (unsigned)scenario };
+	std::mt19937_64 generator(seq);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	std::uniform_int_distribution<int> fillAmount(1, config.maxFill < 1 ? 1 : config.maxFill);
+	std::uniform_int_distribution<int> demandAmount(1, config.maxDemand < 1 ? 1 : config.maxDemand);
+	bool shortfall = false;
+
+	for (int step = 0; step < config.steps && !m_tanks.empty(); step++) {
+		if (m_pumps.empty() || chance(generator) < config.fillChance) {
+			std::uniform_int_distribution<size_t> pick(0, m_tanks.size() - 1);
+			int tankID = m_tanks[pick(generator)];
+			int fuel = fillAmount(generator);
+			Tank* tank = replica.getTank(tankID);
+			int space = tank->m_tankCapacity - tank->m_tankFuel;
+
+			if (fuel > space) {
+				stats.overflows++;
+				stats.overflowKg += fuel - space;
+			}
+			changed.push_back({ tank, tank->m_tankFuel });
+			replica.fill(tankID, fuel);
+		}
+		else {
+			std::uniform_int_distribution<size_t> pick(0, m_pumps.size() - 1);
+			const std::pair<int, int>& pump = m_pumps[pick(generator)];
+			int fuel = demandAmount(generator);
+			Tank* tank = replica.getTank(pump.first);
+
+			if (fuel > tank->m_tankFuel) {
+				shortfall = true;
+				stats.shortfallKg += fuel - tank->m_tankFuel;
+			}
+			Tank* target = replica.targetOf(replica.getPump(tank, pump.second));
+			changed.push_back({ tank, tank->m_tankFuel });
+			changed.push_back({ target, target->m_tankFuel });
+			replica.drain(pump.first, pump.second, fuel);
+		}
+	}
+
+	if (shortfall) {
+		stats.shortfalls++;
+	}
+	stats.finalFuel += replica.totalFuel();
+}
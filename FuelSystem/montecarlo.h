@@ -0,0 +1,43 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+#include "fuel.h"
+#include <utility>
+#include <vector>
+// parameters of one randomized scenario
+struct ScenarioConfig {
+    int steps = 100;          // operations applied to each replica
+    int maxFill = DEFCAP;     // largest random delivery in kg
+    int maxDemand = MINCAP;   // largest random transfer request in kg
+    double fillChance = 0.5;  // probability that a step is a delivery
+};
+// statistics summed over every scenario of a run
+struct ScenarioStats {
+    long long scenarios = 0;
+    long long shortfalls = 0;   // scenarios where a transfer found too little fuel
+    long long shortfallKg = 0;  // fuel requested but not available
+    long long overflows = 0;    // deliveries clamped by tank capacity
+    long long overflowKg = 0;   // fuel delivered that did not fit
+    long long finalFuel = 0;    // total fuel left in the replicas
+    double shortfallProbability() const {
+        return scenarios == 0 ? 0.0 : (double)shortfalls / scenarios;
+    }
+};
+// MonteCarlo runs independent replicas of a base system across a pool of
+// threads. Scenario i always draws from an RNG seeded with (seed, i), so
+// the totals do not depend on the number of threads or their scheduling.
+// Each thread copies the base once and, after every scenario, puts back
+// only the levels that scenario changed.
+class MonteCarlo {
+public:
+    // numThreads of 0 uses one thread per hardware core
+    MonteCarlo(const FuelSys& base, int numThreads = 0);
+    ScenarioStats run(int scenarios, unsigned seed, const ScenarioConfig& config = ScenarioConfig());
+private:
+    const FuelSys& m_base;
+    int m_threads;
+    std::vector<int> m_tanks;                  // IDs of the base tanks
+    std::vector<std::pair<int, int>> m_pumps;  // tank and pump IDs of the base pumps
+    void runScenario(FuelSys& replica, int scenario, unsigned seed, const ScenarioConfig& config,
+        ScenarioStats& stats, std::vector<std::pair<Tank*, int>>& changed) const;
+};
+#endif
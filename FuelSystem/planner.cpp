@@ -0,0 +1,255 @@
+#include "planner.h"
+#include <algorithm>
+
+RefillPlanner::RefillPlanner(FuelSys& sys) : m_sys(sys) {
+}
+
+void RefillPlanner::setPriority(int tankID, int priority) {
+	m_priority[tankID] = priority;
+}
+
+/*
+ * Function: collect
+ * -----------------
+ * Walks the tank list once
+ *
+ * return: Every tank that is not full, with its free space
+ */
+std::vector<RefillPlanner::Candidate> RefillPlanner::collect() const {
+	std::vector<Candidate> tanks;
+
+	for (Tank* tank = m_sys.m_current; tank != nullptr; tank = tank->m_next) {
+		int space = tank->m_tankCapacity - tank->m_tankFuel;
+		if (space > 0) {
+			tanks.push_back(Candidate{ tank, space, 0 });
+		}
+	}
+
+	return tanks;
+}
+
+/*
+ * Function: lowestFill
+ * --------------------
+ * tanks: Tanks that are not full
+ * delivery: Fuel to distribute
+ *
+ * Water-filling: the emptiest tanks are raised together until they reach the ratio
+ * of the next tank, which then joins them, until the delivery runs out
+ */
+void RefillPlanner::lowestFill(std::vector<Candidate>& tanks, int delivery) const {
+	std::sort(tanks.begin(), tanks.end(), [](const Candidate& a, const Candidate& b) {
+		return (long long)a.tank->m_tankFuel * b.tank->m_tankCapacity
+			< (long long)b.tank->m_tankFuel * a.tank->m_tankCapacity;
+	});
+
+	long double capacity = 0;
+	long double fuel = 0;
+	long double level = 1.0;
+	size_t group = tanks.size();
+
+	for (size_t i = 0; i < tanks.size(); i++) {
+		capacity += tanks[i].tank->m_tankCapacity;
+		fuel += tanks[i].tank->m_tankFuel;
+
+		long double nextRatio = 1.0;
+		if (i + 1 < tanks.size()) {
+			nextRatio = (long double)tanks[i + 1].tank->m_tankFuel / tanks[i + 1].tank->m_tankCapacity;
+		}
+
+		if (nextRatio * capacity - fuel >= delivery) {
+			level = (delivery + fuel) / capacity;
+			group = i + 1;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < group; i++) {
+		long long target = (long long)(level * tanks[i].tank->m_tankCapacity) - tanks[i].tank->m_tankFuel;
+		tanks[i].fuel = (int)std::clamp(target, 0LL, (long long)tanks[i].space);
+	}
+}
+
+/*
+ * Function: capacityWeighted
+ * --------------------------
+ * tanks: Tanks that are not full
+ * delivery: Fuel to distribute
+ *
+ * Each tank's share is proportional to its capacity. Tanks are visited from the least
+ * free space per capacity up, so a tank too full for its share is topped off and the
+ * rest of the delivery is shared among the remaining tanks
+ */
+void RefillPlanner::capacityWeighted(std::vector<Candidate>& tanks, int delivery) const {
+	std::sort(tanks.begin(), tanks.end(), [](const Candidate& a, const Candidate& b) {
+		return (long long)a.space * b.tank->m_tankCapacity < (long long)b.space * a.tank->m_tankCapacity;
+	});
+
+	long long capacity = 0;
+	for (const Candidate& candidate : tanks) {
+		capacity += candidate.tank->m_tankCapacity;
+	}
+
+	long long remaining = delivery;
+	for (Candidate& candidate : tanks) {
+		long long share = (long long)((long double)remaining * candidate.tank->m_tankCapacity / capacity);
+		candidate.fuel = (int)std::min(share, (long long)candidate.space);
+		remaining -= candidate.fuel;
+		capacity -= candidate.tank->m_tankCapacity;
+	}
+}
+
+/*
+ * Function: byPriority
+ * --------------------
+ * tanks: Tanks that are not full
+ * delivery: Fuel to distribute
+ *
+ * Fills tanks completely from the highest priority down, ties go to the emptier tank
+ */
+void RefillPlanner::byPriority(std::vector<Candidate>& tanks, int delivery) const {
+	auto priority = [this](const Candidate& candidate) {
+		auto found = m_priority.find(candidate.tank->m_tankID);
+		return found == m_priority.end() ? 0 : found->second;
+	};
+
+	std::sort(tanks.begin(), tanks.end(), [&](const Candidate& a, const Candidate& b) {
+		int priorityA = priority(a);
+		int priorityB = priority(b);
+		if (priorityA != priorityB) {
+			return priorityA > priorityB;
+		}
+		return (long long)a.tank->m_tankFuel * b.tank->m_tankCapacity
+			< (long long)b.tank->m_tankFuel * a.tank->m_tankCapacity;
+	});
+
+	int remaining = delivery;
+	for (Candidate& candidate : tanks) {
+		candidate.fuel = std::min(remaining, candidate.space);
+		remaining -= candidate.fuel;
+	}
+}
+
+/*
+ * Function: allocate
+ * ------------------
+ * Runs the policy, then hands out fuel lost to rounding in the policy's order
+ *
+ * return: Candidates in policy order with their allocations
+ */
+std::vector<RefillPlanner::Candidate> RefillPlanner::allocate(int delivery, REFILL policy) const {
+	std::vector<Candidate> tanks = collect();
+	if (delivery <= 0) {
+		return std::vector<Candidate>();
+	}
+
+	long long space = 0;
+	for (const Candidate& candidate : tanks) {
+		space += candidate.space;
+	}
+
+	//The delivery fills every tank
+	if (space <= delivery) {
+		for (Candidate& candidate : tanks) {
+			candidate.fuel = candidate.space;
+		}
+		return tanks;
+	}
+
+	if (policy == LOWESTFILL) {
+		lowestFill(tanks, delivery);
+	}
+	else if (policy == CAPACITYWEIGHTED) {
+		capacityWeighted(tanks, delivery);
+	}
+	else {
+		byPriority(tanks, delivery);
+	}
+
+	long long leftover = delivery;
+	for (const Candidate& candidate : tanks) {
+		leftover -= candidate.fuel;
+	}
+	for (size_t i = 0; i < tanks.size() && leftover > 0; i++) {
+		int extra = (int)std::min(leftover, (long long)(tanks[i].space - tanks[i].fuel));
+		tanks[i].fuel += extra;
+		leftover -= extra;
+	}
+
+	return tanks;
+}
+
+/*
+ * Function: plan
+ * --------------
+ * delivery: Fuel to distribute
+ * policy: How to split it
+ *
+ * return: Fuel each tank would receive, in the policy's order
+ */
+std::vector<Allocation> RefillPlanner::plan(int delivery, REFILL policy) {
+	std::vector<Allocation> result;
+
+	for (const Candidate& candidate : allocate(delivery, policy)) {
+		if (candidate.fuel > 0) {
+			result.push_back(Allocation{ candidate.tank->m_tankID, candidate.fuel });
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Function: apply
+ * ---------------
+ * plan: Allocations from plan, possibly made before other changes to the system
+ *
+ * Resolves every tank in one walk of the list and adds its fuel, clamped like fill
+ *
+ * return: Total fuel added
+ */
+long long RefillPlanner::apply(const std::vector<Allocation>& plan) {
+	std::unordered_map<int, Tank*> tanks;
+	for (Tank* tank = m_sys.m_current; tank != nullptr; tank = tank->m_next) {
+		tanks[tank->m_tankID] = tank;
+	}
+
+	long long total = 0;
+	for (const Allocation& allocation : plan) {
+		auto found = tanks.find(allocation.tankID);
+		if (found == tanks.end() || allocation.fuel <= 0) {
+			continue;
+		}
+
+		Tank* tank = found->second;
+		int fuel = std::min(allocation.fuel, tank->m_tankCapacity - tank->m_tankFuel);
+		m_sys.setFuel(tank, tank->m_tankFuel + fuel, FILLCHANGE);
+		total += fuel;
+	}
+
+	return total;
+}
+
+/*
+ * Function: deliver
+ * -----------------
+ * delivery: Fuel to distribute
+ * policy: How to split it
+ *
+ * Plans and adds the fuel through the tanks found while planning
+ *
+ * return: Fuel each tank received
+ */
+std::vector<Allocation> RefillPlanner::deliver(int delivery, REFILL policy) {
+	std::vector<Allocation> result;
+
+	for (const Candidate& candidate : allocate(delivery, policy)) {
+		if (candidate.fuel > 0) {
+			Tank* tank = candidate.tank;
+			m_sys.setFuel(tank, tank->m_tankFuel + candidate.fuel, FILLCHANGE);
+			result.push_back(Allocation{ tank->m_tankID, candidate.fuel });
+		}
+	}
+
+	return result;
+}
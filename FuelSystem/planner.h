@@ -0,0 +1,43 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+#include "fuel.h"
+#include <unordered_map>
+#include <vector>
+enum REFILL { LOWESTFILL, CAPACITYWEIGHTED, PRIORITY };
+// fuel given to one tank by a plan
+struct Allocation {
+    int tankID;
+    int fuel;
+};
+// RefillPlanner splits one delivery across the tanks of a system.
+//   LOWESTFILL raises the emptiest tanks to a common fill ratio
+//   CAPACITYWEIGHTED shares the delivery in proportion to capacity
+//   PRIORITY fills tanks completely in order of their priority
+// No tank is given more than its free space, so every allocation is
+// exactly what fill would have added.
+class RefillPlanner {
+public:
+    RefillPlanner(FuelSys& sys);
+    // priority of a tank for the PRIORITY policy, higher fills first, default 0
+    void setPriority(int tankID, int priority);
+    // how much each tank would receive, tanks receiving nothing are left out
+    std::vector<Allocation> plan(int delivery, REFILL policy);
+    // add a plan's fuel to the tanks in one pass, return the total added
+    long long apply(const std::vector<Allocation>& plan);
+    // plan and apply without resolving the tanks a second time
+    std::vector<Allocation> deliver(int delivery, REFILL policy);
+private:
+    struct Candidate {
+        Tank* tank;
+        int space;
+        int fuel; // fuel allocated so far
+    };
+    FuelSys& m_sys;
+    std::unordered_map<int, int> m_priority;
+    std::vector<Candidate> collect() const;
+    void lowestFill(std::vector<Candidate>& tanks, int delivery) const;
+    void capacityWeighted(std::vector<Candidate>& tanks, int delivery) const;
+    void byPriority(std::vector<Candidate>& tanks, int delivery) const;
+    std::vector<Candidate> allocate(int delivery, REFILL policy) const;
+};
+#endif
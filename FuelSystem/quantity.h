@@ -0,0 +1,64 @@
+#ifndef QUANTITY_H
+#define QUANTITY_H
+#include <compare>
+#include <iostream>
+// Grams is a fixed-point fuel quantity: kilograms with gram precision,
+// stored as a 64-bit count of grams. Whole kilograms convert implicitly
+// so it can be compared with MINCAP and literal amounts.
+class Grams {
+public:
+    Grams() : m_grams(0) {}
+    Grams(long long kg) : m_grams(kg * 1000) {}
+    static Grams fromGrams(long long grams) {
+        Grams result;
+        result.m_grams = grams;
+        return result;
+    }
+    long long grams() const { return m_grams; }
+    Grams& operator+=(const Grams& rhs) { m_grams += rhs.m_grams; return *this; }
+    Grams& operator-=(const Grams& rhs) { m_grams -= rhs.m_grams; return *this; }
+    friend Grams operator+(Grams lhs, const Grams& rhs) { return lhs += rhs; }
+    friend Grams operator-(Grams lhs, const Grams& rhs) { return lhs -= rhs; }
+    bool operator==(const Grams& rhs) const = default;
+    auto operator<=>(const Grams& rhs) const = default;
+    // prints kilograms with three decimals
+    friend std::ostream& operator<<(std::ostream& out, const Grams& fuel) {
+        long long grams = fuel.m_grams < 0 ? -fuel.m_grams : fuel.m_grams;
+        char fraction[4] = { (char)('0' + grams / 100 % 10), (char)('0' + grams / 10 % 10), (char)('0' + grams % 10), '\0' };
+        return out << (fuel.m_grams < 0 ? "-" : "") << grams / 1000 << "." << fraction;
+    }
+private:
+    long long m_grams;
+};
+// a quantity in kilograms as a double, for ratios and reporting
+inline double toKg(long long fuel) {
+    return (double)fuel;
+}
+inline double toKg(const Grams& fuel) {
+    return fuel.grams() / 1000.0;
+}
+// a quantity as a count of its smallest unit, and back
+inline long long toUnits(long long fuel) {
+    return fuel;
+}
+inline long long toUnits(const Grams& fuel) {
+    return fuel.grams();
+}
+template <class Q>
+Q fromUnits(long long units) {
+    return (Q)units;
+}
+template <>
+inline Grams fromUnits<Grams>(long long units) {
+    return Grams::fromGrams(units);
+}
+// the type used to sum quantities over many tanks
+template <class Q>
+struct FuelTraits {
+    typedef Q Wide;
+};
+template <>
+struct FuelTraits<int> {
+    typedef long long Wide;
+};
+#endif
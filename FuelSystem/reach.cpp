@@ -0,0 +1,787 @@
+#include "reach.h"
+#include <algorithm>
+
+ReachIndex::ReachIndex() {
+	m_stale = false;
+	m_pairs = 0;
+	m_components = 0;
+	m_words = 0;
+	m_closed = true;
+	m_ordered = true;
+	m_work = 0;
+}
+
+/*
+ * Function: addTank
+ * -----------------
+ * A new tank has no pumps, so it reaches nothing and the cache stays valid
+ */
+void ReachIndex::addTank(int tankID) {
+	m_tanks.insert(tankID);
+}
+
+/*
+ * Function: removeTank
+ * --------------------
+ * Drops the tank and any pumps still attached to it. Its node stays as a component of its
+ * own so the ID can come back
+ */
+void ReachIndex::removeTank(int tankID) {
+	m_tanks.erase(tankID);
+	bool changed = false;
+
+	auto out = m_out.find(tankID);
+	if (out != m_out.end()) {
+		m_pairs -= out->second.size();
+		for (auto& edge : out->second) {
+			auto in = m_in.find(edge.first);
+			in->second.erase(tankID);
+			if (in->second.empty()) {
+				m_in.erase(in);
+			}
+		}
+		m_out.erase(out);
+		changed = true;
+	}
+
+	auto in = m_in.find(tankID);
+	if (in != m_in.end()) {
+		m_pairs -= in->second.size();
+		for (auto& edge : in->second) {
+			auto out = m_out.find(edge.first);
+			out->second.erase(tankID);
+			if (out->second.empty()) {
+				m_out.erase(out);
+			}
+		}
+		m_in.erase(in);
+		changed = true;
+	}
+
+	if (changed && closed() && node(tankID) >= 0) {
+		recompute(m_component[node(tankID)]);
+	}
+	else if (changed) {
+		m_stale = true;
+	}
+}
+
+/*
+ * Function: addEdge
+ * -----------------
+ * source: Tank the pump belongs to
+ * target: Tank the pump drains to
+ *
+ * If source already reaches target the new pump changes nothing
+ */
+void ReachIndex::addEdge(int source, int target) {
+	bool known = closed() && tanksReach(source, target);
+
+	if (m_out[source][target]++ == 0) {
+		m_pairs++;
+	}
+	m_in[target][source]++;
+
+	if (known) {
+		return;
+	}
+	if (closed()) {
+		insertEdge(source, target);
+	}
+	else {
+		m_stale = true;
+	}
+}
+
+/*
+ * Function: removeEdge
+ * --------------------
+ * Another pump between the same tanks keeps the cache valid
+ */
+void ReachIndex::removeEdge(int source, int target) {
+	auto out = m_out.find(source);
+	if (out == m_out.end()) {
+		return;
+	}
+	auto count = out->second.find(target);
+	if (count == out->second.end()) {
+		return;
+	}
+
+	if (--count->second > 0) {
+		return;
+	}
+
+	out->second.erase(count);
+	m_pairs--;
+	if (out->second.empty()) {
+		m_out.erase(out);
+	}
+	auto in = m_in.find(target);
+	in->second.erase(source);
+	if (in->second.empty()) {
+		m_in.erase(in);
+	}
+
+	if (closed()) {
+		recompute(m_component[node(source)]);
+	}
+	else {
+		m_stale = true;
+	}
+}
+
+void ReachIndex::clear() {
+	m_tanks.clear();
+	m_out.clear();
+	m_in.clear();
+	m_pairs = 0;
+	m_stale = true;
+}
+
+/*
+ * Function: memory
+ * ----------------
+ * heap: Receives the bytes held
+ *
+ * The inner maps are not walked. Together they hold one node per tank pair in each
+ * direction, and each has at least the 13 buckets a map gets on its first insert
+ */
+void ReachIndex::memory(HeapBytes& heap) const {
+	heap.hash(m_tanks);
+	heap.hash(m_out);
+	heap.hash(m_in);
+
+	size_t maps = m_out.size() + m_in.size();
+	heap.nodes(2 * m_pairs, sizeof(void*) + sizeof(std::pair<const int, int>));
+	if (maps != 0) {
+		size_t buckets = std::max(13 * maps, 2 * m_pairs);
+		heap.nodes(maps, buckets / maps * sizeof(void*));
+	}
+
+	heap.hash(m_node);
+	heap.vector(m_tankOf);
+	heap.vector(m_component);
+	heap.vector(m_size);
+	heap.vector(m_dagBegin);
+	heap.vector(m_dagEdges);
+	heap.vector(m_closure);
+	heap.vector(m_freeComponents);
+}
+
+/*
+ * Function: reachable
+ * -------------------
+ * source: Tank fuel starts in
+ * target: Tank fuel should end up in
+ *
+ * return: True if a chain of pumps leads from source to target, or they are the same tank
+ */
+bool ReachIndex::reachable(int source, int target) const {
+	if (m_tanks.count(source) == 0 || m_tanks.count(target) == 0) {
+		return false;
+	}
+	if (source == target) {
+		return true;
+	}
+	if (m_stale) {
+		rebuild();
+	}
+	m_work = 0;
+
+	return tanksReach(source, target);
+}
+
+/*
+ * Function: sameComponent
+ * -----------------------
+ * return: True if both tanks exist and each can reach the other
+ */
+bool ReachIndex::sameComponent(int first, int second) const {
+	if (m_tanks.count(first) == 0 || m_tanks.count(second) == 0) {
+		return false;
+	}
+	if (first == second) {
+		return true;
+	}
+	if (m_stale) {
+		rebuild();
+	}
+	m_work = 0;
+
+	int a = node(first);
+	int b = node(second);
+	return a >= 0 && b >= 0 && m_component[a] == m_component[b];
+}
+
+/*
+ * Function: isolated
+ * ------------------
+ * return: IDs of the tanks no pump drains from or into
+ */
+std::vector<int> ReachIndex::isolated() const {
+	std::vector<int> ids;
+
+	for (int tankID : m_tanks) {
+		if (m_out.count(tankID) == 0 && m_in.count(tankID) == 0) {
+			ids.push_back(tankID);
+		}
+	}
+
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+/*
+ * Function: hasCycle
+ * ------------------
+ * return: True if the pumps form at least one cycle
+ */
+bool ReachIndex::hasCycle() const {
+	if (m_stale) {
+		rebuild();
+	}
+	m_work = 0;
+
+	for (int size : m_size) {
+		if (size > 1) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Function: cycles
+ * ----------------
+ * return: Each strongly connected component of more than one tank, ordered by smallest ID
+ */
+std::vector<std::vector<int>> ReachIndex::cycles() const {
+	if (m_stale) {
+		rebuild();
+	}
+	m_work = 0;
+
+	std::vector<std::vector<int>> members(m_components);
+	for (int node = 0; node < (int)m_tankOf.size(); node++) {
+		if (m_size[m_component[node]] > 1) {
+			members[m_component[node]].push_back(m_tankOf[node]);
+		}
+	}
+
+	std::vector<std::vector<int>> groups;
+	for (std::vector<int>& group : members) {
+		if (!group.empty()) {
+			std::sort(group.begin(), group.end());
+			groups.push_back(std::move(group));
+		}
+	}
+	std::sort(groups.begin(), groups.end());
+
+	return groups;
+}
+
+/*
+ * Function: topologicalOrder
+ * --------------------------
+ * Components are numbered sinks first, so listing them from the highest number down puts
+ * every source before its targets. Tanks without pumps follow in increasing ID order
+ *
+ * return: IDs of every tank that is not on a cycle
+ */
+std::vector<int> ReachIndex::topologicalOrder() const {
+	if (m_stale || !m_ordered) {
+		rebuild();
+	}
+	m_work = 0;
+
+	std::vector<int> byComponent(m_components, 0);
+	for (int node = 0; node < (int)m_tankOf.size(); node++) {
+		if (m_size[m_component[node]] == 1) {
+			byComponent[m_component[node]] = m_tankOf[node];
+		}
+	}
+
+	std::vector<int> order;
+	for (int component = m_components - 1; component >= 0; component--) {
+		if (m_size[component] == 1) {
+			order.push_back(byComponent[component]);
+		}
+	}
+
+	std::vector<int> loose = isolated();
+	order.insert(order.end(), loose.begin(), loose.end());
+
+	return order;
+}
+
+int ReachIndex::node(int tankID) const {
+	auto found = m_node.find(tankID);
+	return found == m_node.end() ? -1 : found->second;
+}
+
+/*
+ * Function: rebuild
+ * -----------------
+ * Numbers the tanks that have pumps, then finds components and the closure
+ */
+void ReachIndex::rebuild() const {
+	m_node.clear();
+	m_tankOf.clear();
+
+	for (const auto& out : m_out) {
+		if (m_node.emplace(out.first, (int)m_tankOf.size()).second) {
+			m_tankOf.push_back(out.first);
+		}
+	}
+	for (const auto& in : m_in) {
+		if (m_node.emplace(in.first, (int)m_tankOf.size()).second) {
+			m_tankOf.push_back(in.first);
+		}
+	}
+
+	findComponents();
+	buildClosure();
+	m_stale = false;
+	m_ordered = true;
+	m_freeComponents.clear();
+	m_work = 0;
+}
+
+/*
+ * Function: findComponents
+ * ------------------------
+ * Iterative Tarjan. Components are numbered as they complete, so every edge of the
+ * condensed DAG goes from a higher number to a lower one
+ */
+void ReachIndex::findComponents() const {
+	int numNodes = (int)m_tankOf.size();
+	std::vector<int> adjBegin(numNodes + 1, 0);
+	std::vector<int> adj;
+
+	for (int node = 0; node < numNodes; node++) {
+		adjBegin[node] = (int)adj.size();
+		auto out = m_out.find(m_tankOf[node]);
+		if (out != m_out.end()) {
+			for (const auto& edge : out->second) {
+				adj.push_back(m_node.at(edge.first));
+			}
+		}
+	}
+	adjBegin[numNodes] = (int)adj.size();
+
+	std::vector<int> index(numNodes, -1);
+	std::vector<int> low(numNodes, 0);
+	std::vector<int> next(numNodes, 0);  // next edge to visit from each node
+	std::vector<char> onStack(numNodes, 0);
+	std::vector<int> stack;
+	std::vector<int> path;
+	int counter = 0;
+
+	m_component.assign(numNodes, -1);
+	m_size.clear();
+	m_components = 0;
+
+	for (int root = 0; root < numNodes; root++) {
+		if (index[root] >= 0) {
+			continue;
+		}
+
+		path.push_back(root);
+		while (!path.empty()) {
+			int node = path.back();
+
+			if (index[node] < 0) {
+				index[node] = low[node] = counter++;
+				next[node] = adjBegin[node];
+				stack.push_back(node);
+				onStack[node] = 1;
+			}
+
+			if (next[node] < adjBegin[node + 1]) {
+				int child = adj[next[node]++];
+				if (index[child] < 0) {
+					path.push_back(child);
+				}
+				else if (onStack[child]) {
+					low[node] = std::min(low[node], index[child]);
+				}
+				continue;
+			}
+
+			//All edges visited, close the component if this node is its root
+			if (low[node] == index[node]) {
+				int member = -1;
+				int size = 0;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = 0;
+					m_component[member] = m_components;
+					size++;
+				} while (member != node);
+				m_size.push_back(size);
+				m_components++;
+			}
+
+			path.pop_back();
+			if (!path.empty()) {
+				low[path.back()] = std::min(low[path.back()], low[node]);
+			}
+		}
+	}
+
+	//Condensed DAG
+	std::vector<std::vector<int>> successors(m_components);
+	for (int node = 0; node < numNodes; node++) {
+		for (int edge = adjBegin[node]; edge < adjBegin[node + 1]; edge++) {
+			int from = m_component[node];
+			int to = m_component[adj[edge]];
+			if (from != to) {
+				successors[from].push_back(to);
+			}
+		}
+	}
+
+	m_dagBegin.assign(m_components + 1, 0);
+	m_dagEdges.clear();
+	for (int component = 0; component < m_components; component++) {
+		std::vector<int>& out = successors[component];
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+
+		m_dagBegin[component] = (int)m_dagEdges.size();
+		m_dagEdges.insert(m_dagEdges.end(), out.begin(), out.end());
+	}
+	m_dagBegin[m_components] = (int)m_dagEdges.size();
+}
+
+/*
+ * Function: buildClosure
+ * ----------------------
+ * Successors always have lower numbers, so visiting components in increasing
+ * order lets each row be the union of its successors' finished rows
+ */
+void ReachIndex::buildClosure() const {
+	m_closure.clear();
+	m_words = 0;
+	m_closed = m_components <= MAXCLOSURE;
+
+	if (!m_closed) {
+		return;
+	}
+
+	m_words = (m_components + 63) / 64;
+	m_closure.assign((size_t)m_components * m_words, 0);
+
+	for (int component = 0; component < m_components; component++) {
+		uint64_t* row = &m_closure[(size_t)component * m_words];
+		row[component / 64] |= 1ULL << (component % 64);
+
+		for (int edge = m_dagBegin[component]; edge < m_dagBegin[component + 1]; edge++) {
+			const uint64_t* successor = &m_closure[(size_t)m_dagEdges[edge] * m_words];
+			for (int word = 0; word < m_words; word++) {
+				row[word] |= successor[word];
+			}
+		}
+	}
+}
+
+/*
+ * Function: componentReaches
+ * --------------------------
+ * Reads the closure row, or searches the condensed DAG when there is no closure.
+ * The search skips components numbered below the target since it cannot lead back up
+ */
+bool ReachIndex::componentReaches(int from, int to) const {
+	if (from == to) {
+		return true;
+	}
+	if (m_closed) {
+		return hasBit(from, to);
+	}
+	if (from < to) {
+		return false;
+	}
+
+	std::vector<char> visited(m_components, 0);
+	std::vector<int> frontier(1, from);
+	visited[from] = 1;
+
+	while (!frontier.empty()) {
+		int component = frontier.back();
+		frontier.pop_back();
+
+		for (int edge = m_dagBegin[component]; edge < m_dagBegin[component + 1]; edge++) {
+			int successor = m_dagEdges[edge];
+			if (successor == to) {
+				return true;
+			}
+			if (successor > to && !visited[successor]) {
+				visited[successor] = 1;
+				frontier.push_back(successor);
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Function: insertEdge
+ * --------------------
+ * source, target: Tanks of a pump the closure does not imply yet
+ *
+ * If the target cannot reach back to the source, every component that reaches the
+ * source now also reaches everything the target does, one OR of rows each. Otherwise
+ * the pump closes a loop and the components that reach the source are recomputed
+ */
+void ReachIndex::insertEdge(int source, int target) {
+	int from = ensureNode(source);
+	int to = ensureNode(target);
+	if (from < 0 || to < 0) {
+		m_stale = true;
+		return;
+	}
+
+	int a = m_component[from];
+	int b = m_component[to];
+	m_ordered = false;
+	if (hasBit(b, a)) {
+		recompute(a);
+		return;
+	}
+
+	const uint64_t* reached = &m_closure[(size_t)b * m_words];
+	for (int component = 0; component < m_components; component++) {
+		if (m_size[component] > 0 && hasBit(component, a)) {
+			uint64_t* row = &m_closure[(size_t)component * m_words];
+			for (int word = 0; word < m_words; word++) {
+				row[word] |= reached[word];
+			}
+		}
+	}
+	charge((size_t)m_components * m_words);
+}
+
+/*
+ * Function: ensureNode
+ * --------------------
+ * return: The tank's node, added as a component of its own if it had none, -1 if no
+ * component number is left
+ */
+int ReachIndex::ensureNode(int tankID) {
+	int existing = node(tankID);
+	if (existing >= 0) {
+		return existing;
+	}
+
+	int component = newComponent();
+	if (component < 0) {
+		return -1;
+	}
+
+	int added = (int)m_tankOf.size();
+	m_node[tankID] = added;
+	m_tankOf.push_back(tankID);
+	m_component.push_back(component);
+	m_size[component] = 1;
+	m_closure[(size_t)component * m_words + component / 64] |= 1ULL << (component % 64);
+	return added;
+}
+
+/*
+ * Function: newComponent
+ * ----------------------
+ * Reuses a number recompute freed, otherwise takes the next one, doubling the row width
+ * as needed, up to MAXCLOSURE numbers
+ *
+ * return: A component with no tanks and an empty row, or -1
+ */
+int ReachIndex::newComponent() {
+	if (!m_freeComponents.empty()) {
+		int component = m_freeComponents.back();
+		m_freeComponents.pop_back();
+		return component;
+	}
+	if (m_components >= MAXCLOSURE) {
+		return -1;
+	}
+
+	if (m_components >= m_words * 64) {
+		int words = std::min(std::max(1, 2 * m_words), (MAXCLOSURE + 63) / 64);
+		std::vector<uint64_t> wider((size_t)m_components * words, 0);
+		for (int component = 0; component < m_components; component++) {
+			std::copy(m_closure.begin() + (size_t)component * m_words, m_closure.begin() + (size_t)(component + 1) * m_words,
+				wider.begin() + (size_t)component * words);
+		}
+		m_closure.swap(wider);
+		m_words = words;
+	}
+
+	m_closure.resize((size_t)(m_components + 1) * m_words, 0);
+	m_size.push_back(0);
+	return m_components++;
+}
+
+/*
+ * Function: recompute
+ * -------------------
+ * component: Component whose tanks lost or gained a pump
+ *
+ * Only components that reach the changed one can gain or lose reachability, and none of
+ * the others reach them. Their numbers are freed and their tanks split into components
+ * again with Tarjan over the pumps among them. As each completes its row is the union of
+ * its successors' rows, which are either new and complete or outside and unchanged
+ */
+void ReachIndex::recompute(int component) {
+	std::vector<char> affected(m_components, 0);
+	for (int other = 0; other < m_components; other++) {
+		if (m_size[other] > 0 && hasBit(other, component)) {
+			affected[other] = 1;
+			m_size[other] = 0;
+			std::fill(m_closure.begin() + (size_t)other * m_words, m_closure.begin() + (size_t)(other + 1) * m_words, 0);
+			m_freeComponents.push_back(other);
+		}
+	}
+
+	std::vector<int> members;
+	std::vector<int> local(m_tankOf.size(), -1);
+	for (int node = 0; node < (int)m_tankOf.size(); node++) {
+		if (affected[m_component[node]]) {
+			local[node] = (int)members.size();
+			members.push_back(node);
+		}
+	}
+
+	int count = (int)members.size();
+	std::vector<int> adjBegin(count + 1, 0);
+	std::vector<int> adj;
+	for (int i = 0; i < count; i++) {
+		adjBegin[i] = (int)adj.size();
+		auto out = m_out.find(m_tankOf[members[i]]);
+		if (out != m_out.end()) {
+			for (const auto& edge : out->second) {
+				adj.push_back(m_node.at(edge.first));
+			}
+		}
+	}
+	adjBegin[count] = (int)adj.size();
+
+	std::vector<int> index(count, -1);
+	std::vector<int> low(count, 0);
+	std::vector<int> next(count, 0);
+	std::vector<char> onStack(count, 0);
+	std::vector<int> stack;
+	std::vector<int> path;
+	std::vector<int> group;
+	int counter = 0;
+
+	for (int root = 0; root < count; root++) {
+		if (index[root] >= 0) {
+			continue;
+		}
+
+		path.push_back(root);
+		while (!path.empty()) {
+			int i = path.back();
+
+			if (index[i] < 0) {
+				index[i] = low[i] = counter++;
+				next[i] = adjBegin[i];
+				stack.push_back(i);
+				onStack[i] = 1;
+			}
+
+			if (next[i] < adjBegin[i + 1]) {
+				int child = local[adj[next[i]++]];
+				if (child < 0) {
+					continue;
+				}
+				if (index[child] < 0) {
+					path.push_back(child);
+				}
+				else if (onStack[child]) {
+					low[i] = std::min(low[i], index[child]);
+				}
+				continue;
+			}
+
+			if (low[i] == index[i]) {
+				int added = newComponent();
+				if (added < 0) {
+					m_stale = true;
+					return;
+				}
+
+				group.clear();
+				int member = -1;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = 0;
+					m_component[members[member]] = added;
+					group.push_back(member);
+				} while (member != i);
+				m_size[added] = (int)group.size();
+
+				uint64_t* row = &m_closure[(size_t)added * m_words];
+				row[added / 64] |= 1ULL << (added % 64);
+				for (int j : group) {
+					for (int edge = adjBegin[j]; edge < adjBegin[j + 1]; edge++) {
+						int successor = m_component[adj[edge]];
+						if (successor != added) {
+							const uint64_t* reached = &m_closure[(size_t)successor * m_words];
+							for (int word = 0; word < m_words; word++) {
+								row[word] |= reached[word];
+							}
+						}
+					}
+				}
+			}
+
+			path.pop_back();
+			if (!path.empty()) {
+				low[path.back()] = std::min(low[path.back()], low[i]);
+			}
+		}
+	}
+
+	m_ordered = false;
+	charge(((size_t)m_components + adj.size()) * m_words + m_tankOf.size());
+}
+
+/*
+ * Function: tanksReach
+ * --------------------
+ * reachable on the cache as it is, both tanks must exist
+ */
+bool ReachIndex::tanksReach(int source, int target) const {
+	if (source == target) {
+		return true;
+	}
+
+	int from = node(source);
+	int to = node(target);
+	if (from < 0 || to < 0) {
+		return false;
+	}
+
+	return componentReaches(m_component[from], m_component[to]);
+}
+
+/*
+ * Function: charge
+ * ----------------
+ * work: Row words an upkeep step touched
+ *
+ * Once upkeep since the last query has cost more than rebuilding the components and the
+ * closure would, the cache is left stale for the next query to rebuild
+ */
+void ReachIndex::charge(size_t work) {
+	m_work += work;
+	if (m_work > ((size_t)m_components + m_pairs) * m_words + m_tankOf.size()) {
+		m_stale = true;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef REACH_H
+#define REACH_H
+#include "memory.h"
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+// ReachIndex answers "can fuel from tank A reach tank B" over the pump graph.
+// A rebuild finds the strongly connected components and the transitive
+// closure of the condensed DAG as one bitset row per component, so queries
+// are O(1). While the closure is current, FuelSys's changes keep it current:
+// a pump between components that closes no loop ORs the target's row into
+// the rows of every component reaching the source, and a pump that closes a
+// loop, a removed pump or a removed tank recomputes only the components that
+// reach the change, reusing their numbers. Component numbers then no longer follow the DAG, so
+// drainOrder rebuilds once. Upkeep that costs more between two queries than
+// a rebuild would, as when a plant is loaded pump by pump, gives up and
+// leaves the rebuild to the next query. Past MAXCLOSURE components the rows
+// would take too much memory, so changes mark the cache stale and queries
+// after a rebuild search the condensed DAG instead.
+class ReachIndex {
+public:
+    static const int MAXCLOSURE = 8192;
+    ReachIndex();
+    void addTank(int tankID);
+    void removeTank(int tankID);
+    void addEdge(int source, int target);
+    void removeEdge(int source, int target);
+    void clear();
+    // true if fuel can flow from source to target through one or more pumps, or they are the same tank
+    bool reachable(int source, int target) const;
+    // true if each tank can reach the other
+    bool sameComponent(int first, int second) const;
+    // tanks with no pumps in or out
+    std::vector<int> isolated() const;
+    // true if some tank can send fuel back to itself
+    bool hasCycle() const;
+    // groups of tanks that can all reach each other, each sorted by ID
+    std::vector<std::vector<int>> cycles() const;
+    // tanks on no cycle, every pump between them goes from an earlier tank to a later one
+    std::vector<int> topologicalOrder() const;
+    // estimated from the container sizes and the number of connected tank pairs
+    void memory(HeapBytes& heap) const;
+private:
+    std::unordered_set<int> m_tanks;
+    std::unordered_map<int, std::unordered_map<int, int>> m_out; // source to target to pump count
+    std::unordered_map<int, std::unordered_map<int, int>> m_in;  // target to source to pump count
+    size_t m_pairs;                                               // entries in m_out, and in m_in
+    // cache, rebuilt on the first query after a change
+    mutable bool m_stale;
+    mutable std::unordered_map<int, int> m_node;   // tank ID to node
+    mutable std::vector<int> m_tankOf;             // node to tank ID
+    mutable std::vector<int> m_component;          // node to component, sinks are numbered first
+    mutable int m_components;
+    mutable std::vector<int> m_size;               // tanks in each component
+    mutable std::vector<int> m_dagBegin;           // condensed DAG in CSR form
+    mutable std::vector<int> m_dagEdges;
+    mutable std::vector<uint64_t> m_closure;       // one row of bits per component
+    mutable int m_words;
+    mutable bool m_closed;                         // the closure rows exist
+    mutable bool m_ordered;                        // numbers and m_dagEdges match the graph
+    mutable std::vector<int> m_freeComponents;     // numbers recompute left empty, for reuse
+    mutable size_t m_work;                         // row words upkeep touched since the last query
+    void rebuild() const;
+    void findComponents() const;
+    void buildClosure() const;
+    bool componentReaches(int from, int to) const;
+    bool tanksReach(int source, int target) const;
+    int node(int tankID) const;
+    // incremental upkeep, only while the closure is current
+    bool closed() const { return !m_stale && m_closed; }
+    bool hasBit(int component, int bit) const { return (m_closure[(size_t)component * m_words + bit / 64] >> (bit % 64)) & 1; }
+    void insertEdge(int source, int target);
+    int ensureNode(int tankID);
+    int newComponent();
+    void recompute(int component);
+    void charge(size_t work);
+};
+#endif
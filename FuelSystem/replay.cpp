@@ -0,0 +1,182 @@
+#include "fuel.h"
+#include "shard.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const int NUMCOMMANDS = DRAINTANK + 1;
+static const char* const COMMANDNAMES[NUMCOMMANDS] = { "addTank", "removeTank", "addPump", "removePump", "fill", "drain" };
+
+class Replay {
+public:
+    Replay(const Trace& trace) : m_trace(trace), m_mismatches(0), m_seconds(0.0) {}
+
+    /*
+     * Function: direct
+     * ----------------
+     * Replays the trace on a new FuelSys on this thread, timing each call on its own
+     */
+    void direct() {
+        FuelSys sys;
+        auto start = Clock::now();
+
+        for (const TraceEntry& entry : m_trace.entries()) {
+            auto before = Clock::now();
+            bool result = applyCommand(sys, entry.command);
+            add(entry, result, Clock::now() - before);
+        }
+
+        m_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /*
+     * Function: queue
+     * ---------------
+     * Posts the trace from this thread to a CommandQueue whose owner thread applies it.
+     * Each call is timed from post to its result, so the time includes waiting in the ring
+     */
+    void queue() {
+        FuelSys sys;
+        CommandQueue commands(sys, 4096);
+        const std::vector<TraceEntry>& entries = m_trace.entries();
+        std::vector<Clock::time_point> posted(entries.size());
+        std::vector<Clock::duration> taken(entries.size());
+        std::vector<char> results(entries.size());
+        auto start = Clock::now();
+
+        commands.start();
+        for (size_t i = 0; i < entries.size(); i++) {
+            posted[i] = Clock::now();
+            commands.post(entries[i].command, [&posted, &taken, &results, i](bool result) {
+                taken[i] = Clock::now() - posted[i];
+                results[i] = result;
+            });
+        }
+        commands.stop();
+
+        m_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        for (size_t i = 0; i < entries.size(); i++) {
+            add(entries[i], results[i], taken[i]);
+        }
+    }
+
+    /*
+     * Function: sharded
+     * -----------------
+     * numShards: Shard threads to split the tanks over
+     *
+     * Replays the trace through a ShardedFuelSys, timing each call on its own
+     */
+    void sharded(int numShards) {
+        ShardedFuelSys sys(numShards);
+        auto start = Clock::now();
+
+        for (const TraceEntry& entry : m_trace.entries()) {
+            auto before = Clock::now();
+            bool result = applyCommand(sys, entry.command);
+            add(entry, result, Clock::now() - before);
+        }
+
+        m_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /*
+     * Function: report
+     * ----------------
+     * Prints the count, mean, median, 99th percentile and worst time of each type of call,
+     * the overall rate and how many results differ from the recorded ones
+     */
+    void report(const string& mode) {
+        long long total = 0;
+
+        for (int type = 0; type < NUMCOMMANDS; type++) {
+            std::vector<long long>& samples = m_samples[type];
+            if (samples.empty()) {
+                continue;
+            }
+
+            std::sort(samples.begin(), samples.end());
+            long long sum = 0;
+            for (long long sample : samples) {
+                sum += sample;
+            }
+            total += (long long)samples.size();
+
+            cout << mode << "/" << COMMANDNAMES[type] << "  calls: " << samples.size()
+                << "  mean ns: " << sum / (long long)samples.size()
+                << "  p50 ns: " << samples[samples.size() / 2]
+                << "  p99 ns: " << samples[samples.size() * 99 / 100]
+                << "  max ns: " << samples.back() << "\n";
+        }
+
+        cout << mode << "  calls: " << total << "  seconds: " << m_seconds
+            << "  calls/s: " << (m_seconds > 0 ? total / m_seconds : 0.0)
+            << "  mismatched results: " << m_mismatches << "\n";
+    }
+
+private:
+    const Trace& m_trace;
+    std::vector<long long> m_samples[NUMCOMMANDS];
+    long long m_mismatches;
+    double m_seconds;
+
+    void add(const TraceEntry& entry, bool result, Clock::duration taken) {
+        m_samples[entry.command.type].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(taken).count());
+        if (result != entry.result) {
+            m_mismatches++;
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && string(argv[1]) == "--generate") {
+        Trace trace;
+        trace.generate(std::atoi(argv[3]), argc > 4 ? std::atoi(argv[4]) : 1000);
+        if (!trace.save(argv[2])) {
+            cout << "could not write " << argv[2] << "\n";
+            return 1;
+        }
+        cout << "wrote " << trace.size() << " calls to " << argv[2] << "\n";
+        return 0;
+    }
+
+    if (argc < 2) {
+        cout << "usage: replay <trace> [direct|queue|shards=N] [repeat]\n"
+            << "       replay --generate <trace> <calls> [tanks]\n";
+        return 1;
+    }
+
+    Trace trace;
+    if (!trace.load(argv[1])) {
+        cout << "could not read a trace from " << argv[1] << "\n";
+        return 1;
+    }
+
+    string mode = argc > 2 ? argv[2] : "direct";
+    int repeat = argc > 3 ? std::atoi(argv[3]) : 1;
+    Replay replay(trace);
+
+    for (int i = 0; i < repeat; i++) {
+        if (mode == "direct") {
+            replay.direct();
+        }
+        else if (mode == "queue") {
+            replay.queue();
+        }
+        else if (mode.compare(0, 7, "shards=") == 0 && std::atoi(mode.c_str() + 7) > 0) {
+            replay.sharded(std::atoi(mode.c_str() + 7));
+        }
+        else {
+            cout << "unknown mode " << mode << "\n";
+            return 1;
+        }
+    }
+
+    replay.report(mode);
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "shard.h"
+#include <algorithm>
+#include <cstdint>
+
+ShardedFuelSys::ShardedFuelSys(int numShards, int rangeSize) {
+	m_rangeSize = rangeSize < 0 ? 0 : rangeSize;
+
+	for (int shard = 0; shard < std::max(numShards, 1); shard++) {
+		m_shards.push_back(std::make_unique<Shard>());
+		m_shards.back()->queue.start();
+	}
+}
+
+ShardedFuelSys::~ShardedFuelSys() {
+	for (std::unique_ptr<Shard>& shard : m_shards) {
+		shard->queue.stop();
+	}
+}
+
+/*
+ * Function: shardOf
+ * -----------------
+ * return: Index of the shard that owns the tank ID
+ */
+int ShardedFuelSys::shardOf(int tankID) const {
+	int numShards = (int)m_shards.size();
+
+	if (m_rangeSize > 0) {
+		if (tankID < 0) {
+			return 0;
+		}
+		return std::min(tankID / m_rangeSize, numShards - 1);
+	}
+
+	return (int)(((uint32_t)tankID * 2654435761u) % (uint32_t)numShards);
+}
+
+long long ShardedFuelSys::pumpKey(int tankID, int pumpID) {
+	return ((long long)tankID << 32) | (uint32_t)pumpID;
+}
+
+//Runs a command on the shard's thread and waits for its result
+bool ShardedFuelSys::post(int shard, const Command& command) {
+	return m_shards[shard]->queue.submit(command).get();
+}
+
+//Runs a function on the shard's thread and waits for its result
+template <class T>
+T ShardedFuelSys::call(int shard, std::function<T(FuelSys&)> task) {
+	std::promise<T> promise;
+	std::future<T> result = promise.get_future();
+
+	m_shards[shard]->queue.execute([&](FuelSys& sys) {
+		promise.set_value(task(sys));
+	});
+
+	return result.get();
+}
+
+bool ShardedFuelSys::addTank(int tankID, int capacity) {
+	return post(shardOf(tankID), Command{ ADDTANK, tankID, 0, 0, capacity });
+}
+
+/*
+ * Function: removeTank
+ * --------------------
+ * The owning shard removes the tank and its local pumps, then the cross-shard pumps
+ * from or into the tank are dropped
+ *
+ * return: True if the tank existed
+ */
+bool ShardedFuelSys::removeTank(int tankID) {
+	if (!post(shardOf(tankID), Command{ REMOVETANK, tankID, 0, 0, 0 })) {
+		return false;
+	}
+
+	for (auto pump = m_cross.begin(); pump != m_cross.end();) {
+		if ((int)(pump->first >> 32) == tankID || pump->second == tankID) {
+			pump = m_cross.erase(pump);
+		}
+		else {
+			++pump;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Function: addPump
+ * -----------------
+ * A pump within one shard is added to that shard. A pump into another shard is kept
+ * here once both shards confirm their tank exists and the ID is unused
+ *
+ * return: True if the pump was added
+ */
+bool ShardedFuelSys::addPump(int tankID, int pumpID, int targetTank) {
+	if (pumpID < 0 || tankID == targetTank || m_cross.count(pumpKey(tankID, pumpID)) > 0) {
+		return false;
+	}
+
+	int source = shardOf(tankID);
+	int target = shardOf(targetTank);
+	if (source == target) {
+		return post(source, Command{ ADDPUMP, tankID, pumpID, targetTank, 0 });
+	}
+
+	bool sourceFree = call<bool>(source, [&](FuelSys& sys) {
+		Tank* tank = sys.getTank(tankID);
+		return tank != nullptr && sys.getPump(tank, pumpID) == nullptr;
+	});
+	bool targetExists = sourceFree && call<bool>(target, [&](FuelSys& sys) {
+		return sys.getTank(targetTank) != nullptr;
+	});
+	if (!targetExists) {
+		return false;
+	}
+
+	m_cross[pumpKey(tankID, pumpID)] = targetTank;
+	return true;
+}
+
+bool ShardedFuelSys::removePump(int tankID, int pumpID) {
+	if (m_cross.erase(pumpKey(tankID, pumpID)) > 0) {
+		return true;
+	}
+
+	return post(shardOf(tankID), Command{ REMOVEPUMP, tankID, pumpID, 0, 0 });
+}
+
+bool ShardedFuelSys::fill(int tankID, int fuel) {
+	return post(shardOf(tankID), Command{ FILLTANK, tankID, 0, 0, fuel });
+}
+
+/*
+ * Function: drain
+ * ---------------
+ * A cross-shard drain runs in three steps, each on the thread of the shard it touches:
+ * reserve up to fuel in the source without changing its level, deposit what fits into
+ * the target, and take only the deposited amount out of the source. Only the controller
+ * thread changes tanks, so the reserved fuel is still there at the end. Each tank changes
+ * level once, so feeds and alarms never see a withdrawal that is later handed back
+ *
+ * return: True if the target had space
+ */
+bool ShardedFuelSys::drain(int tankID, int pumpID, int fuel) {
+	if (fuel < 0) {
+		return false;
+	}
+
+	auto cross = m_cross.find(pumpKey(tankID, pumpID));
+	if (cross == m_cross.end()) {
+		return post(shardOf(tankID), Command{ DRAINTANK, tankID, pumpID, 0, fuel });
+	}
+
+	int source = shardOf(tankID);
+	int targetTank = cross->second;
+
+	int reserved = call<int>(source, [&](FuelSys& sys) {
+		return std::min(fuel, sys.getTank(tankID)->m_tankFuel);
+	});
+
+	//-1 if the target is full
+	int deposited = call<int>(shardOf(targetTank), [&](FuelSys& sys) {
+		Tank* tank = sys.getTank(targetTank);
+		int space = tank->m_tankCapacity - tank->m_tankFuel;
+		if (space == 0) {
+			return -1;
+		}
+		int amount = std::min(reserved, space);
+		sys.setFuel(tank, tank->m_tankFuel + amount, DRAINCHANGE);
+		return amount;
+	});
+
+	if (deposited > 0) {
+		call<int>(source, [&](FuelSys& sys) {
+			Tank* tank = sys.getTank(tankID);
+			sys.setFuel(tank, tank->m_tankFuel - deposited, DRAINCHANGE);
+			return deposited;
+		});
+	}
+
+	return deposited >= 0;
+}
+
+/*
+ * Function: totalFuel
+ * -------------------
+ * Every shard sums its own tanks at the same time on its own thread
+ *
+ * return: The sum of fuel in all shards
+ */
+long long ShardedFuelSys::totalFuel() {
+	std::vector<std::promise<long long>> sums(m_shards.size());
+
+	for (size_t shard = 0; shard < m_shards.size(); shard++) {
+		std::promise<long long>& sum = sums[shard];
+		m_shards[shard]->queue.execute([&sum](FuelSys& sys) {
+			sum.set_value(sys.totalFuel());
+		});
+	}
+
+	long long total = 0;
+	for (std::promise<long long>& sum : sums) {
+		total += sum.get_future().get();
+	}
+
+	return total;
+}
+
+int ShardedFuelSys::level(int tankID) {
+	return call<int>(shardOf(tankID), [&](FuelSys& sys) {
+		Tank* tank = sys.getTank(tankID);
+		return tank == nullptr ? -1 : tank->m_tankFuel;
+	});
+}
@@ -0,0 +1,56 @@
+#ifndef SHARD_H
+#define SHARD_H
+#include "command.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+// ShardedFuelSys splits one plant into independent FuelSys shards, each
+// owned by its own thread behind a CommandQueue, so operations on tanks in
+// different shards run in parallel and each list stays short. A tank lives
+// in the shard its ID maps to, by hash or by ID range.
+//
+// Pumps between tanks of the same shard are ordinary pumps of that shard.
+// A pump into another shard is kept here and drained in two phases: the
+// source shard reserves the fuel without changing its level, the target
+// shard deposits what fits, and only then is the deposited amount taken out
+// of the source, so each tank's level changes once. totalFuel asks every
+// shard for its sum at once and adds the results.
+//
+// The public functions are meant to be called from one controller thread.
+class ShardedFuelSys {
+public:
+    friend class Tester;
+    // rangeSize 0 spreads tanks by a hash of their ID, otherwise IDs
+    // [k * rangeSize, (k + 1) * rangeSize) go to shard k, the last shard takes the rest
+    ShardedFuelSys(int numShards, int rangeSize = 0);
+    ~ShardedFuelSys();
+    bool addTank(int tankID, int capacity);
+    bool removeTank(int tankID);
+    bool addPump(int tankID, int pumpID, int targetTank);
+    bool removePump(int tankID, int pumpID);
+    bool fill(int tankID, int fuel);
+    // same clamping and result as FuelSys::drain, across shards too
+    bool drain(int tankID, int pumpID, int fuel);
+    long long totalFuel();
+    // fuel in the tank, -1 if it does not exist
+    int level(int tankID);
+    int shards() const { return (int)m_shards.size(); }
+    int shardOf(int tankID) const;
+    // pumps whose target is in another shard
+    int crossPumps() const { return (int)m_cross.size(); }
+private:
+    struct Shard {
+        FuelSys sys;
+        CommandQueue queue;
+        Shard() : queue(sys) {}
+    };
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    int m_rangeSize;
+    // cross-shard pumps, (tank ID, pump ID) to target tank ID
+    std::unordered_map<long long, int> m_cross;
+    static long long pumpKey(int tankID, int pumpID);
+    bool post(int shard, const Command& command);
+    template <class T>
+    T call(int shard, std::function<T(FuelSys&)> task);
+};
+#endif
@@ -0,0 +1,299 @@
+#include "sim.h"
+#include <barrier>
+#include <thread>
+
+FlowSim::FlowSim(int numThreads) {
+	m_threads = numThreads < 1 ? 1 : numThreads;
+	m_elapsed = 0;
+}
+
+/*
+ * Function: load
+ * --------------
+ * sys: Fuel system to simulate
+ *
+ * Flattens the tanks and pumps of the system into arrays. Every pump starts stopped with a rate of 0
+ */
+void FlowSim::load(const FuelSys& sys) {
+	m_index.clear();
+	m_tankIDs.clear();
+	m_capacity.clear();
+	m_fuel.clear();
+	m_outBegin.clear();
+	m_pumpIDs.clear();
+	m_dst.clear();
+	m_elapsed = 0;
+
+	for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+		m_index[tank->m_tankID] = (int)m_tankIDs.size();
+		m_tankIDs.push_back(tank->m_tankID);
+		m_capacity.push_back(tank->m_tankCapacity);
+		m_fuel.push_back(tank->m_tankFuel);
+	}
+
+	//Pumps are stored in tank order so each tank owns a contiguous range
+	for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+		m_outBegin.push_back((int)m_pumpIDs.size());
+
+		for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+			m_pumpIDs.push_back(pump->m_pumpID);
+			m_dst.push_back(m_index[sys.targetID(pump)]);
+		}
+	}
+	m_outBegin.push_back((int)m_pumpIDs.size());
+
+	int numTanks = (int)m_tankIDs.size();
+	int numPumps = (int)m_pumpIDs.size();
+	m_rate.assign(numPumps, 0);
+	m_active.assign(numPumps, 0);
+	m_flow.assign(numPumps, 0);
+
+	//Counting sort of the pumps by destination
+	m_inBegin.assign(numTanks + 1, 0);
+	for (int pump = 0; pump < numPumps; pump++) {
+		m_inBegin[m_dst[pump] + 1]++;
+	}
+	for (int tank = 0; tank < numTanks; tank++) {
+		m_inBegin[tank + 1] += m_inBegin[tank];
+	}
+	m_inPumps.assign(numPumps, 0);
+	std::vector<int> fillPos(m_inBegin.begin(), m_inBegin.end() - 1);
+	for (int pump = 0; pump < numPumps; pump++) {
+		m_inPumps[fillPos[m_dst[pump]]++] = pump;
+	}
+}
+
+/*
+ * Function: store
+ * ---------------
+ * sys: Fuel system that was loaded
+ *
+ * Copies the simulated fuel levels back into the matching tanks
+ */
+void FlowSim::store(FuelSys& sys) const {
+	for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+		auto found = m_index.find(tank->m_tankID);
+		if (found != m_index.end()) {
+			sys.setFuel(tank, m_fuel[found->second], DRAINCHANGE);
+		}
+	}
+}
+
+/*
+ * Function: findPump
+ * ------------------
+ * return: Array index of the pump, -1 if the tank or pump was not loaded
+ */
+int FlowSim::findPump(int tankID, int pumpID) const {
+	auto found = m_index.find(tankID);
+	if (found == m_index.end()) {
+		return -1;
+	}
+
+	int tank = found->second;
+	for (int pump = m_outBegin[tank]; pump < m_outBegin[tank + 1]; pump++) {
+		if (m_pumpIDs[pump] == pumpID) {
+			return pump;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Function: setRate
+ * -----------------
+ * rate: kg moved per second while the pump is active
+ *
+ * return: True if the pump exists and the rate is valid
+ */
+bool FlowSim::setRate(int tankID, int pumpID, int rate) {
+	int pump = findPump(tankID, pumpID);
+	if (pump < 0 || rate < 0) {
+		return false;
+	}
+
+	m_rate[pump] = rate;
+	return true;
+}
+
+/*
+ * Function: setActive
+ * -------------------
+ * return: True if the pump exists
+ */
+bool FlowSim::setActive(int tankID, int pumpID, bool active) {
+	int pump = findPump(tankID, pumpID);
+	if (pump < 0) {
+		return false;
+	}
+
+	m_active[pump] = active;
+	return true;
+}
+
+/*
+ * Function: clampSource
+ * ---------------------
+ * begin, end: Range of tanks to process
+ * dt: Length of the step in seconds
+ *
+ * Each pump requests rate * dt. If a tank's pumps request more than it holds,
+ * the requests are scaled down so the tank is drained at most to empty. A request
+ * can be close to 2^62, so the sum and the scaling are done in 128 bits. Afterwards
+ * no flow is more than its source holds, which keeps clampDestination in 64 bits
+ */
+void FlowSim::clampSource(int begin, int end, long long dt) {
+	for (int tank = begin; tank < end; tank++) {
+		int first = m_outBegin[tank];
+		int last = m_outBegin[tank + 1];
+		__int128 requested = 0;
+
+		for (int pump = first; pump < last; pump++) {
+			m_flow[pump] = m_active[pump] * m_rate[pump] * dt;
+			requested += m_flow[pump];
+		}
+
+		long long fuel = m_fuel[tank];
+		if (requested > fuel) {
+			for (int pump = first; pump < last; pump++) {
+				m_flow[pump] = (long long)(m_flow[pump] * (__int128)fuel / requested);
+			}
+		}
+	}
+}
+
+/*
+ * Function: clampDestination
+ * --------------------------
+ * begin, end: Range of tanks to process
+ *
+ * Scales down the flows into a tank that would overflow it. The free space is
+ * taken at the start of the step, so the result never exceeds capacity
+ */
+void FlowSim::clampDestination(int begin, int end) {
+	for (int tank = begin; tank < end; tank++) {
+		int first = m_inBegin[tank];
+		int last = m_inBegin[tank + 1];
+		long long incoming = 0;
+
+		for (int entry = first; entry < last; entry++) {
+			incoming += m_flow[m_inPumps[entry]];
+		}
+
+		long long space = m_capacity[tank] - m_fuel[tank];
+		if (incoming > space) {
+			for (int entry = first; entry < last; entry++) {
+				int pump = m_inPumps[entry];
+				m_flow[pump] = m_flow[pump] * space / incoming;
+			}
+		}
+	}
+}
+
+/*
+ * Function: apply
+ * ---------------
+ * begin, end: Range of tanks to process
+ *
+ * Moves the clamped flows in and out of each tank
+ */
+void FlowSim::apply(int begin, int end) {
+	for (int tank = begin; tank < end; tank++) {
+		long long delta = 0;
+
+		for (int pump = m_outBegin[tank]; pump < m_outBegin[tank + 1]; pump++) {
+			delta -= m_flow[pump];
+		}
+		for (int entry = m_inBegin[tank]; entry < m_inBegin[tank + 1]; entry++) {
+			delta += m_flow[m_inPumps[entry]];
+		}
+
+		m_fuel[tank] += (int)delta;
+	}
+}
+
+/*
+ * Function: run
+ * -------------
+ * steps: Number of steps to simulate
+ * dt: Length of each step in seconds
+ *
+ * Every active pump transfers concurrently within a step. Each phase only
+ * writes the data of the tanks in its range, so the tanks are split across
+ * the worker threads and the phases are separated by a barrier
+ */
+void FlowSim::run(long long steps, int dt) {
+	int numTanks = (int)m_tankIDs.size();
+	if (steps <= 0 || dt <= 0 || numTanks == 0) {
+		return;
+	}
+
+	int workers = m_threads;
+	if (workers > numTanks) {
+		workers = numTanks;
+	}
+
+	if (workers == 1) {
+		for (long long step = 0; step < steps; step++) {
+			clampSource(0, numTanks, dt);
+			clampDestination(0, numTanks);
+			apply(0, numTanks);
+		}
+	}
+	else {
+		std::barrier<> phase(workers);
+		std::vector<std::thread> threads;
+
+		for (int worker = 0; worker < workers; worker++) {
+			int begin = (int)((long long)numTanks * worker / workers);
+			int end = (int)((long long)numTanks * (worker + 1) / workers);
+
+			threads.emplace_back([this, &phase, begin, end, steps, dt]() {
+				for (long long step = 0; step < steps; step++) {
+					clampSource(begin, end, dt);
+					phase.arrive_and_wait();
+					clampDestination(begin, end);
+					phase.arrive_and_wait();
+					apply(begin, end);
+					phase.arrive_and_wait();
+				}
+			});
+		}
+
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	m_elapsed += steps * dt;
+}
+
+/*
+ * Function: level
+ * ---------------
+ * return: Simulated fuel in the tank, -1 if the tank was not loaded
+ */
+int FlowSim::level(int tankID) const {
+	auto found = m_index.find(tankID);
+	if (found == m_index.end()) {
+		return -1;
+	}
+
+	return m_fuel[found->second];
+}
+
+/*
+ * Function: totalFuel
+ * -------------------
+ * return: The sum of fuel in all simulated tanks
+ */
+long long FlowSim::totalFuel() const {
+	long long total = 0;
+
+	for (int fuel : m_fuel) {
+		total += fuel;
+	}
+
+	return total;
+}
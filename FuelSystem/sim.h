@@ -0,0 +1,51 @@
+#ifndef SIM_H
+#define SIM_H
+#include "fuel.h"
+#include <vector>
+#include <unordered_map>
+// FlowSim advances a copy of a fuel system in discrete time steps.
+// Tanks and pumps are flattened into arrays: pumps are grouped by source
+// tank (m_outBegin) and indexed by destination tank (m_inBegin/m_inPumps)
+// so every phase of a step is a loop over one tank's own range.
+class FlowSim {
+public:
+    FlowSim(int numThreads = 1);
+    // copy the tanks and pumps of the system into the flat arrays
+    void load(const FuelSys& sys);
+    // write the simulated fuel levels back into the system
+    void store(FuelSys& sys) const;
+    // set the flow rate of a pump in kg per second
+    bool setRate(int tankID, int pumpID, int rate);
+    // start or stop a pump
+    bool setActive(int tankID, int pumpID, bool active);
+    // advance the simulation by steps of dt seconds
+    void run(long long steps, int dt = 1);
+    // current fuel of a tank in the simulation, -1 if it was not loaded
+    int level(int tankID) const;
+    // the sum of fuel in all simulated tanks
+    long long totalFuel() const;
+    // simulated seconds since load
+    long long elapsed() const { return m_elapsed; }
+private:
+    int m_threads;
+    long long m_elapsed;
+    std::unordered_map<int, int> m_index; // tank ID to array index
+    // tank arrays
+    std::vector<int> m_tankIDs;
+    std::vector<int> m_capacity;
+    std::vector<int> m_fuel;
+    std::vector<int> m_outBegin; // first pump of each tank, size tanks + 1
+    std::vector<int> m_inBegin;  // first entry of each tank in m_inPumps
+    std::vector<int> m_inPumps;  // pump indices grouped by destination
+    // pump arrays, ordered by source tank
+    std::vector<int> m_pumpIDs;
+    std::vector<int> m_dst;
+    std::vector<int> m_rate;
+    std::vector<char> m_active;
+    std::vector<long long> m_flow; // amount moved by each pump this step
+    int findPump(int tankID, int pumpID) const;
+    void clampSource(int begin, int end, long long dt);
+    void clampDestination(int begin, int end);
+    void apply(int begin, int end);
+};
+#endif
@@ -0,0 +1,184 @@
+#include "snapshot.h"
+
+/*
+ * Function: level
+ * ---------------
+ * return: Fuel in the tank when the snapshot was taken, -1 if it did not exist
+ */
+int Snapshot::level(int tankID) const {
+	auto found = index.find(tankID);
+	if (found == index.end()) {
+		return -1;
+	}
+
+	return fuel[found->second];
+}
+
+/*
+ * Function: targetsOf
+ * -------------------
+ * return: Target tank of each of the tank's pumps, in pump order
+ */
+std::vector<int> Snapshot::targetsOf(int tankID) const {
+	auto found = index.find(tankID);
+	if (found == index.end()) {
+		return std::vector<int>();
+	}
+
+	int tank = found->second;
+	return std::vector<int>(targets.begin() + pumpBegin[tank], targets.begin() + pumpBegin[tank + 1]);
+}
+
+SnapshotPublisher::SnapshotPublisher() : m_current(nullptr), m_epoch(1), m_slots(nullptr) {
+	m_version = 0;
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+	for (const Retired& retired : m_retired) {
+		delete retired.snapshot;
+	}
+	delete m_current.load();
+
+	Slot* slot = m_slots.load();
+	while (slot != nullptr) {
+		Slot* next = slot->next;
+		delete slot;
+		slot = next;
+	}
+}
+
+/*
+ * Function: publish
+ * -----------------
+ * sys: Fuel system to copy
+ *
+ * Builds the new snapshot before swapping it in, so readers only ever see complete
+ * snapshots. The old one is tagged with the epoch it was replaced in and freed later
+ *
+ * return: Version of the new snapshot
+ */
+long long SnapshotPublisher::publish(const FuelSys& sys) {
+	Snapshot* snapshot = new Snapshot();
+	snapshot->version = ++m_version;
+	snapshot->totalFuel = 0;
+
+	for (Tank* tank = sys.m_current; tank != nullptr; tank = tank->m_next) {
+		snapshot->index[tank->m_tankID] = (int)snapshot->tankIDs.size();
+		snapshot->tankIDs.push_back(tank->m_tankID);
+		snapshot->capacity.push_back(tank->m_tankCapacity);
+		snapshot->fuel.push_back(tank->m_tankFuel);
+		snapshot->totalFuel += tank->m_tankFuel;
+
+		snapshot->pumpBegin.push_back((int)snapshot->pumpIDs.size());
+		for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+			snapshot->pumpIDs.push_back(pump->m_pumpID);
+			snapshot->targets.push_back(sys.targetID(pump));
+		}
+	}
+	snapshot->pumpBegin.push_back((int)snapshot->pumpIDs.size());
+
+	const Snapshot* old = m_current.exchange(snapshot);
+	uint64_t epoch = m_epoch.fetch_add(1);
+	if (old != nullptr) {
+		m_retired.push_back(Retired{ old, epoch });
+	}
+
+	reclaim();
+	return snapshot->version;
+}
+
+/*
+ * Function: reclaim
+ * -----------------
+ * A reader pins by announcing the epoch and then loading the current snapshot. One that
+ * still holds a snapshot retired in epoch e announced e or earlier, so every snapshot
+ * retired before the oldest announced epoch is unreachable
+ */
+void SnapshotPublisher::reclaim() {
+	if (m_retired.empty()) {
+		return;
+	}
+
+	uint64_t oldest = m_epoch.load();
+	for (Slot* slot = m_slots.load(); slot != nullptr; slot = slot->next) {
+		uint64_t epoch = slot->epoch.load();
+		if (epoch != 0 && epoch < oldest) {
+			oldest = epoch;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_retired.size(); i++) {
+		if (m_retired[i].epoch < oldest) {
+			delete m_retired[i].snapshot;
+		}
+		else {
+			m_retired[kept++] = m_retired[i];
+		}
+	}
+	m_retired.resize(kept);
+}
+
+long long SnapshotPublisher::version() const {
+	const Snapshot* current = m_current.load(std::memory_order_acquire);
+	return current == nullptr ? 0 : current->version;
+}
+
+/*
+ * Function: acquireSlot
+ * ---------------------
+ * Reuses the slot of a reader that was destroyed, or pushes a new one onto the list
+ *
+ * return: Slot owned by the calling reader
+ */
+SnapshotPublisher::Slot* SnapshotPublisher::acquireSlot() {
+	for (Slot* slot = m_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+		bool expected = false;
+		if (!slot->inUse.load(std::memory_order_relaxed)
+			&& slot->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			return slot;
+		}
+	}
+
+	Slot* slot = new Slot();
+	slot->epoch.store(0, std::memory_order_relaxed);
+	slot->inUse.store(true, std::memory_order_relaxed);
+	slot->next = m_slots.load(std::memory_order_relaxed);
+	while (!m_slots.compare_exchange_weak(slot->next, slot,
+		std::memory_order_release, std::memory_order_relaxed)) {
+	}
+
+	return slot;
+}
+
+SnapshotPublisher::Reader::Reader(SnapshotPublisher& publisher) : m_publisher(publisher) {
+	m_slot = publisher.acquireSlot();
+	m_pins = 0;
+}
+
+SnapshotPublisher::Reader::~Reader() {
+	m_slot->epoch.store(0, std::memory_order_release);
+	m_slot->inUse.store(false, std::memory_order_release);
+}
+
+/*
+ * Function: pin
+ * -------------
+ * The announcement and the load are sequentially consistent so the writer either sees
+ * the announcement when it reclaims or the reader sees the newer snapshot. A nested pin
+ * keeps the first announcement, a later one would let the outer snapshot be freed
+ *
+ * return: The current snapshot, valid until the outermost unpin
+ */
+const Snapshot* SnapshotPublisher::Reader::pin() {
+	if (m_pins++ == 0) {
+		m_slot->epoch.store(m_publisher.m_epoch.load());
+	}
+	return m_publisher.m_current.load();
+}
+
+void SnapshotPublisher::Reader::unpin() {
+	if (m_pins > 0 && --m_pins == 0) {
+		m_slot->epoch.store(0, std::memory_order_release);
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include "fuel.h"
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+// An immutable copy of a fuel system's tanks and pumps. Pumps are grouped
+// by source tank: tank i owns pumps [pumpBegin[i], pumpBegin[i + 1]).
+struct Snapshot {
+    long long version;
+    long long totalFuel;
+    std::vector<int> tankIDs;
+    std::vector<int> capacity;
+    std::vector<int> fuel;
+    std::vector<int> pumpBegin;
+    std::vector<int> pumpIDs;
+    std::vector<int> targets;
+    std::unordered_map<int, int> index; // tank ID to array index
+    // fuel in the tank, -1 if it does not exist
+    int level(int tankID) const;
+    // IDs of the tanks the tank pumps into
+    std::vector<int> targetsOf(int tankID) const;
+};
+// SnapshotPublisher lets reader threads look at a fuel system while the
+// controller thread keeps changing it. FuelSys itself cannot be read
+// concurrently: findTank reorders the list and removal deletes nodes at
+// once. Instead the controller publishes an immutable Snapshot whenever it
+// wants readers to see its changes, and readers load the latest one with
+// no locks. A replaced snapshot is freed only once every reader that could
+// still hold it has moved on (epoch-based reclamation), so the writer never
+// waits for readers and readers never wait for the writer.
+class SnapshotPublisher {
+public:
+    class Reader;
+    SnapshotPublisher();
+    // only call once no reader is active
+    ~SnapshotPublisher();
+    // copy the system into a new snapshot and make it current, return its version
+    long long publish(const FuelSys& sys);
+    // free replaced snapshots no reader can still hold
+    void reclaim();
+    // replaced snapshots not freed yet
+    int retired() const { return (int)m_retired.size(); }
+    // version of the current snapshot, 0 before the first publish
+    long long version() const;
+private:
+    // one reader's announced epoch, 0 while it holds no snapshot
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> inUse;
+        Slot* next;
+    };
+    struct Retired {
+        const Snapshot* snapshot;
+        uint64_t epoch;
+    };
+    std::atomic<const Snapshot*> m_current;
+    std::atomic<uint64_t> m_epoch;
+    std::atomic<Slot*> m_slots;
+    std::vector<Retired> m_retired; // only touched by the writer
+    long long m_version;
+    Slot* acquireSlot();
+    friend class Reader;
+};
+// A reader thread's handle. pin returns the current snapshot, which stays
+// valid until unpin. Pins nest, so every snapshot pinned stays valid until
+// the outermost unpin. One reader must only be used by one thread at a time.
+class SnapshotPublisher::Reader {
+public:
+    Reader(SnapshotPublisher& publisher);
+    ~Reader();
+    // current snapshot, nullptr before the first publish
+    const Snapshot* pin();
+    void unpin();
+private:
+    SnapshotPublisher& m_publisher;
+    Slot* m_slot;
+    int m_pins; // pins not yet matched by an unpin
+};
+// pins on construction and unpins at the end of the scope
+class ReadGuard {
+public:
+    ReadGuard(SnapshotPublisher::Reader& reader) : m_reader(reader), m_snapshot(reader.pin()) {}
+    ~ReadGuard() { m_reader.unpin(); }
+    const Snapshot* get() const { return m_snapshot; }
+    const Snapshot* operator->() const { return m_snapshot; }
+private:
+    SnapshotPublisher::Reader& m_reader;
+    const Snapshot* m_snapshot;
+};
+#endif
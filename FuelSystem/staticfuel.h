@@ -0,0 +1,399 @@
+#ifndef STATICFUEL_H
+#define STATICFUEL_H
+#include "fuel.h"
+#include <array>
+#include <cstdint>
+#include <type_traits>
+// StaticFuelSys has the same operations and results as FuelSys but stores
+// at most MaxTanks tanks and MaxPumps pumps inline, so it never allocates.
+// Nodes link through 16-bit indices when both limits fit, 32-bit otherwise.
+// Construction only sets a few indices and counters: nodes are handed out from a
+// high-water mark and freed nodes are chained for reuse. addTank and addPump
+// return false once the storage is full.
+template <int MaxTanks, int MaxPumps, int MinCap = MINCAP>
+class StaticFuelSys {
+    static_assert(MaxTanks > 0, "StaticFuelSys needs room for at least one tank");
+    static_assert(MaxPumps >= 0, "StaticFuelSys cannot have a negative pump limit");
+    static_assert(MinCap > 0, "the minimum capacity must be positive");
+    static_assert(MaxTanks < 0x7FFFFFFF && MaxPumps < 0x7FFFFFFF, "limits must fit a 32-bit index");
+public:
+    friend class Tester;
+    typedef std::conditional_t<(MaxTanks < 0xFFFF && MaxPumps < 0xFFFF), uint16_t, uint32_t> Index;
+    static constexpr Index NONE = (Index)~(Index)0;
+    static constexpr int maxTanks() { return MaxTanks; }
+    static constexpr int maxPumps() { return MaxPumps; }
+    static constexpr int minCap() { return MinCap; }
+
+    StaticFuelSys() : m_current(NONE), m_freeTanks(NONE), m_freePumps(NONE), m_usedTanks(0), m_usedPumps(0),
+        m_liveTanks(0), m_livePumps(0) {}
+
+    /*
+     * Function: addTank
+     * -----------------
+     * return: True if a tank was created, false if the ID or capacity is invalid, the ID exists or the storage is full
+     */
+    bool addTank(int tankID, int capacity) {
+        if (tankID < 0 || capacity < MinCap) {
+            return false;
+        }
+
+        if (m_current == NONE) {
+            m_current = newTank(tankID, capacity);
+            return m_current != NONE;
+        }
+
+        if (!findTank(tankID)) {
+            Index endTank = m_current;
+            while (m_tanks[endTank].m_next != NONE) {
+                endTank = m_tanks[endTank].m_next;
+            }
+
+            Index tank = newTank(tankID, capacity);
+            m_tanks[endTank].m_next = tank;
+            return tank != NONE;
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: removeTank
+     * --------------------
+     * Removes the tank, its pumps and every pump of other tanks that targets it
+     *
+     * return: True if the tank is removed from the list, else false
+     */
+    bool removeTank(int tankID) {
+        Index currentTank = m_current;
+        Index previousTank = NONE;
+
+        while (currentTank != NONE && m_tanks[currentTank].m_tankID != tankID) {
+            previousTank = currentTank;
+            currentTank = m_tanks[currentTank].m_next;
+        }
+
+        if (currentTank == NONE) {
+            return false;
+        }
+
+        if (previousTank == NONE) {
+            m_current = m_tanks[currentTank].m_next;
+        }
+        else {
+            m_tanks[previousTank].m_next = m_tanks[currentTank].m_next;
+        }
+
+        Index pump = m_tanks[currentTank].m_pumps;
+        while (pump != NONE) {
+            Index nextPump = m_pumps[pump].m_next;
+            freePump(pump);
+            pump = nextPump;
+        }
+        m_tanks[currentTank].m_next = m_freeTanks;
+        m_freeTanks = currentTank;
+        m_liveTanks--;
+
+        //Delete pumps from other tanks that target this tank
+        for (Index tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+            Index* link = &m_tanks[tank].m_pumps;
+
+            while (*link != NONE) {
+                Index linkPump = *link;
+                if (m_pumps[linkPump].m_target == tankID) {
+                    *link = m_pumps[linkPump].m_next;
+                    freePump(linkPump);
+                }
+                else {
+                    link = &m_pumps[linkPump].m_next;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /*
+     * Function: addPump
+     * -----------------
+     * return: True if the pump was added, false if it is invalid, exists or the storage is full
+     */
+    bool addPump(int tankID, int pumpID, int targetTank) {
+        if (pumpID < 0 || tankID == targetTank) {
+            return false;
+        }
+
+        if (findTank(targetTank) && findTank(tankID)) {
+            Index tank = foundTank();
+
+            if (getPump(tank, pumpID) == NONE) {
+                Index pump = newPump(pumpID, targetTank);
+                if (pump == NONE) {
+                    return false;
+                }
+
+                Index* link = &m_tanks[tank].m_pumps;
+                while (*link != NONE) {
+                    link = &m_pumps[*link].m_next;
+                }
+                *link = pump;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: removePump
+     * --------------------
+     * return: True if the pump is removed, else false
+     */
+    bool removePump(int tankID, int pumpID) {
+        Index tank = getTank(tankID);
+        if (tank == NONE) {
+            return false;
+        }
+
+        Index* link = &m_tanks[tank].m_pumps;
+        while (*link != NONE) {
+            Index pump = *link;
+            if (m_pumps[pump].m_pumpID == pumpID) {
+                *link = m_pumps[pump].m_next;
+                freePump(pump);
+                return true;
+            }
+            link = &m_pumps[pump].m_next;
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: fill
+     * --------------
+     * return: True if some amount of fuel was added to the tank, false if the tank could not be found or it's full
+     */
+    bool fill(int tankID, int fuel) {
+        if (fuel < 0) {
+            return false;
+        }
+
+        if (findTank(tankID)) {
+            TankNode& fillTank = m_tanks[foundTank()];
+            int neededFuel = fillTank.m_tankCapacity - fillTank.m_tankFuel;
+
+            if (neededFuel != 0) {
+                fillTank.m_tankFuel += fuel > neededFuel ? neededFuel : fuel;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: drain
+     * ---------------
+     * return: True if fuel was transferred
+     */
+    bool drain(int tankID, int pumpID, int fuel) {
+        if (fuel < 0) {
+            return false;
+        }
+
+        if (findTank(tankID)) {
+            Index sourceTank = foundTank();
+
+            if (fuel > m_tanks[sourceTank].m_tankFuel) {
+                fuel = m_tanks[sourceTank].m_tankFuel;
+            }
+
+            Index pump = getPump(sourceTank, pumpID);
+            if (pump != NONE) {
+                int targetID = m_pumps[pump].m_target;
+                Index destinationTank = getTank(targetID);
+                int neededFuel = m_tanks[destinationTank].m_tankCapacity - m_tanks[destinationTank].m_tankFuel;
+
+                if (neededFuel != 0) {
+                    if (fuel > neededFuel) {
+                        fuel = neededFuel;
+                    }
+                    m_tanks[sourceTank].m_tankFuel -= fuel;
+                    return fill(targetID, fuel);
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: findTank
+     * ------------------
+     * Searches the list for the ID. If found, it becomes the next of the current tank
+     *
+     * return: True if the tank is found, false otherwise
+     */
+    bool findTank(int tankID) {
+        Index currentTank = m_current;
+        Index previousTank = m_current;
+
+        while (currentTank != NONE) {
+            if (m_tanks[currentTank].m_tankID == tankID) {
+                TankNode& head = m_tanks[m_current];
+
+                if (head.m_tankID == tankID) {
+                    if (head.m_next != NONE) {
+                        Index second = head.m_next;
+                        head.m_next = m_tanks[second].m_next;
+                        m_tanks[second].m_next = m_current;
+                        m_current = second;
+                    }
+                }
+                else if (m_tanks[head.m_next].m_tankID != tankID) {
+                    m_tanks[previousTank].m_next = m_tanks[currentTank].m_next;
+                    m_tanks[currentTank].m_next = head.m_next;
+                    head.m_next = currentTank;
+                }
+                return true;
+            }
+
+            previousTank = currentTank;
+            currentTank = m_tanks[currentTank].m_next;
+        }
+
+        return false;
+    }
+
+    /*
+     * Function: totalFuel
+     * -------------------
+     * return: The total fuel in the system
+     */
+    long long totalFuel() const {
+        long long totalFuel = 0;
+
+        for (Index tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+            totalFuel += m_tanks[tank].m_tankFuel;
+        }
+
+        return totalFuel;
+    }
+
+    /*
+     * Function: memoryUsage
+     * ---------------------
+     * return: Bytes held, all inside the object, with the nodes not in use as slack
+     */
+    MemoryUsage memoryUsage() const {
+        MemoryUsage usage = MemoryUsage{};
+        usage.tanks = m_liveTanks * sizeof(TankNode);
+        usage.pumps = m_livePumps * sizeof(PumpNode);
+        usage.system = sizeof(*this) - sizeof(m_tanks) - sizeof(m_pumps);
+        usage.slack = sizeof(m_tanks) + sizeof(m_pumps) - usage.tanks - usage.pumps;
+        return usage;
+    }
+
+    void dumpSys() const {
+        cout << "Tank List:\n";
+
+        for (Index tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+            const TankNode& node = m_tanks[tank];
+            cout << "Tank: " << node.m_tankID << " Capacity: " << node.m_tankCapacity << " Current Fuel: " << node.m_tankFuel << "\n";
+
+            for (Index pump = node.m_pumps; pump != NONE; pump = m_pumps[pump].m_next) {
+                cout << "Pumps: " << m_pumps[pump].m_pumpID << " Target Tank: " << m_pumps[pump].m_target << "\n";
+            }
+        }
+
+        cout << "Total Fuel: " << totalFuel() << "\n";
+    }
+
+private:
+    struct TankNode {
+        int m_tankID;
+        int m_tankCapacity;
+        int m_tankFuel;
+        Index m_pumps;
+        Index m_next;
+    };
+    struct PumpNode {
+        int m_pumpID;
+        int m_target;
+        Index m_next;
+    };
+    std::array<TankNode, MaxTanks> m_tanks;
+    std::array<PumpNode, (MaxPumps > 0 ? MaxPumps : 1)> m_pumps;
+    Index m_current;
+    Index m_freeTanks;
+    Index m_freePumps;
+    Index m_usedTanks; // nodes below this mark have been handed out at least once
+    Index m_usedPumps;
+    Index m_liveTanks; // nodes in use
+    Index m_livePumps;
+
+    Index newTank(int tankID, int capacity) {
+        Index tank = m_freeTanks;
+        if (tank != NONE) {
+            m_freeTanks = m_tanks[tank].m_next;
+        }
+        else if (m_usedTanks < MaxTanks) {
+            tank = (Index)m_usedTanks++;
+        }
+        else {
+            return NONE;
+        }
+
+        m_tanks[tank] = TankNode{ tankID, capacity, 0, NONE, NONE };
+        m_liveTanks++;
+        return tank;
+    }
+
+    Index newPump(int pumpID, int target) {
+        Index pump = m_freePumps;
+        if (pump != NONE) {
+            m_freePumps = m_pumps[pump].m_next;
+        }
+        else if (m_usedPumps < MaxPumps) {
+            pump = (Index)m_usedPumps++;
+        }
+        else {
+            return NONE;
+        }
+
+        m_pumps[pump] = PumpNode{ pumpID, target, NONE };
+        m_livePumps++;
+        return pump;
+    }
+
+    void freePump(Index pump) {
+        m_pumps[pump].m_next = m_freePumps;
+        m_freePumps = pump;
+        m_livePumps--;
+    }
+
+    // the tank findTank just moved, second in the list unless it is the only tank
+    Index foundTank() const {
+        Index second = m_tanks[m_current].m_next;
+        return second == NONE ? m_current : second;
+    }
+
+    Index getTank(int tankID) const {
+        for (Index tank = m_current; tank != NONE; tank = m_tanks[tank].m_next) {
+            if (m_tanks[tank].m_tankID == tankID) {
+                return tank;
+            }
+        }
+        return NONE;
+    }
+
+    Index getPump(Index tank, int pumpID) const {
+        for (Index pump = m_tanks[tank].m_pumps; pump != NONE; pump = m_pumps[pump].m_next) {
+            if (m_pumps[pump].m_pumpID == pumpID) {
+                return pump;
+            }
+        }
+        return NONE;
+    }
+};
+#endif
@@ -0,0 +1,146 @@
+#include "stats.h"
+#include <bit>
+#include <iostream>
+using namespace std;
+
+//Counters of one thread
+struct StatBlock {
+	std::atomic<long long> calls[STAT_OPS];
+	std::atomic<long long> probes[STAT_OPS];
+	std::atomic<long long> events[STAT_EVENTS];
+	std::atomic<long long> latency[STAT_OPS][STAT_BUCKETS];
+	std::atomic<bool> inUse;
+	StatBlock* next;
+};
+
+static std::atomic<StatBlock*> g_blocks(nullptr);
+
+//Adds to a counter that only the calling thread writes
+static void bump(std::atomic<long long>& counter, long long amount) {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+/*
+ * Function: acquireBlock
+ * ----------------------
+ * Reuses the block of a thread that has exited, or pushes a new zeroed block onto the list
+ *
+ * return: Block owned by the calling thread
+ */
+static StatBlock* acquireBlock() {
+	for (StatBlock* block = g_blocks.load(std::memory_order_acquire); block != nullptr; block = block->next) {
+		bool expected = false;
+		if (!block->inUse.load(std::memory_order_relaxed)
+			&& block->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			return block;
+		}
+	}
+
+	StatBlock* block = new StatBlock();
+	block->inUse.store(true, std::memory_order_relaxed);
+	block->next = g_blocks.load(std::memory_order_relaxed);
+	while (!g_blocks.compare_exchange_weak(block->next, block,
+		std::memory_order_release, std::memory_order_relaxed)) {
+	}
+
+	return block;
+}
+
+//Hands the block back when the thread exits
+struct BlockOwner {
+	StatBlock* block = acquireBlock();
+	~BlockOwner() {
+		block->inUse.store(false, std::memory_order_release);
+	}
+};
+
+static StatBlock& localBlock() {
+	thread_local BlockOwner owner;
+	return *owner.block;
+}
+
+void FuelStats::count(STATOP op) {
+	bump(localBlock().calls[op], 1);
+}
+
+void FuelStats::probe(STATOP op, long long nodes) {
+	bump(localBlock().probes[op], nodes);
+}
+
+void FuelStats::event(STATEVENT event) {
+	bump(localBlock().events[event], 1);
+}
+
+void FuelStats::latency(STATOP op, long long ns) {
+	int bucket = ns <= 0 ? 0 : (int)std::bit_width((unsigned long long)ns);
+	if (bucket >= STAT_BUCKETS) {
+		bucket = STAT_BUCKETS - 1;
+	}
+	bump(localBlock().latency[op][bucket], 1);
+}
+
+/*
+ * Function: snapshot
+ * ------------------
+ * Sums the blocks of every thread. Counters are read individually, so a
+ * snapshot taken while other threads run may mix slightly different moments
+ *
+ * return: Totals per operation and event
+ */
+StatSnapshot FuelStats::snapshot() {
+	StatSnapshot stats = {};
+
+	for (StatBlock* block = g_blocks.load(std::memory_order_acquire); block != nullptr; block = block->next) {
+		for (int op = 0; op < STAT_OPS; op++) {
+			stats.calls[op] += block->calls[op].load(std::memory_order_relaxed);
+			stats.probes[op] += block->probes[op].load(std::memory_order_relaxed);
+			for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+				stats.latency[op][bucket] += block->latency[op][bucket].load(std::memory_order_relaxed);
+			}
+		}
+		for (int event = 0; event < STAT_EVENTS; event++) {
+			stats.events[event] += block->events[event].load(std::memory_order_relaxed);
+		}
+	}
+
+	return stats;
+}
+
+/*
+ * Function: dump
+ * --------------
+ * Outputs the operations that were called, their probe lengths and non-empty latency buckets
+ */
+void FuelStats::dump(const StatSnapshot& stats) {
+	cout << "Stats:\n";
+
+	for (int op = 0; op < STAT_OPS; op++) {
+		if (stats.calls[op] == 0) {
+			continue;
+		}
+
+		cout << opName((STATOP)op) << " Calls: " << stats.calls[op]
+			<< " Nodes Walked: " << stats.probes[op] << "\n";
+		for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+			if (stats.latency[op][bucket] != 0) {
+				cout << "  < " << (1LL << bucket) << " ns: " << stats.latency[op][bucket] << "\n";
+			}
+		}
+	}
+
+	for (int event = 0; event < STAT_EVENTS; event++) {
+		cout << eventName((STATEVENT)event) << ": " << stats.events[event] << "\n";
+	}
+}
+
+const char* FuelStats::opName(STATOP op) {
+	static const char* names[STAT_OPS] = { "addTank", "removeTank", "pumpSweep", "addPump", "removePump",
+		"fill", "drain", "findTank", "getTank", "operator=", "totalFuel", "cascadeDrain",
+		"removeTanks", "removePumps", "setCapacity", "rebalance" };
+	return names[op];
+}
+
+const char* FuelStats::eventName(STATEVENT event) {
+	static const char* names[STAT_EVENTS] = { "Fill Clamped", "Drain Clamped By Source", "Drain Clamped By Destination" };
+	return names[event];
+}
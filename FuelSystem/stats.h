@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+#include <atomic>
+#include <chrono>
+// Hot-path instrumentation. Build with -DFUEL_STATS to record per-operation
+// call counts, list nodes walked and latency histograms; without it the
+// FUEL_ macros expand to nothing.
+enum STATOP { STAT_ADDTANK, STAT_REMOVETANK, STAT_PUMPSWEEP, STAT_ADDPUMP, STAT_REMOVEPUMP,
+    STAT_FILL, STAT_DRAIN, STAT_FINDTANK, STAT_GETTANK, STAT_COPY, STAT_TOTALFUEL, STAT_CASCADE,
+    STAT_REMOVETANKS, STAT_REMOVEPUMPS, STAT_SETCAPACITY, STAT_REBALANCE, STAT_OPS };
+enum STATEVENT { STAT_FILLCLAMP, STAT_SOURCECLAMP, STAT_DESTCLAMP, STAT_EVENTS };
+const int STAT_BUCKETS = 32; // latency bucket b holds calls that took [2^(b-1), 2^b) ns
+// totals over every thread, as returned by FuelStats::snapshot
+struct StatSnapshot {
+    long long calls[STAT_OPS];
+    long long probes[STAT_OPS];  // list nodes walked
+    long long events[STAT_EVENTS];
+    long long latency[STAT_OPS][STAT_BUCKETS];
+};
+// Each thread writes only its own block, so updates are plain relaxed
+// loads and stores. Blocks are kept in a lock-free list and handed to a
+// new thread when their owner exits, so counts survive the thread.
+class FuelStats {
+public:
+    static void count(STATOP op);
+    static void probe(STATOP op, long long nodes);
+    static void event(STATEVENT event);
+    static void latency(STATOP op, long long ns);
+    // sum of the counters of every thread
+    static StatSnapshot snapshot();
+    // print a snapshot in the same format as dumpSys
+    static void dump(const StatSnapshot& stats);
+    static const char* opName(STATOP op);
+    static const char* eventName(STATEVENT event);
+};
+// times a scope and records it as one call of op
+class StatTimer {
+public:
+    StatTimer(STATOP op) : m_op(op), m_start(std::chrono::steady_clock::now()) {}
+    ~StatTimer() {
+        FuelStats::count(m_op);
+        FuelStats::latency(m_op, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start).count());
+    }
+private:
+    STATOP m_op;
+    std::chrono::steady_clock::time_point m_start;
+};
+#ifdef FUEL_STATS
+#define FUEL_TIMER(op) StatTimer fuelTimer##op(op)
+#define FUEL_PROBE(op, nodes) FuelStats::probe(op, nodes)
+#define FUEL_EVENT(name) FuelStats::event(name)
+#else
+#define FUEL_TIMER(op) ((void)0)
+#define FUEL_PROBE(op, nodes) ((void)(nodes))
+#define FUEL_EVENT(name) ((void)0)
+#endif
+#endif
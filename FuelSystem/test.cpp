@@ -1,5 +1,27 @@
 #include "fuel.h"
+#include "sim.h"
+#include "event.h"
+#include "montecarlo.h"
+#include "stats.h"
+#include "compact.h"
+#include "staticfuel.h"
+#include "planner.h"
+#include "snapshot.h"
+#include "command.h"
+#include "shard.h"
+#include "transfer.h"
+#include "changes.h"
+#include "diff.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <ctime>
+#include <limits>
 #include <random>
+#include <set>
+#include <string>
+#include <thread>
 
 enum RANDOM { UNIFORMINT, UNIFORMREAL, NORMAL };
 class Random {
@@ -696,186 +718,3561 @@ public:
 
         return result;
     }
+
+    /*
+     * Function: flowSimNormal
+     * -----------------------
+     * threads: Number of worker threads for the simulation
+     *
+     * Runs a pump past the point where the destination is full
+     *
+     * return: True if the flow stops at the destination's capacity and no fuel is lost, false otherwise
+     */
+    bool flowSimNormal(int threads) {
+        bool result = true;
+        FuelSys sys;
+        FlowSim sim(threads);
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, MINCAP + 1000);
+        sys.addTank(3, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 4000);
+
+        sim.load(sys);
+        result = result && sim.setRate(1, 1, 100);
+        result = result && sim.setActive(1, 1, true);
+        result = result && !sim.setRate(3, 1, 100);
+        sim.run(50);
+
+        result = result && sim.level(1) == 1000;
+        result = result && sim.level(2) == MINCAP + 1000;
+        result = result && sim.totalFuel() == 4000;
+        result = result && sim.elapsed() == 50;
+
+        sim.store(sys);
+        result = result && sys.totalFuel() == 4000;
+
+        return result;
+    }
+
+    /*
+     * Function: eventSimNormal
+     * ------------------------
+     * Plays back a fill, a pump run and a drain out of order
+     *
+     * return: True if the pump moved rate * run time and each event applied once, false otherwise
+     */
+    bool eventSimNormal() {
+        bool result = true;
+        FuelSys sys;
+        EventSim sim(sys);
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+
+        result = result && sim.schedule(40, DRAINEVENT, 1, 1, 500);
+        result = result && sim.schedule(30, PUMPSTOP, 1, 1);
+        result = result && sim.schedule(10, PUMPSTART, 1, 1, 50);
+        result = result && sim.schedule(0, FILLEVENT, 1, 0, 3000);
+
+        result = result && sim.runUntil(20) == 2;
+        result = result && sim.running() == 1;
+        result = result && !sim.schedule(5, FILLEVENT, 1, 0, 1);
+        result = result && sim.run() == 2;
+        result = result && sim.running() == 0 && sim.pending() == 0;
+
+        result = result && sys.getTank(1)->m_tankFuel == 1500;
+        result = result && sys.getTank(2)->m_tankFuel == 1500;
+
+        return result;
+    }
+
+    /*
+     * Function: monteCarloNormal
+     * --------------------------
+     * numTanks: Number of tanks in the replicated system
+     *
+     * Runs the same scenarios with one and several threads
+     *
+     * return: True if the statistics match and transfers alone conserve fuel, false otherwise
+     */
+    bool monteCarloNormal(int numTanks) {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.fill(tankID, MINCAP);
+        }
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            sys.addPump(tankID, 1, tankID % numTanks + 1);
+        }
+
+        MonteCarlo single(sys, 1);
+        MonteCarlo parallel(sys, 4);
+        ScenarioConfig config;
+
+        ScenarioStats first = single.run(50, 7, config);
+        ScenarioStats second = parallel.run(50, 7, config);
+
+        result = result && first.scenarios == 50;
+        result = result && first.shortfalls == second.shortfalls;
+        result = result && first.shortfallKg == second.shortfallKg;
+        result = result && first.overflows == second.overflows;
+        result = result && first.overflowKg == second.overflowKg;
+        result = result && first.finalFuel == second.finalFuel;
+
+        //Without deliveries every replica ends with the fuel it started with
+        config.fillChance = 0.0;
+        ScenarioStats drains = parallel.run(20, 7, config);
+        result = result && drains.finalFuel == 20LL * sys.totalFuel();
+        result = result && drains.overflows == 0;
+
+        return result;
+    }
+
+    /*
+     * Function: statsNormal
+     * ---------------------
+     * Fills a tank past its capacity and drains more than it holds
+     *
+     * return: True if the calls and clamps were counted, or if stats are compiled out, false otherwise
+     */
+    bool statsNormal() {
+        bool result = true;
+#ifdef FUEL_STATS
+        FuelSys sys;
+        sys.addTank(1, MINCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+
+        StatSnapshot before = FuelStats::snapshot();
+        sys.fill(1, DEFCAP);
+        sys.drain(1, 1, DEFCAP);
+        StatSnapshot after = FuelStats::snapshot();
+
+        result = result && after.calls[STAT_DRAIN] - before.calls[STAT_DRAIN] == 1;
+        result = result && after.calls[STAT_FINDTANK] - before.calls[STAT_FINDTANK] >= 2;
+        result = result && after.probes[STAT_FINDTANK] > before.probes[STAT_FINDTANK];
+        result = result && after.events[STAT_FILLCLAMP] - before.events[STAT_FILLCLAMP] == 1;
+        result = result && after.events[STAT_SOURCECLAMP] - before.events[STAT_SOURCECLAMP] == 1;
+        result = result && after.events[STAT_DESTCLAMP] == before.events[STAT_DESTCLAMP];
+
+        FuelStats::dump(after);
+#endif
+        return result;
+    }
+
+    /*
+     * Function: quantityNormal
+     * ------------------------
+     * Fills 64-bit tanks past the range of an int and moves fractions of a kg between gram-precision tanks
+     *
+     * return: True if the totals are exact, false otherwise
+     */
+    bool quantityNormal() {
+        bool result = true;
+        FuelSys64 big;
+        FuelSysGrams precise;
+        const long long hugeCap = 3000000000LL;
+
+        result = result && big.addTank(1, hugeCap);
+        result = result && big.addTank(2, hugeCap);
+        result = result && big.fill(1, hugeCap);
+        result = result && big.fill(2, hugeCap / 2);
+        result = result && big.totalFuel() == hugeCap + hugeCap / 2;
+
+        //Default systems sum into a wider type
+        FuelSys sys;
+        for (int tankID = 1; tankID <= 3; tankID++) {
+            sys.addTank(tankID, 1000000000);
+            sys.fill(tankID, 1000000000);
+        }
+        result = result && sys.totalFuel() == 3000000000LL;
+
+        result = result && precise.addTank(1, MINCAP);
+        result = result && precise.addTank(2, MINCAP);
+        result = result && precise.addPump(1, 1, 2);
+        result = result && !precise.addTank(3, Grams::fromGrams(MINCAP * 1000LL - 1));
+        result = result && precise.fill(1, Grams::fromGrams(1500));
+        result = result && precise.drain(1, 1, Grams::fromGrams(250));
+        result = result && precise.getTank(2)->m_tankFuel == Grams::fromGrams(250);
+        result = result && precise.totalFuel() == Grams::fromGrams(1500);
+
+        precise.dumpSys();
+
+        return result;
+    }
+
+    /*
+     * Function: mirrorOps
+     * -------------------
+     * other: Empty system with the same operations as FuelSys
+     * numTanks: Range of tank IDs to use
+     *
+     * Applies the same random operations to a FuelSys and the other system
+     *
+     * return: True if every call returns the same result and the totals match, false otherwise
+     */
+    template <class System>
+    bool mirrorOps(System& other, int numTanks) {
+        bool result = true;
+        FuelSys sys;
+        Random pick(0, numTanks);
+        Random amount(0, DEFCAP);
+
+        for (int step = 0; step < 2000; step++) {
+            int tankID = pick.getRandNum();
+            int otherID = pick.getRandNum();
+            int pumpID = pick.getRandNum() % 4;
+            int fuel = amount.getRandNum();
+
+            switch (step % 7) {
+            case 0:
+                result = result && sys.addTank(tankID, fuel + MINCAP / 2) == other.addTank(tankID, fuel + MINCAP / 2);
+                break;
+            case 1:
+                result = result && sys.addPump(tankID, pumpID, otherID) == other.addPump(tankID, pumpID, otherID);
+                break;
+            case 2:
+            case 3:
+                result = result && sys.fill(tankID, fuel) == other.fill(tankID, fuel);
+                break;
+            case 4:
+            case 5:
+                result = result && sys.drain(tankID, pumpID, fuel) == other.drain(tankID, pumpID, fuel);
+                break;
+            default:
+                if (step % 3 == 0) {
+                    result = result && sys.removeTank(tankID) == other.removeTank(tankID);
+                }
+                else {
+                    result = result && sys.removePump(tankID, pumpID) == other.removePump(tankID, pumpID);
+                }
+            }
+            result = result && sys.totalFuel() == other.totalFuel();
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: compactNormal
+     * -----------------------
+     * numTanks: Range of tank IDs to use
+     *
+     * return: True if the nodes are smaller and CompactFuelSys matches FuelSys, false otherwise
+     */
+    bool compactNormal(int numTanks) {
+        bool result = true;
+        CompactFuelSys compact;
+
+        result = result && sizeof(CompactFuelSys::TankNode) < sizeof(Tank);
+        result = result && sizeof(CompactFuelSys::PumpNode) < sizeof(Pump);
+        result = result && mirrorOps(compact, numTanks);
+
+        return result;
+    }
+
+    /*
+     * Function: staticNormal
+     * ----------------------
+     * numTanks: Range of tank IDs to use
+     *
+     * return: True if StaticFuelSys matches FuelSys and rejects tanks and pumps past its limits, false otherwise
+     */
+    bool staticNormal(int numTanks) {
+        bool result = true;
+        StaticFuelSys<64, 256> fixed;
+        StaticFuelSys<2, 1, MINCAP / 2> tiny;
+
+        result = result && mirrorOps(fixed, numTanks);
+
+        result = result && tiny.addTank(1, MINCAP / 2);
+        result = result && tiny.addTank(2, MINCAP / 2);
+        result = result && !tiny.addTank(3, DEFCAP);
+        result = result && tiny.addPump(1, 1, 2);
+        result = result && !tiny.addPump(2, 1, 1);
+        result = result && tiny.removeTank(1);
+        result = result && tiny.addTank(3, DEFCAP);
+        result = result && tiny.addPump(3, 1, 2);
+        result = result && sizeof(tiny) < 64;
+
+        return result;
+    }
+
+    /*
+     * Function: levelNormal
+     * ---------------------
+     * Fills tanks to different ratios, then drains and removes some
+     *
+     * return: True if the range and top-k queries follow every level change, false otherwise
+     */
+    bool levelNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 1; tankID <= 5; tankID++) {
+            sys.addTank(tankID, 10000);
+            sys.fill(tankID, tankID * 1000);
+        }
+        sys.addPump(5, 1, 1);
+
+        result = result && sys.tanksByFill(0.0, 0.25) == std::vector<int>({ 1, 2 });
+        result = result && sys.emptiestTanks(3) == std::vector<int>({ 1, 2, 3 });
+        result = result && sys.fullestTanks(1) == std::vector<int>({ 5 });
+        result = result && sys.tanksWithSpace(7000) == std::vector<int>({ 3, 2, 1 });
+        result = result && sys.mostSpaceTanks(10).size() == 5;
+
+        //Tank 5 drops to 1000 and tank 1 rises to 5000
+        sys.drain(5, 1, 4000);
+        result = result && sys.emptiestTanks(2) == std::vector<int>({ 5, 2 });
+        result = result && sys.fullestTanks(1) == std::vector<int>({ 1 });
+
+        sys.removeTank(2);
+        result = result && sys.tanksByFill(0.0, 0.5) == std::vector<int>({ 5, 3, 4, 1 });
+
+        return result;
+    }
+
+    /*
+     * Function: plannerNormal
+     * -----------------------
+     * Splits deliveries across tanks with each policy
+     *
+     * return: True if the allocations follow the policy and match what was added, false otherwise
+     */
+    bool plannerNormal() {
+        bool result = true;
+        FuelSys sys;
+        RefillPlanner planner(sys);
+
+        //Tank 1 is 10% full, tank 2 is 50% full and tank 3 is full
+        sys.addTank(1, 10000);
+        sys.addTank(2, 10000);
+        sys.addTank(3, MINCAP);
+        sys.fill(1, 1000);
+        sys.fill(2, 5000);
+        sys.fill(3, MINCAP);
+
+        //3000 only raises tank 1 to 40%
+        std::vector<Allocation> plan = planner.plan(3000, LOWESTFILL);
+        result = result && plan.size() == 1 && plan[0].tankID == 1 && plan[0].fuel == 3000;
+
+        //6000 raises both to 60%
+        plan = planner.deliver(6000, LOWESTFILL);
+        result = result && plan.size() == 2 && plan[0].fuel == 5000 && plan[1].fuel == 1000;
+        result = result && sys.totalFuel() == 1000 + 5000 + MINCAP + 6000;
+
+        //Equal capacities get equal shares
+        plan = planner.deliver(2000, CAPACITYWEIGHTED);
+        result = result && plan.size() == 2 && plan[0].fuel == 1000 && plan[1].fuel == 1000;
+
+        //Priority fills tank 2 first and spills into tank 1, more than the space is clamped
+        planner.setPriority(2, 1);
+        plan = planner.plan(DEFCAP, PRIORITY);
+        result = result && plan[0].tankID == 2 && plan[0].fuel == 3000 && plan[1].fuel == 2000;
+        result = result && planner.apply(planner.plan(20000, PRIORITY)) == 6000;
+        result = result && planner.plan(1, LOWESTFILL).empty();
+
+        return result;
+    }
+
+    /*
+     * Function: reachNormal
+     * ---------------------
+     * Builds a cycle feeding a chain, then adds and removes pumps and tanks
+     *
+     * return: True if reachability follows every change to the pump graph, false otherwise
+     */
+    bool reachNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 1; tankID <= 6; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+        //1 -> 2 -> 3 -> 1 is a cycle that drains into 4, tanks 5 and 6 are isolated
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(3, 1, 1);
+        sys.addPump(3, 2, 4);
+
+        result = result && sys.canReach(1, 4) && sys.canReach(2, 1);
+        result = result && !sys.canReach(4, 1) && !sys.canReach(1, 5);
+        result = result && sys.sameComponent(1, 3) && !sys.sameComponent(3, 4);
+        result = result && sys.isolatedTanks() == std::vector<int>({ 5, 6 });
+        result = result && sys.canReach(5, 5) && !sys.canReach(7, 7);
+
+        //A second pump along an existing path changes nothing, removing one of the two keeps the path
+        sys.addPump(1, 2, 2);
+        sys.removePump(1, 1);
+        result = result && sys.canReach(3, 2);
+
+        //Breaking the cycle
+        sys.removePump(2, 1);
+        result = result && !sys.canReach(2, 4) && sys.canReach(3, 2) && !sys.sameComponent(1, 3);
+
+        //Linking the chain to 5, then removing the tank in the middle
+        sys.addPump(4, 1, 5);
+        result = result && sys.canReach(3, 5) && sys.isolatedTanks() == std::vector<int>({ 6 });
+        sys.removeTank(4);
+        result = result && !sys.canReach(3, 5) && sys.isolatedTanks() == std::vector<int>({ 5, 6 });
+
+        //Copies carry their pumps
+        FuelSys copy;
+        copy = sys;
+        result = result && copy.canReach(3, 2) && !copy.canReach(2, 3);
+
+        //Random graphs against a search of the pump lists
+        Random pick(1, 12);
+        for (int round = 0; round < 20; round++) {
+            FuelSys graph;
+            for (int tankID = 1; tankID <= 12; tankID++) {
+                graph.addTank(tankID, DEFCAP);
+            }
+            for (int pumpID = 0; pumpID < 14; pumpID++) {
+                graph.addPump(pick.getRandNum(), pumpID, pick.getRandNum());
+            }
+            graph.removeTank(pick.getRandNum());
+
+            for (int source = 1; source <= 12 && result; source++) {
+                std::vector<bool> seen(13, false);
+                std::vector<int> frontier;
+                if (graph.getTank(source) != nullptr) {
+                    seen[source] = true;
+                    frontier.push_back(source);
+                }
+                while (!frontier.empty()) {
+                    Tank* tank = graph.getTank(frontier.back());
+                    frontier.pop_back();
+                    for (Pump* pump = tank->m_pumps; pump != nullptr; pump = pump->m_next) {
+                        if (!seen[graph.targetID(pump)]) {
+                            seen[graph.targetID(pump)] = true;
+                            frontier.push_back(graph.targetID(pump));
+                        }
+                    }
+                }
+                for (int target = 1; target <= 12; target++) {
+                    result = result && graph.canReach(source, target) == seen[target];
+                }
+            }
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: cascadeNormal
+     * -----------------------
+     * Finds the cycles and drain order of a small plant, then runs a cascade given out of order
+     *
+     * return: True if cycles are reported, the order respects every pump and the cascade moves fuel downstream, false otherwise
+     */
+    bool cascadeNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 1; tankID <= 7; tankID++) {
+            sys.addTank(tankID, 10000);
+        }
+        //1 -> 2 -> 3 is a chain, 4 <-> 5 is a cycle feeding 6, tank 7 has no pumps
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(4, 1, 5);
+        sys.addPump(5, 1, 4);
+        sys.addPump(5, 2, 6);
+
+        result = result && sys.hasCycle();
+        result = result && sys.pumpCycles() == std::vector<std::vector<int>>({ { 4, 5 } });
+
+        std::vector<int> order = sys.drainOrder();
+        std::vector<int> position(8, -1);
+        for (int i = 0; i < (int)order.size(); i++) {
+            position[order[i]] = i;
+        }
+        result = result && order.size() == 5 && position[4] < 0 && position[5] < 0;
+        result = result && position[1] < position[2] && position[2] < position[3] && order.back() == 7;
+
+        //The steps are given downstream first but run upstream first, so fuel reaches tank 3
+        sys.fill(1, 6000);
+        result = result && sys.cascadeDrain({ { 2, 1, 5000 }, { 1, 1, 5000 } });
+        result = result && sys.getTank(1)->m_tankFuel == 1000 && sys.getTank(2)->m_tankFuel == 0
+            && sys.getTank(3)->m_tankFuel == 5000;
+
+        //Clamped by the target's space
+        sys.fill(2, 8000);
+        result = result && sys.cascadeDrain({ { 2, 1, 8000 } });
+        result = result && sys.getTank(2)->m_tankFuel == 3000 && sys.getTank(3)->m_tankFuel == 10000;
+
+        //A step on the cycle, a missing pump or a negative amount rejects the whole cascade
+        result = result && !sys.cascadeDrain({ { 1, 1, 100 }, { 5, 2, 100 } });
+        result = result && !sys.cascadeDrain({ { 1, 1, 100 }, { 1, 9, 100 } });
+        result = result && !sys.cascadeDrain({ { 1, 1, -1 } });
+        result = result && sys.getTank(1)->m_tankFuel == 1000;
+
+        //Breaking the cycle frees its tanks
+        sys.removePump(5, 1);
+        result = result && !sys.hasCycle() && sys.drainOrder().size() == 7;
+        sys.fill(4, 2000);
+        result = result && sys.cascadeDrain({ { 5, 2, 2000 }, { 4, 1, 2000 } });
+        result = result && sys.getTank(6)->m_tankFuel == 2000 && sys.getTank(4)->m_tankFuel == 0;
+
+        return result;
+    }
+
+    /*
+     * Function: snapshotNormal
+     * ------------------------
+     * Drains fuel around a ring and publishes after every drain while two threads read
+     *
+     * return: True if every snapshot read is complete and conserves fuel, and replaced snapshots are freed, false otherwise
+     */
+    bool snapshotNormal() {
+        FuelSys sys;
+        SnapshotPublisher publisher;
+        const int numTanks = 8;
+
+        for (int tankID = 0; tankID < numTanks; tankID++) {
+            sys.addTank(tankID, 10000);
+            sys.fill(tankID, 5000);
+        }
+        for (int tankID = 0; tankID < numTanks; tankID++) {
+            sys.addPump(tankID, 1, (tankID + 1) % numTanks);
+        }
+        publisher.publish(sys);
+
+        std::atomic<bool> done(false);
+        std::atomic<bool> consistent(true);
+        std::vector<std::thread> readers;
+
+        for (int thread = 0; thread < 2; thread++) {
+            readers.emplace_back([&]() {
+                SnapshotPublisher::Reader reader(publisher);
+                long long lastVersion = 0;
+
+                while (!done.load()) {
+                    ReadGuard guard(reader);
+                    long long sum = 0;
+                    for (int fuel : guard->fuel) {
+                        sum += fuel;
+                    }
+                    if (sum != 5000LL * numTanks || guard->totalFuel != sum || guard->version < lastVersion
+                        || (int)guard->tankIDs.size() != numTanks || guard->targetsOf(0) != std::vector<int>({ 1 })) {
+                        consistent.store(false);
+                    }
+                    lastVersion = guard->version;
+                }
+            });
+        }
+
+        Random amount(0, 3000);
+        for (int step = 0; step < 2000; step++) {
+            sys.drain(step % numTanks, 1, amount.getRandNum());
+            publisher.publish(sys);
+        }
+        done.store(true);
+        for (std::thread& thread : readers) {
+            thread.join();
+        }
+
+        bool result = consistent.load();
+        result = result && publisher.version() == 2001;
+
+        //No reader is left, so everything replaced so far can be freed
+        publisher.reclaim();
+        result = result && publisher.retired() == 0;
+
+        //A pinned reader keeps its snapshot alive across later publishes
+        SnapshotPublisher::Reader reader(publisher);
+        const Snapshot* held = reader.pin();
+        int level = held->level(0);
+        sys.fill(0, 10000);
+        publisher.publish(sys);
+        publisher.publish(sys);
+        result = result && publisher.retired() == 2 && held->level(0) == level;
+        reader.unpin();
+        publisher.reclaim();
+        result = result && publisher.retired() == 0;
+
+        ReadGuard guard(reader);
+        result = result && guard->level(0) == 10000 && guard->level(numTanks) == -1;
+
+        return result;
+    }
+
+    /*
+     * Function: commandNormal
+     * -----------------------
+     * Four threads post fills and drains through a small ring while the owner thread applies them
+     *
+     * return: True if every command is applied once and reports the result of its call, false otherwise
+     */
+    bool commandNormal() {
+        bool result = true;
+        FuelSys sys;
+        CommandQueue queue(sys, 64);
+        const int producers = 4;
+        const int perProducer = 2000;
+
+        //Topology changes through futures, applied on this thread
+        std::vector<std::future<bool>> setup;
+        for (int tankID = 0; tankID < producers; tankID++) {
+            setup.push_back(queue.submit(Command{ ADDTANK, tankID, 0, 0, 100000 }));
+        }
+        for (int tankID = 0; tankID < producers; tankID++) {
+            setup.push_back(queue.submit(Command{ ADDPUMP, tankID, 1, (tankID + 1) % producers, 0 }));
+        }
+        std::future<bool> duplicate = queue.submit(Command{ ADDTANK, 0, 0, 0, 100000 });
+        result = result && queue.process() == 2 * producers + 1;
+        for (std::future<bool>& done : setup) {
+            result = result && done.get();
+        }
+        result = result && !duplicate.get();
+
+        queue.start(32);
+        std::atomic<int> succeeded(0);
+        std::vector<std::thread> threads;
+
+        for (int producer = 0; producer < producers; producer++) {
+            threads.emplace_back([&, producer]() {
+                for (int i = 0; i < perProducer; i++) {
+                    queue.post(Command{ FILLTANK, producer, 0, 0, 2 }, [&](bool done) {
+                        if (done) {
+                            succeeded.fetch_add(1);
+                        }
+                    });
+                    queue.post(Command{ DRAINTANK, producer, 1, 0, 1 });
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        queue.stop();
+
+        //Drains move fuel around the ring, so only the fills change the total
+        result = result && succeeded.load() == producers * perProducer;
+        result = result && queue.applied() == 2 * producers + 1 + 2LL * producers * perProducer;
+        result = result && sys.totalFuel() == 2LL * producers * perProducer;
+
+        return result;
+    }
+
+    /*
+     * Function: shardNormal
+     * ---------------------
+     * Runs the same random operations on a FuelSys and on hashed and ranged sharded systems
+     *
+     * return: True if every call returns the same result and the levels and totals match, false otherwise
+     */
+    bool shardNormal() {
+        bool result = true;
+        FuelSys sys;
+        ShardedFuelSys hashed(4);
+        ShardedFuelSys ranged(3, 10);
+        const int numTanks = 30;
+
+        for (int tankID = 0; tankID < numTanks; tankID++) {
+            int capacity = MINCAP + tankID * 100;
+            sys.addTank(tankID, capacity);
+            result = result && hashed.addTank(tankID, capacity) && ranged.addTank(tankID, capacity);
+        }
+        result = result && !hashed.addTank(5, DEFCAP) && ranged.shardOf(25) == 2 && ranged.shardOf(99) == 2;
+
+        Random pick(0, numTanks - 1);
+        Random amount(0, 3000);
+        for (int step = 0; step < 2000 && result; step++) {
+            int tankID = pick.getRandNum();
+            int other = pick.getRandNum();
+            int pumpID = step % 5;
+            int fuel = amount.getRandNum();
+            int op = step % 10;
+            bool expected = false;
+
+            if (op < 2) {
+                expected = sys.addPump(tankID, pumpID, other);
+                result = result && hashed.addPump(tankID, pumpID, other) == expected
+                    && ranged.addPump(tankID, pumpID, other) == expected;
+            }
+            else if (op == 2) {
+                expected = sys.removePump(tankID, pumpID);
+                result = result && hashed.removePump(tankID, pumpID) == expected
+                    && ranged.removePump(tankID, pumpID) == expected;
+            }
+            else if (op < 5) {
+                expected = sys.fill(tankID, fuel);
+                result = result && hashed.fill(tankID, fuel) == expected && ranged.fill(tankID, fuel) == expected;
+            }
+            else {
+                expected = sys.drain(tankID, pumpID, fuel);
+                result = result && hashed.drain(tankID, pumpID, fuel) == expected
+                    && ranged.drain(tankID, pumpID, fuel) == expected;
+            }
+        }
+
+        result = result && hashed.crossPumps() > 0 && ranged.crossPumps() > 0;
+        for (int tankID = 0; tankID < numTanks; tankID++) {
+            int level = sys.getTank(tankID)->m_tankFuel;
+            result = result && hashed.level(tankID) == level && ranged.level(tankID) == level;
+        }
+        result = result && hashed.totalFuel() == sys.totalFuel() && ranged.totalFuel() == sys.totalFuel();
+
+        //Removing a tank drops the cross-shard pumps into it
+        for (int tankID = 0; tankID < numTanks; tankID += 3) {
+            result = result && hashed.removeTank(tankID) == sys.removeTank(tankID);
+        }
+        for (int tankID = 1; tankID < numTanks; tankID += 3) {
+            for (int pumpID = 0; pumpID < 5; pumpID++) {
+                result = result && hashed.drain(tankID, pumpID, 100) == sys.drain(tankID, pumpID, 100);
+            }
+        }
+        result = result && hashed.totalFuel() == sys.totalFuel() && hashed.level(0) == -1;
+
+        return result;
+    }
+
+    //Moves fuel from tank to tank, then waits and moves some back
+    static TransferScheduler::Job shuttle(TransferScheduler& scheduler, int tankID, int amount, std::vector<int>& moved) {
+        moved.push_back(co_await scheduler.transfer(tankID, 1, amount, 10));
+        co_await scheduler.sleep(100);
+        moved.push_back(co_await scheduler.transfer(tankID + 1, 1, amount / 2, 10));
+    }
+
+    /*
+     * Function: transferNormal
+     * ------------------------
+     * Runs many concurrent transfers as coroutines, including ones clamped by the source and target
+     *
+     * return: True if each transfer moves what drain allows at its rate and time advances as expected, false otherwise
+     */
+    bool transferNormal() {
+        bool result = true;
+        FuelSys sys;
+        TransferScheduler scheduler(sys);
+        const int pairs = 500;
+
+        //Tank 2k pumps into 2k+1 and back
+        for (int pair = 0; pair < pairs; pair++) {
+            sys.addTank(2 * pair, 10000);
+            sys.addTank(2 * pair + 1, 10000);
+            sys.addPump(2 * pair, 1, 2 * pair + 1);
+            sys.addPump(2 * pair + 1, 1, 2 * pair);
+            sys.fill(2 * pair, 5000);
+        }
+
+        std::vector<std::vector<int>> moved(pairs);
+        for (int pair = 0; pair < pairs; pair++) {
+            scheduler.spawn(shuttle(scheduler, 2 * pair, 1000, moved[pair]));
+        }
+        result = result && scheduler.jobs() == pairs;
+
+        //1000 kg at 10 kg/s takes 100 s, then 100 s of sleep and 50 s to move 500 back
+        result = result && scheduler.run() == 250 && scheduler.jobs() == 0;
+        for (int pair = 0; pair < pairs; pair++) {
+            result = result && moved[pair] == std::vector<int>({ 1000, 500 });
+        }
+        result = result && sys.totalFuel() == 5000LL * pairs;
+
+        //Both transfers feed tank 2 at 70 kg a step until its 500 kg of space is gone. The
+        //transfers back find no pump, so they end at once having moved nothing
+        FuelSys small;
+        TransferScheduler clamped(small, 7);
+        small.addTank(1, MINCAP);
+        small.addTank(2, MINCAP);
+        small.addTank(3, MINCAP);
+        small.addPump(1, 1, 2);
+        small.addPump(3, 1, 2);
+        small.fill(1, 300);
+        small.fill(2, 1500);
+        small.fill(3, 2000);
+        std::vector<int> first, second;
+        clamped.spawn(shuttle(clamped, 1, 1000, first));
+        clamped.spawn(shuttle(clamped, 3, 1000, second));
+        clamped.run(20);
+        result = result && clamped.now() == 21 && clamped.transfers() == 2;
+        clamped.run();
+        result = result && first == std::vector<int>({ 280, 0 }) && second == std::vector<int>({ 220, 0 });
+        result = result && small.totalFuel() == 3800;
+
+        return result;
+    }
+
+    /*
+     * Function: changeFeedNormal
+     * --------------------------
+     * Records fills, drains and a removal, then overflows a small ring while another thread reads it
+     *
+     * return: True if every delta carries its cause and each tank's deltas chain from level to level, false otherwise
+     */
+    bool changeFeedNormal() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(8);
+        sys.setFeed(&feed);
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 3000);
+        sys.fill(1, 0);
+        sys.drain(1, 1, 1000);
+        sys.removeTank(2);
+
+        std::vector<LevelDelta<int>> deltas;
+        result = result && subscription->poll(deltas) == 4;
+        result = result && deltas[0].tankID == 1 && deltas[0].oldLevel == 0 && deltas[0].newLevel == 3000 && deltas[0].cause == FILLCHANGE;
+        result = result && deltas[1].tankID == 1 && deltas[1].newLevel == 2000 && deltas[1].cause == DRAINCHANGE;
+        result = result && deltas[2].tankID == 2 && deltas[2].newLevel == 1000 && deltas[2].cause == DRAINCHANGE;
+        result = result && deltas[3].tankID == 2 && deltas[3].oldLevel == 1000 && deltas[3].newLevel == 0 && deltas[3].cause == REMOVECHANGE;
+
+        //A reader thread keeps up as best it can while the ring overflows
+        const int numTanks = 16;
+        for (int tankID = 10; tankID < 10 + numTanks; tankID++) {
+            sys.addTank(tankID, 100000);
+        }
+        std::atomic<bool> done(false);
+        std::vector<LevelDelta<int>> seen;
+        std::thread reader([&]() {
+            while (!done.load()) {
+                subscription->poll(seen);
+            }
+        });
+
+        Random pick(10, 10 + numTanks - 1);
+        for (int step = 0; step < 20000; step++) {
+            sys.fill(pick.getRandNum(), 1);
+        }
+        while (subscription->waiting() > 0) {
+            feed.flush();
+            std::this_thread::yield();
+        }
+        done.store(true);
+        reader.join();
+        subscription->poll(seen);
+
+        std::vector<int> last(10 + numTanks, 0);
+        for (const LevelDelta<int>& delta : seen) {
+            result = result && delta.oldLevel == last[delta.tankID];
+            last[delta.tankID] = delta.newLevel;
+        }
+        long long total = 0;
+        for (int tankID = 10; tankID < 10 + numTanks; tankID++) {
+            total += last[tankID];
+            result = result && last[tankID] == sys.getTank(tankID)->m_tankFuel;
+        }
+        result = result && total == 20000;
+
+        //Deltas are coalesced only once the ring is full
+        result = result && (long long)seen.size() + subscription->coalesced() == 20000;
+
+        sys.setFeed(nullptr);
+        feed.unsubscribe(subscription);
+        result = result && feed.subscribers() == 0;
+
+        return result;
+    }
+
+    /*
+     * Function: alarmNormal
+     * ---------------------
+     * Moves a tank across its thresholds by fills and drains, including the target side of a drain
+     *
+     * return: True if alarms are raised once, cleared only past the hysteresis band and unwatched tanks stay silent, false otherwise
+     */
+    bool alarmNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        sys.addTank(1, 10000);
+        sys.addTank(2, 10000);
+        sys.addTank(3, 10000);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 5000);
+
+        result = result && !sys.setAlarm(4, 0.1, 0.9) && !sys.setAlarm(1, 0.9, 0.1);
+        //Tank 2 is empty, so its low alarm is raised as soon as it is watched
+        result = result && sys.setAlarm(1, 0.2, 0.8, 0.05) && sys.setAlarm(2, 0.2, 0.8, 0.05);
+        std::vector<Alarm> alarms = sys.takeAlarms();
+        result = result && alarms.size() == 1 && alarms[0].tankID == 2 && alarms[0].type == LOWALARM;
+
+        //Tank 1 drops to 15%, tank 2 rises to 35%
+        sys.drain(1, 1, 3500);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2;
+        result = result && alarms[0].tankID == 1 && alarms[0].type == LOWALARM;
+        result = result && alarms[1].tankID == 2 && alarms[1].type == LOWCLEAR;
+
+        //Within the hysteresis band nothing changes, past it the alarm clears
+        sys.fill(1, 700);
+        result = result && sys.takeAlarms().empty();
+        sys.fill(1, 400);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 1 && alarms[0].type == LOWCLEAR;
+
+        //High alarm through a callback, tank 3 is not watched
+        std::vector<Alarm> called;
+        sys.onAlarm([&called](const Alarm& alarm) {
+            called.push_back(alarm);
+        });
+        sys.fill(3, 9000);
+        sys.fill(1, 10000);
+        result = result && called.size() == 1 && called[0].tankID == 1 && called[0].type == HIGHALARM;
+        //90% then 74%, only the second is past the band
+        sys.drain(1, 1, 1000);
+        result = result && called.size() == 1;
+        sys.drain(1, 1, 1600);
+        result = result && called.size() == 2 && called[1].type == HIGHCLEAR;
+
+        sys.clearAlarm(1);
+        sys.drain(1, 1, 1000);
+        result = result && called.size() == 2 && sys.takeAlarms().empty();
+
+        return result;
+    }
+
+    /*
+     * Function: diffNormal
+     * --------------------
+     * Changes a copy of a system in every way a patch can express, then patches the original
+     *
+     * return: True if the patched system has no diff left against the copy, an equal pair gives an empty patch and a patch that does not fit is refused, false otherwise
+     */
+    bool diffNormal() {
+        bool result = true;
+        FuelSys from;
+        FuelSys to;
+
+        for (int i = 1; i <= 6; i++) {
+            from.addTank(i, 10000);
+            from.fill(i, 1000 * i);
+        }
+        from.addPump(1, 1, 2);
+        from.addPump(1, 2, 3);
+        from.addPump(2, 1, 4);
+        from.addPump(5, 1, 6);
+        from.addPump(4, 1, 6);
+        to = from;
+        result = result && SysDiff::diff(from, to).empty();
+
+        //Remove tank 6 and the pumps into it, add tank 7 with a pump, change levels and pumps
+        to.removeTank(6);
+        to.addTank(7, 3000);
+        to.fill(7, 2500);
+        to.addPump(7, 1, 1);
+        to.addPump(5, 1, 7);
+        to.removePump(1, 2);
+        to.addPump(3, 1, 1);
+        to.drain(2, 1, 500);
+        to.fill(1, 900);
+
+        Patch patch = SysDiff::diff(from, to);
+        result = result && !patch.empty();
+        result = result && SysDiff::apply(from, patch);
+        result = result && SysDiff::diff(from, to).empty() && from.totalFuel() == to.totalFuel();
+        result = result && from.canReach(7, 4) && !from.canReach(1, 3) && !from.findTank(6);
+
+        //The same patch again does not fit, tank 7 already exists
+        result = result && !SysDiff::apply(from, patch);
+
+        //Random systems drift apart and are patched back together
+        std::mt19937 gen(44);
+        std::uniform_int_distribution<int> pick(0, 19);
+        FuelSys a;
+        FuelSys b;
+        for (int round = 0; round < 20 && result; round++) {
+            for (int i = 0; i < 30; i++) {
+                int tankID = pick(gen);
+                int choice = pick(gen) % 5;
+                if (choice == 0) {
+                    b.addTank(tankID, MINCAP + 100 * pick(gen));
+                }
+                else if (choice == 1) {
+                    b.removeTank(tankID);
+                }
+                else if (choice == 2) {
+                    b.addPump(tankID, pick(gen) % 3, pick(gen));
+                }
+                else if (choice == 3) {
+                    b.removePump(tankID, pick(gen) % 3);
+                }
+                else {
+                    b.fill(tankID, 100 * pick(gen));
+                }
+            }
+            result = result && SysDiff::apply(a, SysDiff::diff(a, b));
+            result = result && SysDiff::diff(a, b).empty() && SysDiff::diff(b, a).empty();
+            result = result && a.totalFuel() == b.totalFuel();
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: traceNormal
+     * ---------------------
+     * Records calls made directly and through a CommandQueue, round-trips them through the binary form and replays them
+     *
+     * return: True if the replay reaches the same system with the same results and a damaged trace is refused, false otherwise
+     */
+    bool traceNormal() {
+        bool result = true;
+        FuelSys sys;
+        Trace trace;
+
+        result = result && trace.run(sys, Command{ ADDTANK, 5, 0, 0, 5000 });
+        result = result && trace.run(sys, Command{ ADDTANK, -3, 0, 0, 5000 }) == false;
+        result = result && trace.run(sys, Command{ ADDTANK, 900000, 0, 0, 8000 });
+        result = result && trace.run(sys, Command{ ADDPUMP, 5, 1, 900000, 0 });
+        result = result && trace.run(sys, Command{ FILLTANK, 5, 0, 0, 4000 });
+        result = result && trace.run(sys, Command{ DRAINTANK, 5, 1, 0, 1500 });
+
+        //The queue records in the order its owner applies the commands
+        CommandQueue commands(sys);
+        commands.setTrace(&trace);
+        commands.post(Command{ DRAINTANK, 5, 2, 0, 100 });
+        commands.post(Command{ REMOVEPUMP, 5, 1, 0, 0 });
+        commands.execute([](FuelSys& owned) {
+            owned.fill(900000, 1);
+        });
+        commands.post(Command{ REMOVETANK, 5, 0, 0, 0 });
+        commands.process();
+        commands.setTrace(nullptr);
+        result = result && trace.size() == 9 && !trace.entries()[6].result && trace.entries()[8].result;
+
+        std::vector<unsigned char> bytes = trace.encode();
+        Trace copy;
+        result = result && copy.decode(bytes) && copy.size() == trace.size();
+        for (int i = 0; i < copy.size() && result; i++) {
+            const TraceEntry& a = trace.entries()[i];
+            const TraceEntry& b = copy.entries()[i];
+            result = a.result == b.result && a.command.type == b.command.type && a.command.tankID == b.command.tankID
+                && a.command.pumpID == b.command.pumpID && a.command.target == b.command.target
+                && a.command.amount == b.command.amount;
+        }
+
+        //The task is not part of the trace, so the replay differs from sys only by its 1 kg
+        FuelSys replayed;
+        for (const TraceEntry& entry : copy.entries()) {
+            result = result && applyCommand(replayed, entry.command) == entry.result;
+        }
+        replayed.fill(900000, 1);
+        result = result && SysDiff::diff(sys, replayed).empty();
+
+        //Damaged traces are refused and leave the entries alone
+        std::vector<unsigned char> cut(bytes.begin(), bytes.end() - 1);
+        std::vector<unsigned char> extra(bytes);
+        extra.push_back(0);
+        std::vector<unsigned char> badType(bytes);
+        badType[5] = RUNTASK;
+        result = result && !copy.decode(cut) && !copy.decode(extra) && !copy.decode(badType) && copy.size() == 9;
+
+        //A generated workload replaces the entries, replays to its own results and routes pumps into many tanks
+        Trace generated;
+        generated.generate(3000, 100);
+        copy.generate(3000, 100);
+        result = result && generated.size() == 3000 && copy.encode() == generated.encode();
+        FuelSys regenerated;
+        std::vector<int> targets;
+        for (const TraceEntry& entry : generated.entries()) {
+            result = result && applyCommand(regenerated, entry.command) == entry.result;
+            if (entry.command.type == ADDPUMP && entry.result) {
+                targets.push_back(entry.command.target);
+            }
+        }
+        std::sort(targets.begin(), targets.end());
+        result = result && std::unique(targets.begin(), targets.end()) - targets.begin() > 50;
+
+        return result;
+    }
+
+    /*
+     * Function: memoryNormal
+     * ----------------------
+     * Adds and removes tanks and pumps in each storage mode and checks the counted nodes
+     *
+     * return: True if tanks and pumps are counted exactly as they come and go, including pumps removed with their tank, false otherwise
+     */
+    bool memoryNormal() {
+        bool result = true;
+        FuelSys sys;
+        CompactFuelSys compact;
+        StaticFuelSys<8, 16> fixed;
+        MemoryUsage empty = sys.memoryUsage();
+
+        result = result && empty.tanks == 0 && empty.pumps == 0 && empty.system == sizeof(FuelSys);
+        for (int i = 1; i <= 4; i++) {
+            sys.addTank(i, 5000);
+            compact.addTank(i, 5000);
+            fixed.addTank(i, 5000);
+        }
+        for (int i = 1; i <= 3; i++) {
+            sys.addPump(i, 1, i + 1);
+            sys.addPump(i, 2, 4);
+            compact.addPump(i, 1, i + 1);
+            fixed.addPump(i, 1, i + 1);
+        }
+        sys.setAlarm(1, 0.1, 0.9);
+
+        MemoryUsage full = sys.memoryUsage();
+        result = result && full.tanks == 4 * sizeof(Tank) && full.pumps == 6 * sizeof(Pump);
+        result = result && full.levels > 0 && full.reach > 0 && full.alarms > 0 && full.slack > 0;
+        result = result && full.total() == full.system + full.tanks + full.pumps + full.levels + full.reach + full.alarms + full.ids + full.slack;
+        result = result && compact.memoryUsage().tanks == 4 * sizeof(CompactFuelSys::TankNode);
+        result = result && compact.memoryUsage().pumps == 3 * sizeof(CompactFuelSys::PumpNode);
+        result = result && fixed.memoryUsage().pumps == 3 * sizeof(StaticFuelSys<8, 16>::PumpNode);
+        result = result && fixed.memoryUsage().total() == sizeof(fixed);
+
+        //In sys tank 4 takes the four pumps into it and tank 3 the one left into it; in the others tank 3 takes its own pump and the one into it
+        sys.removeTank(4);
+        sys.removeTank(3);
+        compact.removeTank(3);
+        fixed.removeTank(3);
+        MemoryUsage partial = sys.memoryUsage();
+        result = result && partial.tanks == 2 * sizeof(Tank) && partial.pumps == 1 * sizeof(Pump);
+        result = result && compact.memoryUsage().tanks == 3 * sizeof(CompactFuelSys::TankNode);
+        result = result && compact.memoryUsage().pumps == 1 * sizeof(CompactFuelSys::PumpNode);
+        result = result && fixed.memoryUsage().tanks == 3 * sizeof(StaticFuelSys<8, 16>::TankNode);
+        result = result && fixed.memoryUsage().pumps == 1 * sizeof(StaticFuelSys<8, 16>::PumpNode);
+        result = result && fixed.memoryUsage().total() == sizeof(fixed);
+
+        sys.removePump(1, 1);
+        sys.removeTank(1);
+        sys.removeTank(2);
+        MemoryUsage cleared = sys.memoryUsage();
+        result = result && cleared.tanks == 0 && cleared.pumps == 0;
+
+        return result;
+    }
+
+    /*
+     * Function: indexNormal
+     * ---------------------
+     * Adds and removes tanks so freed indices are reused, with pumps into old and new holders of an index
+     *
+     * return: True if indices stay dense and map both ways, pumps follow their tank rather than its index, and copies resolve targets added later in the list, false otherwise
+     */
+    bool indexNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 100; tankID < 104; tankID++) {
+            sys.addTank(tankID, 5000);
+        }
+        result = result && sys.indexBound() == 4 && sys.indexOf(100) == 0 && sys.indexOf(103) == 3;
+        result = result && sys.tankAt(2) == 102 && sys.indexOf(7) == -1 && sys.tankAt(4) == -1 && sys.tankAt(-1) == -1;
+
+        //Tank 103 is last in the list, so copying must add it before the pump into it
+        sys.addPump(100, 1, 103);
+        sys.addPump(101, 1, 102);
+        sys.fill(100, 3000);
+        sys.fill(101, 3000);
+
+        //Tank 7 takes 102's index but not the pump that drained into 102
+        sys.removeTank(102);
+        result = result && sys.tankAt(2) == -1 && sys.indexOf(102) == -1;
+        sys.addTank(7, 5000);
+        result = result && sys.indexOf(7) == 2 && sys.tankAt(2) == 7 && sys.indexBound() == 4;
+        result = result && !sys.drain(101, 1, 1000) && sys.getTank(7)->m_tankFuel == 0;
+        sys.addPump(101, 2, 7);
+        result = result && sys.drain(101, 2, 1000) && sys.getTank(7)->m_tankFuel == 1000;
+
+        FuelSys copy;
+        copy = sys;
+        result = result && copy.drain(100, 1, 2000) && copy.getTank(103)->m_tankFuel == 2000;
+        result = result && copy.targetID(copy.getPump(copy.getTank(101), 2)) == 7;
+        result = result && copy.indexBound() == 4 && copy.tankAt(copy.indexOf(7)) == 7;
+
+        return result;
+    }
+
+    /*
+     * Function: removeBatchNormal
+     * ---------------------------
+     * Removes tanks and pumps in batches from one copy and one at a time from another, with
+     * missing and repeated IDs in the batches
+     *
+     * return: True if both copies end up the same and the counts skip missing and repeated IDs, false otherwise
+     */
+    bool removeBatchNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 0; tankID < 12; tankID++) {
+            sys.addTank(tankID, 6000);
+            sys.fill(tankID, 1000 + tankID * 100);
+        }
+        for (int tankID = 0; tankID < 12; tankID++) {
+            sys.addPump(tankID, 0, (tankID + 1) % 12);
+            sys.addPump(tankID, 1, (tankID + 5) % 12);
+            sys.addPump(tankID, 2, (tankID + 11) % 12);
+        }
+
+        FuelSys batch;
+        FuelSys single;
+        batch = sys;
+        single = sys;
+
+        const std::pair<int, int> pumps[] = { {3, 1}, {0, 0}, {3, 2}, {0, 0}, {99, 1}, {5, 7}, {3, 0} };
+        result = result && batch.removePumps(pumps) == 4;
+        single.removePump(3, 1);
+        single.removePump(0, 0);
+        single.removePump(3, 2);
+        single.removePump(3, 0);
+        result = result && SysDiff::diff(single, batch).empty();
+        result = result && batch.getTank(3)->m_pumps == nullptr && !batch.drain(0, 0, 10) && batch.drain(0, 1, 10);
+        single.drain(0, 1, 10);
+
+        const int tanks[] = { 4, 9, 4, 42, 0 };
+        result = result && batch.removeTanks(tanks) == 3;
+        single.removeTank(4);
+        single.removeTank(9);
+        single.removeTank(0);
+        result = result && SysDiff::diff(single, batch).empty() && batch.totalFuel() == single.totalFuel();
+        result = result && !batch.findTank(9) && batch.indexOf(4) == -1 && !batch.drain(3, 0, 10) && !batch.drain(8, 0, 10);
+
+        //Freed indices are reused the same way
+        batch.addTank(50, 5000);
+        single.addTank(50, 5000);
+        result = result && batch.indexOf(50) == single.indexOf(50) && batch.removeTanks(std::span<const int>()) == 0;
+
+        return result;
+    }
+
+    /*
+     * Function: rebalanceNormal
+     * -------------------------
+     * Resizes tanks, then levels out a loop of tanks by capacity and by weight and tries
+     * groups whose shares do not fit or cannot be reached
+     *
+     * return: True if capacities are checked, rebalanced levels are exact and match
+     * replaying the reported transfers, and failed calls change nothing, false otherwise
+     */
+    bool rebalanceNormal() {
+        bool result = true;
+        FuelSys sys;
+
+        sys.addTank(1, 4000);
+        sys.addTank(2, 6000);
+        sys.addTank(3, 2000);
+        sys.addTank(4, 5000);
+        sys.fill(1, 3000);
+        sys.fill(3, 1200);
+        sys.fill(4, 1900);
+
+        result = result && !sys.setCapacity(9, 5000) && !sys.setCapacity(4, MINCAP - 1) && !sys.setCapacity(3, 1100);
+        sys.setAlarm(4, 0.1, 0.9);
+        result = result && sys.setCapacity(4, 2000) && sys.getTank(4)->m_tankCapacity == 2000;
+        std::vector<Alarm> alarms = sys.takeAlarms();
+        result = result && alarms.size() == 1 && alarms[0].type == HIGHALARM && sys.fullestTanks(1)[0] == 4;
+
+        //1 -> 2 -> 3 -> 1 with 4 only fed from 3
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(3, 1, 1);
+        sys.addPump(3, 2, 4);
+
+        FuelSys replay;
+        replay = sys;
+        std::vector<FuelSys::DrainStep> transfers;
+        const int loop[] = { 1, 2, 3 };
+        result = result && sys.rebalance(loop, {}, &transfers) && !transfers.empty();
+        result = result && sys.getTank(1)->m_tankFuel == 1400 && sys.getTank(2)->m_tankFuel == 2100 && sys.getTank(3)->m_tankFuel == 700;
+        for (const FuelSys::DrainStep& step : transfers) {
+            result = result && step.fuel > 0 && replay.drain(step.tankID, step.pumpID, step.fuel);
+        }
+        result = result && SysDiff::diff(replay, sys).empty();
+
+        //By weight, with the total not dividing evenly
+        const double weights[] = { 1.0, 3.0, 3.0 };
+        result = result && sys.rebalance(loop, weights) && sys.totalFuel() == 6100;
+        result = result && sys.getTank(1)->m_tankFuel == 600 && sys.getTank(2)->m_tankFuel + sys.getTank(3)->m_tankFuel == 3600;
+
+        //Tank 3 cannot hold half, 4 has no pump out, a repeated tank and a short weight list
+        replay = sys;
+        const double tooMuch[] = { 1.0, 1.0, 2.0 };
+        const int outOnly[] = { 3, 4 };
+        const int repeated[] = { 1, 2, 1 };
+        result = result && !sys.rebalance(loop, tooMuch) && !sys.rebalance(outOnly, { weights, 2 });
+        result = result && !sys.rebalance(repeated) && !sys.rebalance(loop, { weights, 2 });
+        result = result && SysDiff::diff(replay, sys).empty();
+
+        //Every gram lands somewhere
+        FuelSysGrams precise;
+        for (int tankID = 0; tankID < 3; tankID++) {
+            precise.addTank(tankID, 3000);
+        }
+        for (int tankID = 0; tankID < 3; tankID++) {
+            precise.addPump(tankID, 0, (tankID + 1) % 3);
+        }
+        precise.fill(0, Grams::fromGrams(1000001));
+        const int all[] = { 0, 1, 2 };
+        result = result && precise.rebalance(all) && precise.totalFuel() == Grams::fromGrams(1000001);
+        result = result && precise.getTank(0)->m_tankFuel == Grams::fromGrams(333334) && precise.getTank(2)->m_tankFuel == Grams::fromGrams(333333);
+
+        return result;
+    }
+
+    /*
+     * Function: alarmEdge
+     * -------------------
+     * Holds tanks exactly on their low and high thresholds with no hysteresis and repeats
+     * updates that leave the level where it is, then sets alarms with invalid bounds and on
+     * tanks that are missing or removed
+     *
+     * return: True if each threshold raises one alarm and never toggles, and bad calls fail
+     * leaving the earlier thresholds in place, false otherwise
+     */
+    bool alarmEdge() {
+        bool result = true;
+        FuelSys sys;
+
+        sys.addTank(1, 10000);
+        sys.addTank(2, 10000);
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 1);
+        sys.fill(1, 2000);
+        sys.fill(2, 8000);
+
+        result = result && sys.setAlarm(1, 0.2, 0.8) && sys.setAlarm(2, 0.2, 0.8);
+        std::vector<Alarm> alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2 && alarms[0].type == LOWALARM && alarms[1].type == HIGHALARM;
+
+        for (int i = 0; i < 4; i++) {
+            sys.fill(1, 0);
+            sys.drain(1, 1, 0);
+            sys.setCapacity(1, 10000);
+            sys.setCapacity(2, 10000);
+        }
+        result = result && sys.takeAlarms().empty();
+
+        //Off the thresholds and back onto them, each alarm clears and raises once
+        sys.drain(2, 1, 1000);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2 && alarms[0].type == HIGHCLEAR && alarms[1].type == LOWCLEAR;
+        sys.drain(1, 1, 1000);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2 && alarms[0].type == LOWALARM && alarms[1].type == HIGHALARM;
+        sys.fill(1, 0);
+        sys.drain(2, 1, 0);
+        result = result && sys.takeAlarms().empty();
+
+        //Bad bounds on a watched tank keep its thresholds
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        result = result && !sys.setAlarm(9, 0.2, 0.8) && !sys.setAlarm(1, 0.8, 0.2) && !sys.setAlarm(1, 0.5, 0.5);
+        result = result && !sys.setAlarm(1, -0.1, 0.8) && !sys.setAlarm(1, 0.2, 1.1) && !sys.setAlarm(1, 0.2, 0.8, -0.1);
+        result = result && !sys.setAlarm(1, nan, 0.8) && !sys.setAlarm(1, 0.2, nan) && !sys.setAlarm(1, 0.2, 0.8, nan);
+        result = result && sys.takeAlarms().empty() && !sys.clearAlarm(9);
+        sys.drain(2, 1, 1000);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2 && alarms[1].tankID == 1 && alarms[1].type == LOWCLEAR;
+
+        //A removed tank takes its thresholds with it
+        result = result && sys.removeTank(2) && !sys.clearAlarm(2) && !sys.setAlarm(2, 0.2, 0.8);
+        sys.addTank(2, 10000);
+        sys.fill(2, 10000);
+        result = result && sys.takeAlarms().empty() && sys.clearAlarm(1) && !sys.clearAlarm(1);
+
+        return result;
+    }
+
+    /*
+     * Function: reachEdge
+     * -------------------
+     * Adds and removes pumps and tanks at random on a plant of more than 64 tanks, asking
+     * after every change, so the answers come from the closure kept up to date rather
+     * than one built for the query
+     *
+     * return: True if reachability and the drain order match the pump lists after every change, false otherwise
+     */
+    bool reachEdge() {
+        bool result = true;
+        const int numTanks = 80;
+        FuelSys sys;
+        Random pick(1, numTanks);
+        Random action(0, 9);
+
+        //Queries on tanks that are not there
+        result = result && !sys.canReach(1, 1) && !sys.sameComponent(1, 1) && sys.drainOrder().empty();
+
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+
+        //An isolated tank reaches itself without being on a cycle
+        result = result && sys.canReach(1, 1) && sys.sameComponent(1, 1) && !sys.canReach(1, 2);
+        result = result && !sys.hasCycle() && sys.isolatedTanks().size() == numTanks;
+
+        int nextPump = 0;
+        for (int step = 0; step < 300 && result; step++) {
+            int choice = action.getRandNum();
+            int tankID = pick.getRandNum();
+            Tank* tank = sys.getTank(tankID);
+            if (choice < 6) {
+                sys.addPump(tankID, nextPump++, pick.getRandNum());
+            }
+            else if (choice < 8 && tank != nullptr && tank->m_pumps != nullptr) {
+                sys.removePump(tankID, tank->m_pumps->m_pumpID);
+            }
+            else if (choice == 8) {
+                sys.removeTank(tankID);
+            }
+            else {
+                sys.addTank(tankID, DEFCAP);
+            }
+
+            //Every tank a search of the pump lists reaches from each source
+            std::vector<std::vector<bool>> seen(numTanks + 1, std::vector<bool>(numTanks + 1, false));
+            for (int source = 1; source <= numTanks; source++) {
+                std::vector<int> frontier;
+                if (sys.getTank(source) != nullptr) {
+                    seen[source][source] = true;
+                    frontier.push_back(source);
+                }
+                while (!frontier.empty()) {
+                    Tank* next = sys.getTank(frontier.back());
+                    frontier.pop_back();
+                    for (Pump* pump = next->m_pumps; pump != nullptr; pump = pump->m_next) {
+                        if (!seen[source][sys.targetID(pump)]) {
+                            seen[source][sys.targetID(pump)] = true;
+                            frontier.push_back(sys.targetID(pump));
+                        }
+                    }
+                }
+            }
+            for (int source = 1; source <= numTanks; source++) {
+                for (int target = 1; target <= numTanks; target++) {
+                    result = result && sys.canReach(source, target) == seen[source][target];
+                    result = result && sys.sameComponent(source, target) == (seen[source][target] && seen[target][source]);
+                }
+            }
+
+            //The drain order holds the tanks on no cycle, each before the ones it pumps into that are on none
+            if (step % 25 == 0) {
+                std::vector<int> order = sys.drainOrder();
+                std::vector<int> position(numTanks + 1, -1);
+                for (size_t i = 0; i < order.size(); i++) {
+                    position[order[i]] = (int)i;
+                }
+                for (int source = 1; source <= numTanks; source++) {
+                    bool onCycle = false;
+                    Tank* next = sys.getTank(source);
+                    for (Pump* pump = next == nullptr ? nullptr : next->m_pumps; pump != nullptr; pump = pump->m_next) {
+                        onCycle = onCycle || seen[sys.targetID(pump)][source];
+                    }
+                    result = result && (position[source] >= 0) == (next != nullptr && !onCycle);
+                    for (Pump* pump = position[source] < 0 ? nullptr : next->m_pumps; pump != nullptr; pump = pump->m_next) {
+                        result = result && (position[sys.targetID(pump)] < 0 || position[source] < position[sys.targetID(pump)]);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: changeFeedEdge
+     * ------------------------
+     * Overflows the smallest ring with a long backlog, changes tanks both waiting and
+     * already moved into the ring between partial flushes, and polls with no room
+     *
+     * return: True if deltas keep their order, pending ones merge and moved ones start a new entry, false otherwise
+     */
+    bool changeFeedEdge() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(0); //Rounded up to 2
+        sys.setFeed(&feed);
+
+        const int numTanks = 1000;
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.fill(tankID, 1);
+        }
+        result = result && subscription->waiting() == numTanks - 2 && subscription->coalesced() == 0;
+
+        //Nothing to take with no room asked for, and nothing moves while the ring is full
+        std::vector<LevelDelta<int>> seen;
+        result = result && subscription->poll(seen, 0) == 0 && subscription->poll(seen, -1) == 0;
+        feed.flush();
+        result = result && subscription->waiting() == numTanks - 2;
+
+        //Work through half the backlog two at a time, a poll with room left would take the rest
+        while (subscription->waiting() > numTanks / 2) {
+            subscription->poll(seen, 2);
+            feed.flush();
+        }
+        result = result && (int)seen.size() == numTanks / 2 - 2;
+
+        //Tank 1 is already in the ring so it gets a new entry, the last tank still waits so it merges
+        sys.fill(1, 1);
+        sys.fill(numTanks, 1);
+        sys.fill(numTanks, 1);
+        result = result && subscription->waiting() == numTanks / 2 + 1 && subscription->coalesced() == 2;
+
+        while (subscription->waiting() > 0) {
+            subscription->poll(seen);
+            feed.flush();
+        }
+        subscription->poll(seen);
+
+        result = result && (int)seen.size() == numTanks + 1;
+        for (int i = 0; i < numTanks && result; i++) {
+            result = result && seen[i].tankID == i + 1 && seen[i].oldLevel == 0;
+        }
+        result = result && seen[numTanks - 1].newLevel == 3;
+        result = result && seen[numTanks].tankID == 1 && seen[numTanks].oldLevel == 1 && seen[numTanks].newLevel == 2;
+
+        //Unsubscribing a stranger leaves the real one in place
+        ChangeFeed<int> other;
+        feed.unsubscribe(other.subscribe());
+        result = result && feed.subscribers() == 1;
+
+        sys.setFeed(nullptr);
+        return result;
+    }
+
+    /*
+     * Function: commandEdge
+     * ---------------------
+     * Leaves owner threads idle long enough to fall asleep, posts to them, then has
+     * producers wait on a two-slot ring whose owner falls behind
+     *
+     * return: True if idle owners use almost no CPU, wake for each post and no command is lost, false otherwise
+     */
+    bool commandEdge() {
+        bool result = true;
+        const int queues = 4;
+        std::vector<std::unique_ptr<FuelSys>> systems;
+        std::vector<std::unique_ptr<CommandQueue>> idle;
+
+        for (int i = 0; i < queues; i++) {
+            systems.push_back(std::make_unique<FuelSys>());
+            idle.push_back(std::make_unique<CommandQueue>(*systems.back(), 2));
+            result = result && idle.back()->tryPost(Command{ ADDTANK, 1, 0, 0, DEFCAP });
+            result = result && idle.back()->tryPost(Command{ ADDTANK, 2, 0, 0, DEFCAP });
+            //The ring is full until an owner runs
+            result = result && !idle.back()->tryPost(Command{ ADDTANK, 3, 0, 0, DEFCAP });
+            idle.back()->start();
+        }
+
+        //Spinning owners would burn about a core each over this time
+        std::clock_t cpu = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        double used = (double)(std::clock() - cpu) / CLOCKS_PER_SEC;
+        result = result && used < 0.1;
+
+        for (int i = 0; i < queues; i++) {
+            result = result && idle[i]->submit(Command{ FILLTANK, 1, 0, 0, 5 }).get();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            result = result && idle[i]->submit(Command{ FILLTANK, 2, 0, 0, 7 }).get();
+            idle[i]->stop();
+            result = result && systems[i]->totalFuel() == 12;
+        }
+
+        //Stopping an owner that sleeps, or one never started, returns at once
+        FuelSys sys;
+        CommandQueue stopped(sys, 2);
+        stopped.stop();
+        stopped.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        stopped.stop();
+
+        //Producers outnumber the slots, so most of them sleep on a full ring
+        CommandQueue queue(sys, 2);
+        result = result && queue.tryPost(Command{ ADDTANK, 1, 0, 0, 1000000 });
+        queue.start(1);
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < 8; producer++) {
+            producers.emplace_back([&queue]() {
+                for (int i = 0; i < 500; i++) {
+                    queue.post(Command{ FILLTANK, 1, 0, 0, 1 });
+                }
+            });
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        queue.stop();
+        result = result && queue.applied() == 4001 && sys.totalFuel() == 4000;
+
+        return result;
+    }
+
+    /*
+     * Function: pumpSweepEdge
+     * -----------------------
+     * Removes a tank that other tanks pump into from the first, last and back to back
+     * places of their pump lists, so the sweep frees the pump it stands on. Build with
+     * -fsanitize=address to see a pump read after it is freed
+     *
+     * return: True if exactly the pumps into the removed tank are gone, false otherwise
+     */
+    bool pumpSweepEdge() {
+        bool result = true;
+        FuelSys sys;
+
+        for (int tankID = 1; tankID <= 4; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+        //Pumps 1, 2, 3 and 6 of tank 1 go into tank 4, all of tank 2's do, tank 3 has one
+        sys.addPump(1, 1, 4);
+        sys.addPump(1, 2, 4);
+        sys.addPump(1, 3, 4);
+        sys.addPump(1, 4, 2);
+        sys.addPump(1, 5, 3);
+        sys.addPump(1, 6, 4);
+        sys.addPump(2, 1, 4);
+        sys.addPump(2, 2, 4);
+        sys.addPump(3, 1, 4);
+
+        result = result && sys.removeTank(4);
+        Tank* first = sys.getTank(1);
+        int left = 0;
+        for (Pump* pump = first->m_pumps; pump != nullptr; pump = pump->m_next) {
+            left++;
+        }
+        result = result && left == 2 && sys.getPump(first, 4) != nullptr && sys.getPump(first, 5) != nullptr;
+        result = result && sys.getTank(2)->m_pumps == nullptr && sys.getTank(3)->m_pumps == nullptr;
+        result = result && sys.drain(1, 4, 0) && !sys.drain(1, 1, 0);
+
+        return result;
+    }
+
+    /*
+     * Function: shardEdge
+     * -------------------
+     * Watches both ends of cross-shard drains that only partly fit or do not fit at all,
+     * makes calls with missing tanks and pumps, and leaves the shard threads idle
+     *
+     * return: True if each tank's level changes once per drain, invalid calls fail and idle shards use almost no CPU, false otherwise
+     */
+    bool shardEdge() {
+        bool result = true;
+        ShardedFuelSys sharded(2, 10);
+        std::vector<ChangeFeed<int>> feeds(2);
+        std::vector<ChangeFeed<int>::Subscription*> watched(2);
+
+        //Tank 1 lives in shard 0 and pumps into tank 11 in shard 1
+        result = result && sharded.addTank(1, MINCAP) && sharded.addTank(11, MINCAP);
+        result = result && sharded.addPump(1, 1, 11) && sharded.crossPumps() == 1;
+        for (int shard = 0; shard < 2; shard++) {
+            result = result && sharded.call<bool>(shard, [&](FuelSys& sys) {
+                watched[shard] = feeds[shard].subscribe();
+                sys.setFeed(&feeds[shard]);
+                return sys.setAlarm(shard == 0 ? 1 : 11, 0.5, 1.0);
+            });
+        }
+        result = result && sharded.fill(1, 1200) && sharded.fill(11, 1900);
+        auto alarms = [&sharded](int shard) {
+            return sharded.call<int>(shard, [](FuelSys& sys) {
+                return (int)sys.takeAlarms().size();
+            });
+        };
+        //Raised when the alarm was set on an empty tank, cleared by the fill
+        result = result && alarms(0) == 2;
+
+        //Only 100 fits, the source drops from 1200 to 1100 and never below its low alarm at 1000
+        result = result && sharded.drain(1, 1, 400);
+        std::vector<LevelDelta<int>> source;
+        std::vector<LevelDelta<int>> target;
+        watched[0]->poll(source);
+        watched[1]->poll(target);
+        result = result && source.size() == 2 && source[1].oldLevel == 1200 && source[1].newLevel == 1100;
+        result = result && target.size() == 2 && target[1].oldLevel == 1900 && target[1].newLevel == 2000;
+        result = result && alarms(0) == 0;
+
+        //A full target takes nothing and neither level moves
+        result = result && !sharded.drain(1, 1, 100);
+        source.clear();
+        target.clear();
+        result = result && watched[0]->poll(source) == 0 && watched[1]->poll(target) == 0;
+        result = result && sharded.level(1) == 1100 && sharded.level(11) == 2000;
+
+        //Calls with missing tanks, pumps or amounts
+        result = result && !sharded.drain(1, 1, -1) && !sharded.drain(1, 2, 10) && !sharded.drain(5, 1, 10);
+        result = result && !sharded.addPump(1, 1, 11) && !sharded.addPump(1, 2, 12) && !sharded.addPump(2, 2, 11);
+        result = result && !sharded.addPump(1, -1, 11) && !sharded.addPump(1, 2, 1);
+        result = result && !sharded.removePump(1, 2) && !sharded.removeTank(12) && !sharded.fill(12, 10);
+        result = result && sharded.level(12) == -1 && !sharded.addTank(11, MINCAP);
+        result = result && sharded.totalFuel() == 3100;
+
+        //Removing the target drops the cross-shard pump
+        result = result && sharded.removeTank(11) && sharded.crossPumps() == 0 && !sharded.drain(1, 1, 10);
+
+        //Idle shard threads sleep rather than spin
+        std::clock_t cpu = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        result = result && (double)(std::clock() - cpu) / CLOCKS_PER_SEC < 0.1;
+        result = result && sharded.level(1) == 1100;
+
+        for (int shard = 0; shard < 2; shard++) {
+            sharded.call<bool>(shard, [&](FuelSys& sys) {
+                sys.setFeed(nullptr);
+                return true;
+            });
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: memoryEdge
+     * --------------------
+     * Adds a tank with pumps of its own and pumps into it, removes it again and repeats,
+     * with the tank watched by an alarm whose alarms are taken each time
+     *
+     * return: True if every count goes back to where it was before the tank came and repeated cycles do not grow the total, false otherwise
+     */
+    bool memoryEdge() {
+        bool result = true;
+        FuelSys sys;
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        MemoryUsage before = sys.memoryUsage();
+
+        size_t settled = 0;
+        for (int cycle = 0; cycle < 50 && result; cycle++) {
+            sys.addTank(3, DEFCAP);
+            sys.addPump(3, 1, 1);
+            sys.addPump(3, 2, 2);
+            sys.addPump(1, 7, 3);
+            sys.setAlarm(3, 0.1, 0.9);
+            result = result && sys.memoryUsage().pumps == 3 * sizeof(Pump);
+            result = result && sys.removeTank(3);
+            sys.takeAlarms();
+
+            MemoryUsage after = sys.memoryUsage();
+            result = result && after.tanks == before.tanks && after.pumps == 0 && after.levels == before.levels;
+            //Tables keep the room they grew to, so only the first cycle may raise the total
+            if (cycle == 0) {
+                settled = after.total();
+            }
+            result = result && after.total() == settled;
+        }
+
+        //Removing a tank that does not exist changes nothing
+        result = result && !sys.removeTank(3) && sys.memoryUsage().total() == settled;
+
+        return result;
+    }
+
+    /*
+     * Function: monteCarloEdge
+     * ------------------------
+     * Runs many scenarios on a three-tank plant small enough that every delivery and
+     * transfer depends on the levels it starts from, then runs with no scenarios and on
+     * systems with no tanks or no pumps
+     *
+     * return: True if each thread count gives the same totals, the base is untouched and empty runs report nothing, false otherwise
+     */
+    bool monteCarloEdge() {
+        bool result = true;
+        FuelSys sys;
+
+        sys.addTank(1, MINCAP);
+        sys.addTank(2, MINCAP);
+        sys.addTank(3, DEFCAP);
+        sys.fill(1, 1500);
+        sys.fill(3, 100);
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(3, 1, 1);
+
+        ScenarioConfig config;
+        config.steps = 40;
+        config.maxFill = 800;
+        config.maxDemand = 1200;
+        ScenarioStats single = MonteCarlo(sys, 1).run(300, 11, config);
+        for (int threads = 2; threads <= 8; threads *= 2) {
+            ScenarioStats many = MonteCarlo(sys, threads).run(300, 11, config);
+            result = result && many.shortfalls == single.shortfalls && many.shortfallKg == single.shortfallKg;
+            result = result && many.overflows == single.overflows && many.overflowKg == single.overflowKg;
+            result = result && many.finalFuel == single.finalFuel;
+        }
+        result = result && single.overflows > 0 && single.shortfalls > 0;
+        result = result && sys.totalFuel() == 1600 && sys.getTank(2)->m_tankFuel == 0;
+
+        //No scenarios, or a negative count, runs nothing
+        ScenarioStats none = MonteCarlo(sys, 4).run(0, 11, config);
+        result = result && none.scenarios == 0 && none.finalFuel == 0 && none.shortfallProbability() == 0.0;
+        result = result && MonteCarlo(sys, 4).run(-3, 11, config).scenarios == 0;
+
+        //No tanks takes no steps, no pumps only delivers
+        FuelSys empty;
+        ScenarioStats idle = MonteCarlo(empty, 2).run(10, 11, config);
+        result = result && idle.scenarios == 10 && idle.finalFuel == 0 && idle.overflows == 0;
+        FuelSys unlinked;
+        unlinked.addTank(1, MINCAP);
+        config.fillChance = 0.0;
+        ScenarioStats fills = MonteCarlo(unlinked, 2).run(10, 11, config);
+        result = result && fills.shortfalls == 0 && fills.finalFuel == 10LL * MINCAP && fills.overflows >= 10;
+
+        return result;
+    }
+
+    //Runs transfers that finish, stall on a full target, an empty source or a missing pump, or never start
+    static TransferScheduler::Job endings(TransferScheduler& scheduler, std::vector<TransferScheduler::TransferResult>& ends) {
+        ends.push_back(co_await scheduler.transfer(1, 1, 1000, 40));
+        ends.push_back(co_await scheduler.transfer(3, 1, 500, 100));
+        ends.push_back(co_await scheduler.transfer(5, 1, 1000, 50));
+        ends.push_back(co_await scheduler.transfer(3, 9, 100, 10));
+        ends.push_back(co_await scheduler.transfer(3, 1, 0, 10));
+        ends.push_back(co_await scheduler.transfer(3, 1, 100, 0));
+    }
+
+    //Sleeps, then moves a little
+    static TransferScheduler::Job paced(TransferScheduler& scheduler, int& moved) {
+        co_await scheduler.sleep(60);
+        moved = co_await scheduler.transfer(3, 1, 40, 1);
+    }
+
+    /*
+     * Function: transferEdge
+     * ----------------------
+     * Runs transfers that end every way one can, then runs a scheduler paced to the wall clock
+     *
+     * return: True if stalls are reported apart from finished transfers and paced time takes real time, false otherwise
+     */
+    bool transferEdge() {
+        bool result = true;
+        FuelSys sys;
+        TransferScheduler scheduler(sys);
+
+        //Tank 2 has room for 100, tank 4 for all of it, tank 5 holds 120
+        for (int tankID = 1; tankID <= 5; tankID++) {
+            sys.addTank(tankID, MINCAP);
+        }
+        sys.addPump(1, 1, 2);
+        sys.addPump(3, 1, 4);
+        sys.addPump(5, 1, 4);
+        sys.fill(1, 300);
+        sys.fill(2, 1900);
+        sys.fill(3, 1000);
+        sys.fill(5, 120);
+
+        std::vector<TransferScheduler::TransferResult> ends;
+        scheduler.spawn(endings(scheduler, ends));
+        scheduler.run();
+        result = result && ends.size() == 6 && scheduler.jobs() == 0 && scheduler.transfers() == 0;
+        result = result && ends[0].moved == 100 && ends[0].stalled;
+        result = result && ends[1].moved == 500 && !ends[1].stalled;
+        result = result && ends[2].moved == 120 && ends[2].stalled;
+        result = result && ends[3].moved == 0 && ends[3].stalled;
+        result = result && ends[4].moved == 0 && !ends[4].stalled;
+        result = result && ends[5].moved == 0 && ends[5].stalled;
+        result = result && sys.totalFuel() == 3320 && sys.getTank(4)->m_tankFuel == 620;
+
+        //60 s of sleep and 40 s of transfer at 2 ms each take at least 0.2 s
+        FuelSys real;
+        TransferScheduler clock(real);
+        real.addTank(3, MINCAP);
+        real.addTank(4, MINCAP);
+        real.addPump(3, 1, 4);
+        real.fill(3, 100);
+        clock.setPace(0.002);
+        int moved = 0;
+        clock.spawn(paced(clock, moved));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        result = result && clock.run() == 100 && moved == 40;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result = result && seconds >= 0.2 && seconds < 5.0;
+
+        //A negative pace runs unpaced
+        clock.setPace(-1);
+        clock.spawn(paced(clock, moved));
+        start = std::chrono::steady_clock::now();
+        result = result && clock.run() == 200 && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100);
+
+        return result;
+    }
+    /*
+     * Function: flowSimEdge
+     * ---------------------
+     * threads: Number of worker threads for the simulation
+     *
+     * Runs three pumps out of one full tank at the largest rate for the largest step, so each
+     * request is past LLONG_MAX / 4 and their sum does not fit in a long long, then checks the
+     * calls a simulation rejects
+     *
+     * return: True if the tank is split evenly without losing fuel and bad calls change nothing, false otherwise
+     */
+    bool flowSimEdge(int threads) {
+        bool result = true;
+        FuelSys sys;
+        FlowSim sim(threads);
+
+        for (int tankID = 1; tankID <= 4; tankID++) {
+            sys.addTank(tankID, INT_MAX);
+        }
+        for (int pumpID = 1; pumpID <= 3; pumpID++) {
+            sys.addPump(1, pumpID, pumpID + 1);
+        }
+        sys.fill(1, INT_MAX);
+
+        sim.load(sys);
+        for (int pumpID = 1; pumpID <= 3; pumpID++) {
+            result = result && sim.setRate(1, pumpID, INT_MAX);
+            result = result && sim.setActive(1, pumpID, true);
+        }
+        result = result && (long long)INT_MAX * INT_MAX > LLONG_MAX / 4;
+
+        sim.run(1, INT_MAX);
+
+        result = result && sim.level(1) == INT_MAX % 3;
+        for (int tankID = 2; tankID <= 4; tankID++) {
+            result = result && sim.level(tankID) == INT_MAX / 3;
+        }
+        result = result && sim.totalFuel() == INT_MAX;
+        result = result && sim.elapsed() == INT_MAX;
+
+        result = result && !sim.setRate(1, 1, -1);
+        result = result && !sim.setRate(1, 4, 1);
+        result = result && !sim.setActive(2, 1, true);
+        result = result && sim.level(5) == -1;
+
+        sim.run(0);
+        sim.run(-1);
+        sim.run(1, 0);
+        result = result && sim.elapsed() == INT_MAX;
+        result = result && sim.totalFuel() == INT_MAX;
+
+        sim.store(sys);
+        result = result && sys.totalFuel() == INT_MAX;
+
+        return result;
+    }
+    /*
+     * Function: rebalanceEdge
+     * -----------------------
+     * Calls rebalance and setCapacity with missing tanks, bad weights, shares that do not fit,
+     * surplus with no pump toward the shortfall and capacities below the fuel in a tank,
+     * with a feed and alarms watching
+     *
+     * return: True if every bad call fails with no level, capacity, delta or alarm changed, false otherwise
+     */
+    bool rebalanceEdge() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(64);
+        std::vector<LevelDelta<int>> deltas;
+
+        //1 -> 2 -> 3 with 4 on its own
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, MINCAP);
+        sys.addTank(3, DEFCAP);
+        sys.addTank(4, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.fill(1, 3000);
+        sys.fill(3, 1000);
+        result = result && sys.setAlarm(1, 0.1, 0.9) && sys.setAlarm(3, 0.1, 0.9) && sys.takeAlarms().empty();
+        sys.setFeed(&feed);
+
+        FuelSys before;
+        before = sys;
+
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double inf = std::numeric_limits<double>::infinity();
+        const int missing[] = { 1, 99 };
+        const int pair[] = { 1, 2 };
+        const int chain[] = { 1, 2, 3 };
+        const int backward[] = { 2, 3 };
+        const int skipped[] = { 1, 3 };
+        const int cut[] = { 1, 4 };
+        const double negative[] = { 1.0, -1.0 };
+        const double notANumber[] = { 1.0, nan };
+        const double infinite[] = { 1.0, inf };
+        const double zero[] = { 0.0, 0.0 };
+        const double allIntoTwo[] = { 0.0, 1.0 };
+        const double tooMany[] = { 1.0, 1.0, 1.0 };
+
+        result = result && !sys.rebalance(missing) && !sys.rebalance(pair, tooMany);
+        result = result && !sys.rebalance(pair, negative) && !sys.rebalance(pair, notANumber);
+        result = result && !sys.rebalance(pair, infinite) && !sys.rebalance(pair, zero);
+        //3000 does not fit in tank 2
+        result = result && !sys.rebalance(pair, allIntoTwo);
+        //Tank 3's surplus has no pump back to 2, 1 reaches 3 only through 2, 4 has no pumps
+        result = result && !sys.rebalance(backward) && !sys.rebalance(skipped) && !sys.rebalance(cut);
+
+        //setCapacity on a missing tank, below MINCAP, below the fuel in the tank
+        result = result && !sys.setCapacity(99, DEFCAP) && !sys.setCapacity(4, MINCAP - 1) && !sys.setCapacity(4, -1);
+        result = result && !sys.setCapacity(1, 2999) && !sys.setCapacity(3, 999);
+
+        result = result && SysDiff::diff(before, sys).empty() && sys.getTank(1)->m_tankCapacity == DEFCAP;
+        result = result && subscription->poll(deltas) == 0 && sys.takeAlarms().empty();
+
+        //An empty group has nothing to move, a capacity equal to the fuel fits exactly
+        result = result && sys.rebalance(std::span<const int>()) && sys.setCapacity(1, 3000);
+        result = result && sys.takeAlarms().size() == 1 && sys.getTank(1)->m_tankCapacity == 3000;
+        result = result && sys.rebalance(chain) && sys.totalFuel() == 4000 && subscription->poll(deltas) == 3;
+
+        //A gram more than the new capacity
+        FuelSysGrams precise;
+        precise.addTank(1, DEFCAP);
+        precise.fill(1, Grams::fromGrams(3000001));
+        result = result && !precise.setCapacity(1, Grams(3000)) && precise.setCapacity(1, Grams::fromGrams(3000001));
+
+        sys.setFeed(nullptr);
+        feed.unsubscribe(subscription);
+
+        return result;
+    }
+    /*
+     * Function: removeBatchEdge
+     * -------------------------
+     * Removes tanks and pumps in batches with only missing, negative and repeated IDs, tanks
+     * that are watched by alarms and the feed and lie on a cycle, doubled pumps, and pumps
+     * whose tank or target is already gone
+     *
+     * return: True if bad IDs remove nothing, and removed tanks leave no alarm, reach edge or
+     * pump behind and report one removal each, false otherwise
+     */
+    bool removeBatchEdge() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(64);
+        std::vector<LevelDelta<int>> deltas;
+
+        //0 -> 1 -> 2 -> 0, then 2 -> 3 twice and 3 -> 4
+        for (int tankID = 0; tankID < 6; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.fill(tankID, 2500);
+        }
+        sys.addPump(0, 0, 1);
+        sys.addPump(1, 0, 2);
+        sys.addPump(2, 0, 0);
+        sys.addPump(2, 1, 3);
+        sys.addPump(2, 2, 3);
+        sys.addPump(3, 0, 4);
+        result = result && sys.setAlarm(1, 0.1, 0.9) && sys.setAlarm(3, 0.1, 0.9) && sys.takeAlarms().empty();
+        sys.setFeed(&feed);
+
+        FuelSys before;
+        before = sys;
+
+        const int missing[] = { 99, -1, 99 };
+        const std::pair<int, int> missingPumps[] = { {99, 0}, {0, 5}, {0, -1}, {-1, -1} };
+        result = result && sys.removeTanks(missing) == 0 && sys.removePumps(missingPumps) == 0;
+        result = result && sys.removePumps(std::span<const std::pair<int, int>>()) == 0;
+        result = result && SysDiff::diff(before, sys).empty() && subscription->poll(deltas) == 0;
+
+        //One of the two pumps 2 -> 3 goes, asked for twice
+        const std::pair<int, int> doubled[] = { {2, 1}, {2, 1}, {2, 9} };
+        result = result && sys.removePumps(doubled) == 1 && sys.canReach(2, 4);
+
+        //Tank 1 is on the cycle, has an alarm and is named three times
+        const int watched[] = { 1, 1, 99, 1 };
+        result = result && sys.removeTanks(watched) == 1 && subscription->poll(deltas) == 1;
+        result = result && deltas.size() == 1 && deltas[0].tankID == 1 && deltas[0].oldLevel == 2500;
+        result = result && deltas[0].newLevel == 0 && deltas[0].cause == REMOVECHANGE;
+        result = result && !sys.hasCycle() && !sys.canReach(0, 2) && sys.canReach(2, 4) && !sys.clearAlarm(1);
+        result = result && sys.getTank(0)->m_pumps == nullptr && sys.totalFuel() == 12500;
+
+        //The freed index goes to a new tank 1 with no alarm, tank 3 keeps its own
+        sys.addTank(1, DEFCAP);
+        sys.fill(1, DEFCAP);
+        sys.fill(3, DEFCAP);
+        std::vector<Alarm> alarms = sys.takeAlarms();
+        result = result && alarms.size() == 1 && alarms[0].tankID == 3 && alarms[0].type == HIGHALARM;
+
+        //Pumps of a removed tank and into one are gone already
+        const int target[] = { 3 };
+        const std::pair<int, int> stale[] = { {2, 2}, {3, 0}, {1, 0} };
+        result = result && sys.removeTanks(target) == 1 && sys.removePumps(stale) == 0;
+        result = result && !sys.canReach(2, 4) && sys.getTank(2)->m_pumps->m_next == nullptr && !sys.clearAlarm(3);
+
+        //Everything at once, twice
+        const int all[] = { 5, 4, 3, 2, 1, 0, 5 };
+        result = result && sys.removeTanks(all) == 5 && sys.removeTanks(all) == 0;
+        result = result && sys.totalFuel() == 0 && !sys.findTank(0) && sys.addTank(0, DEFCAP);
+
+        sys.setFeed(nullptr);
+        feed.unsubscribe(subscription);
+
+        return result;
+    }
+    /*
+     * Function: eventSimEdge
+     * ----------------------
+     * Schedules events in the past, with negative amounts and on missing tanks and pumps,
+     * stops a pump that is not running, restarts one at a new rate and leaves a fast pump
+     * running long enough that rate * time does not fit in a long long
+     *
+     * return: True if bad events are rejected or do nothing and the long run moves all the fuel it can, false otherwise
+     */
+    bool eventSimEdge() {
+        bool result = true;
+        FuelSys sys;
+        EventSim sim(sys);
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 4000);
+
+        result = result && !sim.schedule(0, FILLEVENT, 1, 0, -1) && !sim.schedule(0, PUMPSTART, 1, 1, -5);
+        result = result && sim.schedule(0, FILLEVENT, 9, 0, 100) && sim.schedule(0, DRAINEVENT, 1, 9, 100);
+        result = result && sim.schedule(0, PUMPSTART, 9, 1, 100) && sim.schedule(0, PUMPSTART, 1, 9, 100);
+        result = result && sim.schedule(0, PUMPSTOP, 1, 1) && sim.schedule(0, PUMPSTOP, 9, 9);
+        result = result && sim.run() == 6 && sim.running() == 0 && sim.pending() == 0;
+        result = result && sys.getTank(1)->m_tankFuel == 4000 && sys.getTank(2)->m_tankFuel == 0;
+
+        //Restarting a running pump changes its rate from that time on
+        result = result && sim.schedule(10, PUMPSTART, 1, 1, 10) && sim.schedule(20, PUMPSTART, 1, 1, 20);
+        result = result && sim.schedule(30, PUMPSTOP, 1, 1);
+        result = result && sim.runUntil(25) == 2 && sim.running() == 1 && !sim.schedule(24, FILLEVENT, 1, 0, 1);
+        result = result && sim.run() == 1 && sim.running() == 0 && sys.getTank(2)->m_tankFuel == 300;
+
+        //10^6 per second for 10^13 seconds
+        const long long start = sim.now();
+        result = result && sim.schedule(start, PUMPSTART, 1, 1, 1000000) && sim.runUntil(start) == 1;
+        result = result && sim.runUntil(start + 10000000000000LL) == 0;
+        sim.sync();
+        result = result && sys.getTank(1)->m_tankFuel == 0 && sys.getTank(2)->m_tankFuel == 4000;
+        result = result && sim.now() == start + 10000000000000LL && sim.runUntil(0) == 0 && sim.now() == start + 10000000000000LL;
+
+        return result;
+    }
+    /*
+     * Function: errorOps
+     * ------------------
+     * sys: Empty system with the same operations as FuelSys
+     *
+     * Makes every call FuelSys rejects, with negative, missing and repeated IDs, negative
+     * amounts, a capacity below MINCAP, a pump into its own tank, a full tank and a full
+     * target, and pumps left pointing at a removed tank. The tanks fill to a total past INT_MAX
+     *
+     * return: True if each call returns what FuelSys returns, false otherwise
+     */
+    template <class System>
+    bool errorOps(System& sys) {
+        bool result = true;
+
+        result = result && !sys.addTank(-1, DEFCAP) && !sys.addTank(1, MINCAP - 1) && sys.addTank(1, MINCAP);
+        result = result && !sys.addTank(1, DEFCAP) && sys.addTank(2, INT_MAX) && !sys.findTank(-1);
+
+        result = result && !sys.addPump(1, -1, 2) && !sys.addPump(1, 0, 1) && !sys.addPump(1, 0, 9) && !sys.addPump(9, 0, 1);
+        result = result && sys.addPump(1, 0, 2) && !sys.addPump(1, 0, 2);
+
+        result = result && !sys.fill(1, -1) && !sys.fill(9, 10) && sys.fill(1, INT_MAX) && !sys.fill(1, 1);
+        result = result && sys.fill(2, INT_MAX) && sys.totalFuel() == (long long)INT_MAX + MINCAP;
+        result = result && !sys.drain(1, 0, -1) && !sys.drain(1, 5, 10) && !sys.drain(9, 0, 10) && !sys.drain(1, 0, 10);
+
+        result = result && !sys.removePump(1, -1) && !sys.removePump(9, 0) && !sys.removePump(1, 1);
+        result = result && !sys.removeTank(-1) && !sys.removeTank(9) && sys.removeTank(2) && !sys.removeTank(2);
+        result = result && !sys.drain(1, 0, 10) && !sys.removePump(1, 0) && !sys.addPump(1, 0, 2);
+        result = result && sys.totalFuel() == MINCAP;
+
+        return result;
+    }
+
+    /*
+     * Function: compactEdge
+     * ---------------------
+     * return: True if FuelSys and CompactFuelSys reject the same calls, false otherwise
+     */
+    bool compactEdge() {
+        FuelSys sys;
+        CompactFuelSys compact;
+
+        return errorOps(sys) && errorOps(compact);
+    }
+    /*
+     * Function: staticEdge
+     * --------------------
+     * Runs errorOps on StaticFuelSys, then fills a tiny one to its limits and frees nodes
+     * through removeTank, including a pump into the removed tank
+     *
+     * return: True if bad calls match FuelSys, a full pool rejects without corrupting the
+     * lists, and every freed node can be used again, false otherwise
+     */
+    bool staticEdge() {
+        bool result = true;
+        StaticFuelSys<8, 16> fixed;
+        StaticFuelSys<3, 2, MINCAP / 2> tiny;
+
+        result = result && errorOps(fixed);
+
+        result = result && !tiny.addTank(1, MINCAP / 2 - 1);
+        for (int round = 0; round < 3; round++) {
+            result = result && tiny.addTank(1, MINCAP / 2) && tiny.addTank(2, MINCAP / 2) && tiny.addTank(3, MINCAP / 2);
+            result = result && !tiny.addTank(4, MINCAP / 2) && !tiny.addTank(1, MINCAP / 2);
+            result = result && tiny.addPump(1, 1, 2) && tiny.addPump(3, 1, 2) && !tiny.addPump(2, 1, 3);
+            result = result && tiny.fill(1, MINCAP) && tiny.drain(1, 1, 100) && tiny.totalFuel() == MINCAP / 2;
+
+            //Tank 2's removal frees both pumps into it
+            result = result && tiny.removeTank(2) && tiny.addPump(1, 1, 3) && tiny.addPump(3, 1, 1);
+            result = result && !tiny.drain(1, 2, 100) && tiny.drain(1, 1, 100) && tiny.totalFuel() == MINCAP / 2 - 100;
+            result = result && tiny.removeTank(1) && tiny.removeTank(3) && tiny.totalFuel() == 0;
+        }
+
+        return result;
+    }
+    /*
+     * Function: levelEdge
+     * -------------------
+     * Asks the fill and space queries with no tanks, counts of zero, below zero and past the
+     * number of tanks, reversed, NaN and out of range bounds, bounds exactly on a level and
+     * one gram of free space
+     *
+     * return: True if every query returns exactly the tanks in range, ties by ID, false otherwise
+     */
+    bool levelEdge() {
+        bool result = true;
+        FuelSys sys;
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+
+        result = result && sys.tanksByFill(0.0, 1.0).empty() && sys.emptiestTanks(3).empty() && sys.fullestTanks(3).empty();
+        result = result && sys.tanksWithSpace(0).empty() && sys.mostSpaceTanks(3).empty();
+
+        //Tanks 3 and 1 tie at 40% full
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addTank(3, DEFCAP);
+        sys.fill(1, 2000);
+        sys.fill(2, DEFCAP);
+        sys.fill(3, 2000);
+
+        result = result && sys.emptiestTanks(0).empty() && sys.fullestTanks(-1).empty() && sys.mostSpaceTanks(-5).empty();
+        result = result && sys.emptiestTanks(10) == std::vector<int>{ 1, 3, 2 } && sys.fullestTanks(10) == std::vector<int>{ 2, 3, 1 };
+        result = result && sys.tanksByFill(0.5, 0.3).empty() && sys.tanksByFill(nan, 1.0).empty() && sys.tanksByFill(0.0, nan).empty();
+        result = result && sys.tanksByFill(-1.0, 2.0).size() == 3 && sys.tanksByFill(0.4, 0.4) == std::vector<int>{ 1, 3 };
+        result = result && sys.tanksByFill(1.0, 1.0) == std::vector<int>{ 2 };
+        result = result && sys.tanksWithSpace(0).size() == 3 && sys.tanksWithSpace(-1).size() == 3;
+        result = result && sys.tanksWithSpace(3000) == std::vector<int>{ 1, 3 } && sys.tanksWithSpace(3001).empty();
+
+        //A removed tank leaves every order, its ID comes back at a new level
+        sys.removeTank(1);
+        sys.addTank(1, DEFCAP);
+        result = result && sys.emptiestTanks(1) == std::vector<int>{ 1 } && sys.tanksByFill(0.4, 0.4) == std::vector<int>{ 3 };
+        result = result && sys.mostSpaceTanks(1) == std::vector<int>{ 1 } && sys.tanksWithSpace(DEFCAP + 1).empty();
+
+        FuelSysGrams precise;
+        precise.addTank(1, DEFCAP);
+        precise.fill(1, Grams::fromGrams((long long)DEFCAP * 1000 - 1));
+        result = result && precise.tanksWithSpace(Grams::fromGrams(1)).size() == 1 && precise.tanksWithSpace(Grams::fromGrams(2)).empty();
+        result = result && precise.tanksByFill(1.0, 1.0).empty() && precise.fullestTanks(1) == std::vector<int>{ 1 };
+
+        return result;
+    }
+    /*
+     * Function: plannerEdge
+     * ---------------------
+     * Plans deliveries of nothing, below zero, into no tanks, into full tanks and past all
+     * the free space, splits INT_MAX across tanks of capacity INT_MAX with each policy, and
+     * applies a plan that has gone stale
+     *
+     * return: True if no plan hands out more than the delivery or a tank's space, a plan
+     * that fits hands out all of it, and a stale plan adds only what fits, false otherwise
+     */
+    bool plannerEdge() {
+        bool result = true;
+        const REFILL policies[] = { LOWESTFILL, CAPACITYWEIGHTED, PRIORITY };
+        FuelSys sys;
+        RefillPlanner planner(sys);
+
+        for (REFILL policy : policies) {
+            result = result && planner.plan(100, policy).empty() && planner.deliver(100, policy).empty();
+        }
+
+        sys.addTank(1, MINCAP);
+        sys.addTank(2, DEFCAP);
+        sys.fill(1, MINCAP);
+        sys.fill(2, 1000);
+        for (REFILL policy : policies) {
+            result = result && planner.plan(0, policy).empty() && planner.plan(-5, policy).empty();
+            result = result && planner.deliver(-5, policy).empty() && sys.totalFuel() == MINCAP + 1000;
+        }
+
+        //More than the space fills tank 2 and leaves the full tank out
+        std::vector<Allocation> plan = planner.deliver(INT_MAX, LOWESTFILL);
+        result = result && plan.size() == 1 && plan[0].tankID == 2 && plan[0].fuel == 4000;
+        result = result && planner.plan(1, PRIORITY).empty();
+
+        //Stale plan: tank 3 does not exist, tank 1 is listed twice past its space and one entry is negative
+        sys.removeTank(2);
+        sys.addTank(4, DEFCAP);
+        sys.addPump(1, 0, 4);
+        sys.drain(1, 0, 500);
+        const std::vector<Allocation> stale = { { 3, 100 }, { 1, 300 }, { 1, 300 }, { 4, -10 }, { 4, 200 } };
+        result = result && planner.apply(stale) == 700 && sys.getTank(1)->m_tankFuel == MINCAP;
+        result = result && sys.getTank(4)->m_tankFuel == 700 && planner.apply({}) == 0;
+
+        //INT_MAX into tanks of capacity INT_MAX, none empty enough to take it all
+        FuelSys big;
+        RefillPlanner bigPlanner(big);
+        for (int tankID = 1; tankID <= 3; tankID++) {
+            big.addTank(tankID, INT_MAX);
+        }
+        big.fill(1, INT_MAX / 2);
+        big.fill(2, 1);
+        big.fill(3, INT_MAX - 7);
+        bigPlanner.setPriority(3, INT_MAX);
+        bigPlanner.setPriority(1, INT_MIN);
+        bigPlanner.setPriority(9, 5);
+        for (REFILL policy : policies) {
+            long long handed = 0;
+            bool fits = true;
+            for (const Allocation& allocation : bigPlanner.plan(INT_MAX, policy)) {
+                Tank* tank = big.getTank(allocation.tankID);
+                fits = fits && allocation.fuel > 0 && allocation.fuel <= tank->m_tankCapacity - tank->m_tankFuel;
+                handed += allocation.fuel;
+            }
+            result = result && fits && handed == INT_MAX;
+        }
+        plan = bigPlanner.plan(INT_MAX, PRIORITY);
+        //The lowest priority tank gets nothing once tank 2 takes the rest
+        result = result && plan.size() == 2 && plan[0].tankID == 3 && plan[0].fuel == 7 && plan[1].tankID == 2;
+
+        return result;
+    }
+    /*
+     * Function: cascadeEdge
+     * ---------------------
+     * Asks for cycles and the drain order of an empty plant, then runs cascades with no
+     * steps, a missing source or pump, a step into a cycle, a zero amount and a target
+     * that fills up, with a feed watching
+     *
+     * return: True if a rejected cascade reports no change and clamped steps move only what fits, false otherwise
+     */
+    bool cascadeEdge() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(64);
+        std::vector<LevelDelta<int>> deltas;
+
+        result = result && !sys.hasCycle() && sys.pumpCycles().empty() && sys.drainOrder().empty();
+        result = result && sys.cascadeDrain({}) && !sys.cascadeDrain({ { 1, 1, 100 } });
+
+        //1 -> 2 -> 3 <-> 4 and 5 <-> 6, two cycles
+        for (int tankID = 1; tankID <= 6; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(3, 1, 4);
+        sys.addPump(4, 1, 3);
+        sys.addPump(6, 1, 5);
+        sys.addPump(5, 1, 6);
+        sys.fill(1, 3000);
+        sys.setFeed(&feed);
+
+        result = result && sys.pumpCycles() == std::vector<std::vector<int>>({ { 3, 4 }, { 5, 6 } });
+        result = result && sys.drainOrder() == std::vector<int>({ 1, 2 });
+
+        //Tank 2's pump leads into the cycle, so nothing moves even though step one is valid
+        result = result && !sys.cascadeDrain({ { 1, 1, 1000 }, { 2, 1, 500 } });
+        result = result && !sys.cascadeDrain({ { 1, 1, 1000 }, { 9, 1, 500 } });
+        result = result && subscription->poll(deltas) == 0 && sys.getTank(1)->m_tankFuel == 3000;
+
+        //A removed pump rejects the cascade, a zero amount changes nothing
+        sys.removePump(2, 1);
+        result = result && !sys.cascadeDrain({ { 1, 1, 0 }, { 2, 1, 100 } }) && sys.cascadeDrain({ { 1, 1, 0 } });
+        result = result && subscription->poll(deltas) == 0;
+        sys.fill(2, 4500);
+        result = result && subscription->poll(deltas) == 1;
+
+        //The target has room for 500, the second step finds it full
+        result = result && sys.cascadeDrain({ { 1, 1, 3000 }, { 1, 1, 3000 } });
+        result = result && sys.getTank(1)->m_tankFuel == 2500 && sys.getTank(2)->m_tankFuel == DEFCAP;
+        result = result && subscription->poll(deltas) == 2 && sys.totalFuel() == 7500;
+
+        sys.setFeed(nullptr);
+        feed.unsubscribe(subscription);
+
+        return result;
+    }
+    /*
+     * Function: snapshotEdge
+     * ----------------------
+     * Pins before anything is published, unpins without a pin, reads a snapshot of an empty
+     * system and of missing tanks, nests a pin inside another on the same reader and drops
+     * a reader that is still pinned
+     *
+     * return: True if missing data reads as empty, the outer pin keeps every snapshot it
+     * could reach until it ends, and nothing is left retired after, false otherwise
+     */
+    bool snapshotEdge() {
+        bool result = true;
+        FuelSys sys;
+        SnapshotPublisher publisher;
+        SnapshotPublisher::Reader reader(publisher);
+
+        reader.unpin();
+        result = result && reader.pin() == nullptr && publisher.version() == 0;
+        reader.unpin();
+
+        publisher.publish(sys);
+        {
+            ReadGuard empty(reader);
+            result = result && empty->tankIDs.empty() && empty->pumpBegin.size() == 1 && empty->totalFuel == 0;
+            result = result && empty->level(1) == -1 && empty->targetsOf(1).empty();
+        }
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 1000);
+        publisher.publish(sys);
+
+        //The inner guard must not release the outer snapshot
+        const Snapshot* outer = reader.pin();
+        sys.fill(1, 1000);
+        publisher.publish(sys);
+        {
+            ReadGuard inner(reader);
+            result = result && inner->level(1) == 2000 && outer->level(1) == 1000;
+        }
+        sys.removeTank(2);
+        publisher.publish(sys);
+        publisher.publish(sys);
+        result = result && publisher.retired() == 3 && outer->level(1) == 1000 && outer->targetsOf(1) == std::vector<int>{ 2 };
+        reader.unpin();
+        publisher.reclaim();
+        result = result && publisher.retired() == 0;
+
+        //A reader dropped while pinned stops holding its snapshot
+        {
+            SnapshotPublisher::Reader dropped(publisher);
+            const Snapshot* current = dropped.pin();
+            result = result && current->level(2) == -1 && current->targetsOf(1).empty();
+        }
+        publisher.publish(sys);
+        result = result && publisher.retired() == 0;
+
+        return result;
+    }
+    /*
+     * Function: diffEdge
+     * ------------------
+     * Diffs empty systems and a capacity cut below the old level, then applies one bad op
+     * at a time for each kind of op, and a hand-written patch that mixes additions and removals
+     *
+     * return: True if diffs round-trip, every bad op is refused with the system unchanged,
+     * and ops before a bad one stay applied, false otherwise
+     */
+    bool diffEdge() {
+        bool result = true;
+        FuelSys empty;
+        FuelSys sys;
+
+        result = result && SysDiff::diff(empty, empty).empty() && SysDiff::apply(sys, Patch());
+
+        sys.addTank(1, DEFCAP);
+        sys.addTank(2, DEFCAP);
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 4000);
+
+        //Empty to full and back, and a capacity cut below the level drains first
+        FuelSys copy;
+        result = result && SysDiff::apply(copy, SysDiff::diff(copy, sys)) && SysDiff::diff(copy, sys).empty();
+        copy.removePump(1, 1);
+        copy.addPump(1, 1, 2);
+        result = result && SysDiff::diff(copy, sys).empty();
+        FuelSys cut;
+        cut = sys;
+        cut.drain(1, 1, 3000);
+        cut.setCapacity(1, MINCAP);
+        result = result && SysDiff::apply(copy, SysDiff::diff(copy, cut)) && SysDiff::diff(copy, cut).empty();
+        result = result && SysDiff::apply(copy, SysDiff::diff(copy, empty)) && copy.totalFuel() == 0 && !copy.findTank(1);
+
+        const std::vector<PatchOp> bad = {
+            { PATCH_REMOVETANK, 9, 0, 0 }, { PATCH_REMOVEPUMP, 1, 9, 0 }, { PATCH_REMOVEPUMP, 9, 1, 0 },
+            { PATCH_ADDTANK, 1, 0, DEFCAP }, { PATCH_ADDTANK, -1, 0, DEFCAP }, { PATCH_ADDTANK, 3, 0, MINCAP - 1 },
+            { PATCH_SETCAPACITY, 9, 0, DEFCAP }, { PATCH_SETCAPACITY, 1, 0, MINCAP - 1 }, { PATCH_SETCAPACITY, 1, 0, 3999 },
+            { PATCH_SETFUEL, 9, 0, 10 }, { PATCH_SETFUEL, 1, 0, -1 }, { PATCH_SETFUEL, 1, 0, DEFCAP + 1 },
+            { PATCH_ADDPUMP, 1, 1, 2 }, { PATCH_ADDPUMP, 1, 2, 1 }, { PATCH_ADDPUMP, 1, 2, 9 }, { PATCH_ADDPUMP, 1, -1, 2 },
+            { PATCH_ADDPUMP, 9, 1, 2 }, { PATCH_RETARGET, 1, 9, 2 }, { PATCH_RETARGET, 1, 1, 9 }, { PATCH_RETARGET, 1, 1, 1 } };
+        FuelSys before;
+        before = sys;
+        for (const PatchOp& op : bad) {
+            Patch single;
+            single.ops.push_back(op);
+            result = result && !SysDiff::apply(sys, single) && SysDiff::diff(before, sys).empty();
+        }
+
+        //Ops before the bad one stay applied
+        Patch partial;
+        partial.ops = { { PATCH_SETFUEL, 2, 0, 500 }, { PATCH_REMOVETANK, 9, 0, 0 }, { PATCH_SETFUEL, 2, 0, 900 } };
+        result = result && !SysDiff::apply(sys, partial) && sys.getTank(2)->m_tankFuel == 500;
+
+        //New tanks keep linking at the end after a removal and a pump change on the last one
+        Patch mixed;
+        mixed.ops = { { PATCH_ADDTANK, 3, 0, DEFCAP }, { PATCH_ADDPUMP, 3, 0, 1 }, { PATCH_REMOVEPUMP, 3, 0, 0 },
+            { PATCH_REMOVETANK, 2, 0, 0 }, { PATCH_ADDTANK, 4, 0, DEFCAP }, { PATCH_ADDPUMP, 4, 0, 3 } };
+        result = result && SysDiff::apply(sys, mixed) && sys.findTank(1) && sys.findTank(3) && sys.findTank(4);
+        result = result && !sys.findTank(2) && sys.canReach(4, 3) && !sys.canReach(3, 1) && sys.totalFuel() == 4000;
+
+        return result;
+    }
+    /*
+     * Function: traceEdge
+     * -------------------
+     * Round-trips an empty trace and every command type with fields at INT_MIN and INT_MAX,
+     * records a task, then decodes every prefix of a trace, a count larger than the bytes,
+     * unknown type bits, a tank ID past INT_MAX and a varint that never ends, and saves to
+     * and loads from paths that do not exist
+     *
+     * return: True if valid traces decode to the same entries and every damaged one is
+     * refused with the entries left alone, false otherwise
+     */
+    bool traceEdge() {
+        bool result = true;
+        Trace trace;
+        Trace copy;
+
+        result = result && copy.decode(trace.encode()) && copy.size() == 0;
+
+        const std::vector<Command> extremes = {
+            { ADDTANK, INT_MIN, 0, 0, INT_MAX }, { ADDPUMP, INT_MAX, INT_MIN, INT_MIN, 0 },
+            { REMOVEPUMP, INT_MIN, INT_MAX, 0, 0 }, { FILLTANK, INT_MAX, 0, 0, INT_MIN },
+            { DRAINTANK, 0, -1, 0, INT_MAX }, { REMOVETANK, INT_MIN, 0, 0, 0 } };
+        for (int i = 0; i < (int)extremes.size(); i++) {
+            trace.record(extremes[i], i % 2 == 0);
+        }
+        trace.record(Command{ RUNTASK, 0, 0, 0, 0 }, true);
+        result = result && trace.size() == (int)extremes.size();
+
+        std::vector<unsigned char> bytes = trace.encode();
+        result = result && copy.decode(bytes) && copy.size() == trace.size();
+        for (int i = 0; i < copy.size() && result; i++) {
+            const Command& a = trace.entries()[i].command;
+            const Command& b = copy.entries()[i].command;
+            result = a.type == b.type && a.tankID == b.tankID && a.pumpID == b.pumpID && a.target == b.target
+                && a.amount == b.amount && trace.entries()[i].result == copy.entries()[i].result;
+        }
+
+        for (size_t length = 0; length < bytes.size(); length++) {
+            result = result && !copy.decode(std::vector<unsigned char>(bytes.begin(), bytes.begin() + length));
+        }
+
+        //A count of 100 in a short buffer, type 7, bit 4 of the head, tank delta 2^31 and an endless varint
+        const std::vector<std::vector<unsigned char>> damaged = {
+            { 'F', 'T', 'R', '2', 0 }, { 'F', 'T', 'R', '1', 100, REMOVETANK, 0 }, { 'F', 'T', 'R', '1', 1, 7, 0 },
+            { 'F', 'T', 'R', '1', 1, 16 | REMOVETANK, 0 }, { 'F', 'T', 'R', '1', 1, REMOVETANK, 0x80, 0x80, 0x80, 0x80, 0x10 },
+            { 'F', 'T', 'R', '1', 1, REMOVETANK, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 } };
+        for (const std::vector<unsigned char>& bad : damaged) {
+            result = result && !copy.decode(bad);
+        }
+        result = result && copy.size() == trace.size() && copy.entries()[0].command.tankID == INT_MIN;
+
+        result = result && !trace.save("/nonexistent-dir/trace.bin") && !copy.load("/nonexistent-dir/trace.bin");
+        result = result && copy.size() == trace.size();
+
+        return result;
+    }
+    /*
+     * Function: quantityEdge
+     * ----------------------
+     * Runs errorOps on FuelSys64 and FuelSysGrams, moves LLONG_MAX / 4 sized levels through
+     * FuelSys64 and single grams through FuelSysGrams
+     *
+     * return: True if every quantity type rejects the same calls and large and small amounts
+     * move exactly, false otherwise
+     */
+    bool quantityEdge() {
+        bool result = true;
+        FuelSys64 wide;
+        FuelSysGrams precise;
+        const long long quarter = LLONG_MAX / 4;
+
+        {
+            FuelSys64 errors64;
+            FuelSysGrams errorsGrams;
+            result = result && errorOps(errors64) && errorOps(errorsGrams);
+        }
+
+        //Three tanks of LLONG_MAX / 4, the total still fits
+        for (int tankID = 1; tankID <= 3; tankID++) {
+            wide.addTank(tankID, quarter);
+        }
+        wide.addPump(1, 1, 2);
+        wide.addPump(2, 1, 3);
+        result = result && wide.fill(1, LLONG_MAX) && wide.fill(2, quarter - 1) && !wide.fill(1, 1);
+        result = result && wide.totalFuel() == 2 * quarter - 1 && wide.fullestTanks(1).size() == 1;
+        result = result && wide.drain(1, 1, LLONG_MAX) && wide.getTank(1)->m_tankFuel == quarter - 1;
+        result = result && !wide.drain(1, 1, 1) && !wide.setCapacity(2, quarter - 1) && !wide.drain(1, 1, -1);
+        result = result && wide.drain(2, 1, quarter) && wide.getTank(3)->m_tankFuel == quarter;
+        const int all[] = { 1, 2, 3 };
+        result = result && !wide.rebalance(all) && wide.totalFuel() == 2 * quarter - 1;
+        wide.addPump(3, 1, 1);
+        result = result && wide.rebalance(all) && wide.totalFuel() == 2 * quarter - 1;
+
+        //Grams: a negative gram is refused, one gram moves, the last gram fills the tank
+        precise.addTank(1, MINCAP);
+        precise.addTank(2, MINCAP);
+        precise.addPump(1, 1, 2);
+        result = result && !precise.fill(1, Grams::fromGrams(-1)) && !precise.drain(1, 1, Grams::fromGrams(-1));
+        result = result && precise.fill(1, Grams::fromGrams(1)) && precise.drain(1, 1, Grams::fromGrams(5));
+        result = result && precise.getTank(1)->m_tankFuel == Grams() && precise.getTank(2)->m_tankFuel == Grams::fromGrams(1);
+        result = result && precise.fill(2, Grams::fromGrams((long long)MINCAP * 1000 - 2)) && precise.tanksWithSpace(Grams::fromGrams(1)).size() == 2;
+        result = result && precise.fill(2, DEFCAP) && precise.getTank(2)->m_tankFuel == Grams(MINCAP) && !precise.fill(2, Grams::fromGrams(1));
+
+        return result;
+    }
+    /*
+     * Function: indexEdge
+     * -------------------
+     * Looks up missing tanks and indices, removes and adds tanks many times so indices are
+     * reused, reuses the index of a tank other tanks pumped into, and copies a system whose
+     * indices have holes
+     *
+     * return: True if indices stay dense, a reused index never inherits pumps into the tank
+     * that had it, and the copy matches the original, false otherwise
+     */
+    bool indexEdge() {
+        bool result = true;
+        FuelSys sys;
+
+        result = result && sys.indexOf(1) == -1 && sys.indexOf(-1) == -1 && sys.indexBound() == 0 && sys.tankAt(0) == -1;
+
+        for (int tankID = 1; tankID <= 8; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+        }
+        for (int round = 0; round < 50; round++) {
+            int tankID = 1 + round % 8;
+            result = result && sys.removeTank(tankID) && sys.indexOf(tankID) == -1;
+            result = result && sys.addTank(tankID, DEFCAP) && sys.indexOf(tankID) >= 0 && sys.indexOf(tankID) < 8;
+        }
+        result = result && sys.indexBound() == 8 && sys.indexOf(100) == -1 && sys.tankAt(-1) == -1 && sys.tankAt(8) == -1;
+
+        //Tank 9 takes tank 2's index, the pump into tank 2 must not lead into it
+        sys.addPump(1, 1, 2);
+        sys.fill(1, 1000);
+        int freed = sys.indexOf(2);
+        result = result && sys.removeTank(2) && sys.tankAt(freed) == -1 && sys.addTank(9, DEFCAP) && sys.tankAt(freed) == 9;
+        result = result && !sys.drain(1, 1, 100) && !sys.canReach(1, 9) && sys.getTank(9)->m_tankFuel == 0;
+
+        //The copy lays out its own indices but the same tanks and pumps
+        sys.removeTank(4);
+        sys.removeTank(6);
+        sys.addPump(9, 1, 1);
+        sys.addPump(8, 3, 9);
+        FuelSys copy;
+        copy = sys;
+        result = result && SysDiff::diff(sys, copy).empty() && copy.indexBound() <= sys.indexBound();
+        result = result && !copy.drain(1, 1, 100) && copy.canReach(8, 1) && copy.indexOf(4) == -1;
+
+        return result;
+    }
+    /*
+     * Function: statsEdge
+     * -------------------
+     * Records latencies of zero, below zero and far past the last bucket, and counts from
+     * threads that exit before the snapshot, some of them taking over the block of an
+     * earlier one
+     *
+     * return: True if out of range latencies land in the first and last bucket, counts of
+     * exited threads are kept and every op and event has a distinct name, false otherwise
+     */
+    bool statsEdge() {
+        bool result = true;
+
+        StatSnapshot before = FuelStats::snapshot();
+        FuelStats::latency(STAT_REBALANCE, 0);
+        FuelStats::latency(STAT_REBALANCE, -5);
+        FuelStats::latency(STAT_REBALANCE, LLONG_MAX);
+        FuelStats::latency(STAT_REBALANCE, 1);
+        StatSnapshot after = FuelStats::snapshot();
+        result = result && after.latency[STAT_REBALANCE][0] - before.latency[STAT_REBALANCE][0] == 2;
+        result = result && after.latency[STAT_REBALANCE][1] - before.latency[STAT_REBALANCE][1] == 1;
+        result = result && after.latency[STAT_REBALANCE][STAT_BUCKETS - 1] - before.latency[STAT_REBALANCE][STAT_BUCKETS - 1] == 1;
+
+        //Each thread exits before the next starts, so they share one block
+        before = FuelStats::snapshot();
+        for (int i = 0; i < 4; i++) {
+            std::thread worker([]() {
+                FuelStats::count(STAT_CASCADE);
+                FuelStats::probe(STAT_CASCADE, 10);
+                FuelStats::event(STAT_DESTCLAMP);
+            });
+            worker.join();
+        }
+        after = FuelStats::snapshot();
+        result = result && after.calls[STAT_CASCADE] - before.calls[STAT_CASCADE] == 4;
+        result = result && after.probes[STAT_CASCADE] - before.probes[STAT_CASCADE] == 40;
+        result = result && after.events[STAT_DESTCLAMP] - before.events[STAT_DESTCLAMP] == 4;
+
+        std::set<std::string> names;
+        for (int op = 0; op < STAT_OPS; op++) {
+            result = result && FuelStats::opName((STATOP)op) != nullptr && names.insert(FuelStats::opName((STATOP)op)).second;
+        }
+        for (int event = 0; event < STAT_EVENTS; event++) {
+            result = result && FuelStats::eventName((STATEVENT)event) != nullptr && names.insert(FuelStats::eventName((STATEVENT)event)).second;
+        }
+
+        return result;
+    }
+
+    /*
+     * Function: clearEdge
+     * -------------------
+     * Assigns an empty system over one with tanks, pumps, a cycle and freed indices, then
+     * builds it up again. Clearing frees every node in one pass and empties the indexes once
+     *
+     * return: True if nothing of the old tanks is left and the system works again, false otherwise
+     */
+    bool clearEdge() {
+        bool result = true;
+        FuelSys sys;
+        FuelSys empty;
+
+        for (int tankID = 1; tankID <= 6; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.fill(tankID, 100 * tankID);
+        }
+        sys.addPump(1, 1, 2);
+        sys.addPump(2, 1, 3);
+        sys.addPump(3, 1, 1);
+        sys.addPump(4, 1, 5);
+        sys.removeTank(6);
+        result = result && sys.hasCycle() && sys.canReach(1, 3);
+
+        sys = empty;
+        MemoryUsage usage = sys.memoryUsage();
+        result = result && sys.totalFuel() == 0 && usage.tanks == 0 && usage.pumps == 0;
+        result = result && sys.indexBound() == 0 && sys.indexOf(1) == -1 && sys.tanksByFill(0.0, 1.0).empty();
+        result = result && !sys.hasCycle() && !sys.canReach(1, 3) && !sys.removeTank(1);
+
+        //The same IDs can be used again and start from index 0
+        result = result && sys.addTank(3, DEFCAP) && sys.addTank(1, DEFCAP) && sys.indexOf(3) == 0;
+        result = result && sys.addPump(1, 1, 3) && sys.fill(1, 500) && sys.drain(1, 1, 200);
+        result = result && sys.canReach(1, 3) && !sys.canReach(3, 1) && !sys.hasCycle() && sys.totalFuel() == 500;
+
+        return result;
+    }
+
+    /*
+     * Function: changeFeedQuietEdge
+     * -----------------------------
+     * Overflows a small ring and then stops changing anything, with nobody calling flush.
+     * The reader is first the same thread and then a thread that runs on after the last change
+     *
+     * return: True if polling alone brings every tank's latest level, in order, false otherwise
+     */
+    bool changeFeedQuietEdge() {
+        bool result = true;
+        FuelSys sys;
+        ChangeFeed<int> feed;
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe(4);
+        sys.setFeed(&feed);
+
+        const int numTanks = 10;
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.fill(tankID, tankID);
+        }
+        sys.fill(numTanks, 1);
+        result = result && subscription->waiting() == numTanks - 4 && subscription->coalesced() == 1;
+
+        //A poll that stops short of the ring's end leaves the overflow alone
+        std::vector<LevelDelta<int>> seen;
+        result = result && subscription->poll(seen, 3) == 3 && subscription->waiting() == numTanks - 4;
+        result = result && subscription->poll(seen, 4) == 4 && subscription->waiting() == numTanks - 7;
+        result = result && subscription->poll(seen) == numTanks - 7 && subscription->waiting() == 0;
+        result = result && (int)seen.size() == numTanks && subscription->poll(seen) == 0;
+        for (int i = 0; i < numTanks && result; i++) {
+            result = result && seen[i].tankID == i + 1 && seen[i].oldLevel == 0;
+        }
+        result = result && seen[numTanks - 1].newLevel == numTanks + 1;
+
+        //The producer stops while the reader is still behind
+        seen.clear();
+        std::atomic<bool> stopped(false);
+        std::thread reader([&]() {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (std::chrono::steady_clock::now() < deadline) {
+                bool last = stopped.load();
+                subscription->poll(seen);
+                if (last && subscription->waiting() == 0) {
+                    break;
+                }
+            }
+        });
+        for (int step = 0; step < 20000; step++) {
+            sys.fill(1 + step % numTanks, 1);
+        }
+        stopped.store(true);
+        reader.join();
+
+        std::vector<int> last(numTanks + 1, 0);
+        for (int tankID = 1; tankID < numTanks; tankID++) {
+            last[tankID] = tankID;
+        }
+        last[numTanks] = numTanks + 1;
+        for (const LevelDelta<int>& delta : seen) {
+            result = result && delta.oldLevel == last[delta.tankID];
+            last[delta.tankID] = delta.newLevel;
+        }
+        for (int tankID = 1; tankID <= numTanks; tankID++) {
+            result = result && last[tankID] == sys.getTank(tankID)->m_tankFuel;
+        }
+
+        sys.setFeed(nullptr);
+        return result;
+    }
+
+    /*
+     * Function: assignEdge
+     * --------------------
+     * Assigns over a watched and subscribed system a copy that shares some of its tanks,
+     * with one shared tank at a new level and one at the same level in a smaller tank
+     *
+     * return: True if shared tanks keep their alarms and report one change each, and only
+     * the tanks that are gone are reported removed, false otherwise
+     */
+    bool assignEdge() {
+        bool result = true;
+        FuelSys sys;
+        FuelSys source;
+        ChangeFeed<int> feed;
+
+        for (int tankID = 1; tankID <= 3; tankID++) {
+            sys.addTank(tankID, DEFCAP);
+            sys.setAlarm(tankID, 0.2, 0.8);
+        }
+        sys.fill(1, 2500);
+        sys.fill(2, 1800);
+        sys.fill(3, 2500);
+        sys.takeAlarms();
+
+        source.addTank(1, DEFCAP);
+        source.addTank(2, MINCAP);
+        source.addTank(4, DEFCAP);
+        source.fill(1, 500);
+        source.fill(2, 1800);
+        source.fill(4, 100);
+
+        ChangeFeed<int>::Subscription* subscription = feed.subscribe();
+        sys.setFeed(&feed);
+        sys = source;
+
+        //Tank 3 goes first, then tanks 1 and 4 in list order, tank 2's level is unchanged
+        std::vector<LevelDelta<int>> seen;
+        result = result && subscription->poll(seen) == 3;
+        result = result && seen[0].tankID == 3 && seen[0].oldLevel == 2500 && seen[0].newLevel == 0 && seen[0].cause == REMOVECHANGE;
+        result = result && seen[1].tankID == 1 && seen[1].oldLevel == 2500 && seen[1].newLevel == 500 && seen[1].cause == FILLCHANGE;
+        result = result && seen[2].tankID == 4 && seen[2].oldLevel == 0 && seen[2].newLevel == 100;
+
+        //Tank 1 fell below its low bound and tank 2 rose above its high bound by shrinking
+        std::vector<Alarm> alarms = sys.takeAlarms();
+        result = result && alarms.size() == 2;
+        result = result && alarms[0].tankID == 1 && alarms[0].type == LOWALARM;
+        result = result && alarms[1].tankID == 2 && alarms[1].type == HIGHALARM;
+
+        //The kept alarms still fire, tank 3's went with it and tank 4 never had one
+        sys.fill(1, 2000);
+        alarms = sys.takeAlarms();
+        result = result && alarms.size() == 1 && alarms[0].tankID == 1 && alarms[0].type == LOWCLEAR;
+        result = result && sys.clearAlarm(2) && !sys.clearAlarm(3) && !sys.clearAlarm(4);
+        result = result && sys.tanksByFill(0.0, 1.0).size() == 3 && sys.totalFuel() == 4400;
+
+        sys.setFeed(nullptr);
+        return result;
+    }
+
+    /*
+     * Function: eventChainEdge
+     * ------------------------
+     * Runs pumps 1 to 2 to 3 with an event at 100 s on each tank of the chain in turn, on a
+     * tank outside it and on none, then runs a loop of pumps 1 to 2 to 1 started in both orders
+     *
+     * return: True if the chain ends the same whichever of its tanks the event touched, each
+     * settlement passes on only what the middle tank held before it, and the loop ends the
+     * same in both orders, false otherwise
+     */
+    bool eventChainEdge() {
+        bool result = true;
+
+        //touched is the tank the event at 100 s fills with nothing, 0 for no event
+        auto chain = [](int touched, int* levels) {
+            FuelSys sys;
+            EventSim sim(sys);
+            for (int tankID = 1; tankID <= 4; tankID++) {
+                sys.addTank(tankID, DEFCAP);
+            }
+            sys.addPump(1, 1, 2);
+            sys.addPump(2, 1, 3);
+            sys.fill(1, 4000);
+
+            sim.schedule(0, PUMPSTART, 2, 1, 10);
+            sim.schedule(0, PUMPSTART, 1, 1, 10);
+            if (touched != 0) {
+                sim.schedule(100, FILLEVENT, touched, 0, 0);
+            }
+            sim.runUntil(200);
+            sim.sync();
+            for (int tankID = 1; tankID <= 3; tankID++) {
+                levels[tankID - 1] = sys.getTank(tankID)->m_tankFuel;
+            }
+        };
+
+        int levels[3];
+        for (int touched = 1; touched <= 3; touched++) {
+            chain(touched, levels);
+            result = result && levels[0] == 2000 && levels[1] == 1000 && levels[2] == 1000;
+        }
+        //Settled once at 200 s, tank 2 was empty at the start so nothing reaches tank 3
+        chain(4, levels);
+        result = result && levels[0] == 2000 && levels[1] == 2000 && levels[2] == 0;
+        chain(0, levels);
+        result = result && levels[0] == 2000 && levels[1] == 2000 && levels[2] == 0;
+
+        //The loop is broken at tank 1's pump whichever pump started first
+        for (int first = 1; first <= 2; first++) {
+            FuelSys sys;
+            EventSim sim(sys);
+            sys.addTank(1, DEFCAP);
+            sys.addTank(2, DEFCAP);
+            sys.addPump(1, 1, 2);
+            sys.addPump(2, 1, 1);
+            sys.fill(1, 4000);
+
+            sim.schedule(0, PUMPSTART, first, 1, 10);
+            sim.schedule(0, PUMPSTART, 3 - first, 1, 10);
+            sim.runUntil(100);
+            sim.sync();
+            result = result && sys.getTank(1)->m_tankFuel == 4000 && sys.getTank(2)->m_tankFuel == 0;
+        }
+
+        return result;
+    }
 };
 
-int main() {
-    Tester test;
-    FuelSys sys;
-    FuelSys singleSys; //System with one tank
-    Random randCap(MINCAP, DEFCAP); //Range for valid test capacities
-    int numTanks = 10; //Number of tanks in the system
-    int numPumps = 5; //Number of pumps in the system
+int main() {
+    Tester test;
+    FuelSys sys;
+    FuelSys singleSys; //System with one tank
+    Random randCap(MINCAP, DEFCAP); //Range for valid test capacities
+    int numTanks = 10; //Number of tanks in the system
+    int numPumps = 5; //Number of pumps in the system
+
+    //Tests adding tanks
+    if (test.addNormalTank(sys, randCap, numTanks)) {
+        cout << "addNormalTank test returned successful\n";
+    }
+    else {
+        cout << "addNormalTank test returned unsuccessful\n";
+    }
+
+    if (test.addErrortank(sys, randCap, numTanks)) {
+        cout << "addErrorTank test returned successful\n";
+    }
+    else {
+        cout << "addErrorTank test returned unsuccessul\n";
+    }
+
+    if (test.addEdgeTank(sys, randCap, numTanks)) {
+        cout << "addEdgeTank test returned successful\n";
+    }
+    else {
+        cout << "addEdgeTank test returned unsuccessful\n";
+    }
+
+    //Tests finding tanks
+    if (test.findNormalTank(sys, numTanks)) {
+        cout << "findNormalTank test returned successful\n";
+    }
+    else {
+        cout << "findNormalTank test returned unsuccessful\n";
+    }
+
+    if (test.findErrorTank(sys, numTanks)) {
+        cout << "findErrorTank test returned successful\n";
+    }
+    else {
+        cout << "findErrorTank test returned unsuccessful\n";
+    }
+
+    singleSys.addTank(1, MINCAP);
+
+    if (test.findEdgeTank(singleSys)) {
+        cout << "findEdgeTank test returned successful\n";
+    }
+    else {
+        cout << "findEdgeTank test returned unsuccessful\n";
+    }
+
+    //Tests adding pumps
+    if (test.addNormalPump(sys, numTanks, numPumps)) {
+        cout << "addNormalPump test returned successsful\n";
+    }
+    else {
+        cout << "addNormalPump test returned unsuccessful\n";
+    }
+
+    if (test.addErrorPump(sys, numTanks, numPumps)) {
+        cout << "addErrorPump test returned successful\n";
+    }
+    else {
+        cout << "addErrorPump test returned unsuccessful\n";
+    }
+
+    if (test.addEdgePump(sys)) {
+        cout << "addEdgePump test returned successful\n";
+    }
+    else {
+        cout << "addEdgePump test returned unsuccessful\n";
+    }
+
+    //Tests filling tanks
+    if (test.fillNormalTank(sys, numTanks)) {
+        cout << "fillNormalTank test returned successful\n";
+    }
+    else {
+        cout << "fillNormalTank test returned unsuccesful\n";
+    }
+
+    if (test.fillErrorTank(sys, numTanks)) {
+        cout << "fillErrorTank test returned successful\n";
+    }
+    else {
+        cout << "fillErrorTank test returned unsuccessful\n";
+    }
+
+    if (test.fillEdgeTank(sys)) {
+        cout << "fillEdgeTank test returned successful\n";
+    }
+    else {
+        cout << "fillEdgeTank test returned unsuccessful\n";
+    }
+
+    //Tests draining tanks
+    if (test.drainNormalTank(sys, numTanks, numPumps)) {
+        cout << "drainNormalTank test returned successful\n";
+    }
+    else {
+        cout << "drainNormalTank test returned unsuccessful\n";
+    }
+
+    if (test.drainErrorTank(sys, numTanks, numPumps)) {
+        cout << "drainErrorTank test returned successful\n";
+    }
+    else {
+        cout << "drainErrorTank test returned unsuccessful\n";
+    }
+
+    if (test.drainEdgeTank(sys)) {
+        cout << "drainEdgeTank test returned successful\n";
+    }
+    else {
+        cout << "drainEdgeTank test returned unsuccessful\n";
+    }
+
+    //Tests copying fuel systems
+    if (test.copyNormalSys(sys, singleSys, numTanks)) {
+        cout << "copyNormalSys test returned successful\n";
+    }
+    else {
+        cout << "copyNormalSys test returned unsuccessful\n";
+    }
+
+    if (test.copyEdgeSys(singleSys, numTanks)) {
+        cout << "copyEdgeSys test returned successful\n";
+    }
+    else {
+        cout << "copyEdgeSys test returned unsuccessful\n";
+    }
+
+    //Tests removing pumps
+    if (test.removeNormalPump(sys, numTanks, numPumps)) {
+        cout << "removeNormalPump test returned successful\n";
+    }
+    else {
+        cout << "removeNormalPump test returned unsuccessful\n";
+    }
+
+    if (test.removeErrorPump(sys, numTanks, numPumps)) {
+        cout << "removeErrorPump test returned successful\n";
+    }
+    else {
+        cout << "removeErrorPump test returned unsuccessful\n";
+    }
+
+    if (test.removeEdgePump(sys, numTanks)) {
+        cout << "removeEdgePump test returned successful\n";
+    }
+    else {
+        cout << "removeEdgePump test returned unsuccessful\n";
+    }
+
+    //Tests removing tanks
+    if (test.removeNormalTank(sys, numTanks)) {
+        cout << "removeNormalTank test returned successful\n";
+    }
+    else {
+        cout << "removeNormalTank test returned unsuccessful\n";
+    }
+
+    if (test.removeErrorTank(sys, numTanks)) {
+        cout << "removeErrorTank test returned successful\n";
+    }
+    else {
+        cout << "removeErrorTank test returned unsuccessful\n";
+    }
+
+    if (test.removeEdgeTank(sys)) {
+        cout << "removeEdgeTank test returned successful\n";
+    }
+    else {
+        cout << "removeEdgeTank test returned unsuccessful\n";
+    }
+
+
+    //Tests the time-stepped simulation
+    if (test.flowSimNormal(1) && test.flowSimNormal(3)) {
+        cout << "flowSimNormal test returned successful\n";
+    }
+    else {
+        cout << "flowSimNormal test returned unsuccessful\n";
+    }
+
+
+    //Tests the event-driven simulation
+    if (test.eventSimNormal()) {
+        cout << "eventSimNormal test returned successful\n";
+    }
+    else {
+        cout << "eventSimNormal test returned unsuccessful\n";
+    }
+
 
-    //Tests adding tanks
-    if (test.addNormalTank(sys, randCap, numTanks)) {
-        cout << "addNormalTank test returned successful\n";
+    //Tests the scenario runner
+    if (test.monteCarloNormal(numTanks)) {
+        cout << "monteCarloNormal test returned successful\n";
     }
     else {
-        cout << "addNormalTank test returned unsuccessful\n";
+        cout << "monteCarloNormal test returned unsuccessful\n";
     }
 
-    if (test.addErrortank(sys, randCap, numTanks)) {
-        cout << "addErrorTank test returned successful\n";
+
+    //Tests the instrumentation counters
+    if (test.statsNormal()) {
+        cout << "statsNormal test returned successful\n";
     }
     else {
-        cout << "addErrorTank test returned unsuccessul\n";
+        cout << "statsNormal test returned unsuccessful\n";
     }
 
-    if (test.addEdgeTank(sys, randCap, numTanks)) {
-        cout << "addEdgeTank test returned successful\n";
+
+    //Tests the wide and fixed-point quantity types
+    if (test.quantityNormal()) {
+        cout << "quantityNormal test returned successful\n";
     }
     else {
-        cout << "addEdgeTank test returned unsuccessful\n";
+        cout << "quantityNormal test returned unsuccessful\n";
     }
 
-    //Tests finding tanks
-    if (test.findNormalTank(sys, numTanks)) {
-        cout << "findNormalTank test returned successful\n";
+
+    //Tests the index-based storage
+    if (test.compactNormal(numTanks)) {
+        cout << "compactNormal test returned successful\n";
     }
     else {
-        cout << "findNormalTank test returned unsuccessful\n";
+        cout << "compactNormal test returned unsuccessful\n";
     }
 
-    if (test.findErrorTank(sys, numTanks)) {
-        cout << "findErrorTank test returned successful\n";
+    if (test.staticNormal(numTanks)) {
+        cout << "staticNormal test returned successful\n";
     }
     else {
-        cout << "findErrorTank test returned unsuccessful\n";
+        cout << "staticNormal test returned unsuccessful\n";
     }
 
-    singleSys.addTank(1, MINCAP);
 
-    if (test.findEdgeTank(singleSys)) {
-        cout << "findEdgeTank test returned successful\n";
+    //Tests the fill-level index
+    if (test.levelNormal()) {
+        cout << "levelNormal test returned successful\n";
     }
     else {
-        cout << "findEdgeTank test returned unsuccessful\n";
+        cout << "levelNormal test returned unsuccessful\n";
     }
 
-    //Tests adding pumps
-    if (test.addNormalPump(sys, numTanks, numPumps)) {
-        cout << "addNormalPump test returned successsful\n";
+
+    //Tests the refill planner
+    if (test.plannerNormal()) {
+        cout << "plannerNormal test returned successful\n";
     }
     else {
-        cout << "addNormalPump test returned unsuccessful\n";
+        cout << "plannerNormal test returned unsuccessful\n";
     }
 
-    if (test.addErrorPump(sys, numTanks, numPumps)) {
-        cout << "addErrorPump test returned successful\n";
+
+    //Tests the reachability index
+    if (test.reachNormal()) {
+        cout << "reachNormal test returned successful\n";
     }
     else {
-        cout << "addErrorPump test returned unsuccessful\n";
+        cout << "reachNormal test returned unsuccessful\n";
     }
 
-    if (test.addEdgePump(sys)) {
-        cout << "addEdgePump test returned successful\n";
+
+    //Tests cycle detection and cascading drains
+    if (test.cascadeNormal()) {
+        cout << "cascadeNormal test returned successful\n";
     }
     else {
-        cout << "addEdgePump test returned unsuccessful\n";
+        cout << "cascadeNormal test returned unsuccessful\n";
     }
 
-    //Tests filling tanks
-    if (test.fillNormalTank(sys, numTanks)) {
-        cout << "fillNormalTank test returned successful\n";
+
+    //Tests snapshots read concurrently with changes
+    if (test.snapshotNormal()) {
+        cout << "snapshotNormal test returned successful\n";
     }
     else {
-        cout << "fillNormalTank test returned unsuccesful\n";
+        cout << "snapshotNormal test returned unsuccessful\n";
     }
 
-    if (test.fillErrorTank(sys, numTanks)) {
-        cout << "fillErrorTank test returned successful\n";
+
+    //Tests the command queue
+    if (test.commandNormal()) {
+        cout << "commandNormal test returned successful\n";
     }
     else {
-        cout << "fillErrorTank test returned unsuccessful\n";
+        cout << "commandNormal test returned unsuccessful\n";
     }
 
-    if (test.fillEdgeTank(sys)) {
-        cout << "fillEdgeTank test returned successful\n";
+
+    //Tests the sharded system
+    if (test.shardNormal()) {
+        cout << "shardNormal test returned successful\n";
     }
     else {
-        cout << "fillEdgeTank test returned unsuccessful\n";
+        cout << "shardNormal test returned unsuccessful\n";
     }
 
-    //Tests draining tanks
-    if (test.drainNormalTank(sys, numTanks, numPumps)) {
-        cout << "drainNormalTank test returned successful\n";
+
+    //Tests coroutine transfers
+    if (test.transferNormal()) {
+        cout << "transferNormal test returned successful\n";
     }
     else {
-        cout << "drainNormalTank test returned unsuccessful\n";
+        cout << "transferNormal test returned unsuccessful\n";
     }
 
-    if (test.drainErrorTank(sys, numTanks, numPumps)) {
-        cout << "drainErrorTank test returned successful\n";
+
+    //Tests the change feed
+    if (test.changeFeedNormal()) {
+        cout << "changeFeedNormal test returned successful\n";
     }
     else {
-        cout << "drainErrorTank test returned unsuccessful\n";
+        cout << "changeFeedNormal test returned unsuccessful\n";
     }
 
-    if (test.drainEdgeTank(sys)) {
-        cout << "drainEdgeTank test returned successful\n";
+
+    //Tests threshold alarms
+    if (test.alarmNormal()) {
+        cout << "alarmNormal test returned successful\n";
     }
     else {
-        cout << "drainEdgeTank test returned unsuccessful\n";
+        cout << "alarmNormal test returned unsuccessful\n";
     }
 
-    //Tests copying fuel systems
-    if (test.copyNormalSys(sys, singleSys, numTanks)) {
-        cout << "copyNormalSys test returned successful\n";
+
+    //Tests diffing and patching systems
+    if (test.diffNormal()) {
+        cout << "diffNormal test returned successful\n";
     }
     else {
-        cout << "copyNormalSys test returned unsuccessful\n";
+        cout << "diffNormal test returned unsuccessful\n";
     }
 
-    if (test.copyEdgeSys(singleSys, numTanks)) {
-        cout << "copyEdgeSys test returned successful\n";
+
+    //Tests recording and replaying traces
+    if (test.traceNormal()) {
+        cout << "traceNormal test returned successful\n";
     }
     else {
-        cout << "copyEdgeSys test returned unsuccessful\n";
+        cout << "traceNormal test returned unsuccessful\n";
     }
 
-    //Tests removing pumps
-    if (test.removeNormalPump(sys, numTanks, numPumps)) {
-        cout << "removeNormalPump test returned successful\n";
+
+    //Tests memory accounting
+    if (test.memoryNormal()) {
+        cout << "memoryNormal test returned successful\n";
     }
     else {
-        cout << "removeNormalPump test returned unsuccessful\n";
+        cout << "memoryNormal test returned unsuccessful\n";
     }
 
-    if (test.removeErrorPump(sys, numTanks, numPumps)) {
-        cout << "removeErrorPump test returned successful\n";
+
+    //Tests dense tank indices
+    if (test.indexNormal()) {
+        cout << "indexNormal test returned successful\n";
     }
     else {
-        cout << "removeErrorPump test returned unsuccessful\n";
+        cout << "indexNormal test returned unsuccessful\n";
     }
 
-    if (test.removeEdgePump(sys, numTanks)) {
-        cout << "removeEdgePump test returned successful\n";
+
+    if (test.removeBatchNormal()) {
+        cout << "removeBatchNormal test returned successful\n";
     }
     else {
-        cout << "removeEdgePump test returned unsuccessful\n";
+        cout << "removeBatchNormal test returned unsuccessful\n";
     }
 
-    //Tests removing tanks
-    if (test.removeNormalTank(sys, numTanks)) {
-        cout << "removeNormalTank test returned successful\n";
+
+    if (test.rebalanceNormal()) {
+        cout << "rebalanceNormal test returned successful\n";
     }
     else {
-        cout << "removeNormalTank test returned unsuccessful\n";
+        cout << "rebalanceNormal test returned unsuccessful\n";
     }
 
-    if (test.removeErrorTank(sys, numTanks)) {
-        cout << "removeErrorTank test returned successful\n";
+
+    if (test.alarmEdge()) {
+        cout << "alarmEdge test returned successful\n";
     }
     else {
-        cout << "removeErrorTank test returned unsuccessful\n";
+        cout << "alarmEdge test returned unsuccessful\n";
     }
 
-    if (test.removeEdgeTank(sys)) {
-        cout << "removeEdgeTank test returned successful\n";
+
+    if (test.reachEdge()) {
+        cout << "reachEdge test returned successful\n";
     }
     else {
-        cout << "removeEdgeTank test returned unsuccessful\n";
+        cout << "reachEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.changeFeedEdge()) {
+        cout << "changeFeedEdge test returned successful\n";
+    }
+    else {
+        cout << "changeFeedEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.commandEdge()) {
+        cout << "commandEdge test returned successful\n";
+    }
+    else {
+        cout << "commandEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.pumpSweepEdge()) {
+        cout << "pumpSweepEdge test returned successful\n";
+    }
+    else {
+        cout << "pumpSweepEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.shardEdge()) {
+        cout << "shardEdge test returned successful\n";
+    }
+    else {
+        cout << "shardEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.memoryEdge()) {
+        cout << "memoryEdge test returned successful\n";
+    }
+    else {
+        cout << "memoryEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.monteCarloEdge()) {
+        cout << "monteCarloEdge test returned successful\n";
+    }
+    else {
+        cout << "monteCarloEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.transferEdge()) {
+        cout << "transferEdge test returned successful\n";
+    }
+    else {
+        cout << "transferEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.flowSimEdge(1) && test.flowSimEdge(3)) {
+        cout << "flowSimEdge test returned successful\n";
+    }
+    else {
+        cout << "flowSimEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.rebalanceEdge()) {
+        cout << "rebalanceEdge test returned successful\n";
+    }
+    else {
+        cout << "rebalanceEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.removeBatchEdge()) {
+        cout << "removeBatchEdge test returned successful\n";
+    }
+    else {
+        cout << "removeBatchEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.eventSimEdge()) {
+        cout << "eventSimEdge test returned successful\n";
+    }
+    else {
+        cout << "eventSimEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.compactEdge()) {
+        cout << "compactEdge test returned successful\n";
+    }
+    else {
+        cout << "compactEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.staticEdge()) {
+        cout << "staticEdge test returned successful\n";
+    }
+    else {
+        cout << "staticEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.levelEdge()) {
+        cout << "levelEdge test returned successful\n";
+    }
+    else {
+        cout << "levelEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.plannerEdge()) {
+        cout << "plannerEdge test returned successful\n";
+    }
+    else {
+        cout << "plannerEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.cascadeEdge()) {
+        cout << "cascadeEdge test returned successful\n";
+    }
+    else {
+        cout << "cascadeEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.snapshotEdge()) {
+        cout << "snapshotEdge test returned successful\n";
+    }
+    else {
+        cout << "snapshotEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.diffEdge()) {
+        cout << "diffEdge test returned successful\n";
+    }
+    else {
+        cout << "diffEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.traceEdge()) {
+        cout << "traceEdge test returned successful\n";
+    }
+    else {
+        cout << "traceEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.quantityEdge()) {
+        cout << "quantityEdge test returned successful\n";
+    }
+    else {
+        cout << "quantityEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.indexEdge()) {
+        cout << "indexEdge test returned successful\n";
     }
+    else {
+        cout << "indexEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.statsEdge()) {
+        cout << "statsEdge test returned successful\n";
+    }
+    else {
+        cout << "statsEdge test returned unsuccessful\n";
+    }
+
+
+    if (test.clearEdge()) {
+        cout << "clearEdge test returned successful\n";
+    }
+    else {
+        cout << "clearEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.changeFeedQuietEdge()) {
+        cout << "changeFeedQuietEdge test returned successful\n";
+    }
+    else {
+        cout << "changeFeedQuietEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.assignEdge()) {
+        cout << "assignEdge test returned successful\n";
+    }
+    else {
+        cout << "assignEdge test returned unsuccessful\n";
+    }
+
+
+
+    if (test.eventChainEdge()) {
+        cout << "eventChainEdge test returned successful\n";
+    }
+    else {
+        cout << "eventChainEdge test returned unsuccessful\n";
+    }
+
 
     return 0;
 }
\ No newline at end of file
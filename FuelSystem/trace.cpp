@@ -0,0 +1,227 @@
+#include "trace.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+static const unsigned char MAGIC[4] = { 'F', 'T', 'R', '1' };
+
+static void putVarint(std::vector<unsigned char>& bytes, unsigned long long value) {
+	while (value >= 0x80) {
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+//Zigzag maps small negative numbers to small unsigned ones so they stay short
+static void putSigned(std::vector<unsigned char>& bytes, long long value) {
+	putVarint(bytes, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+static bool getVarint(const std::vector<unsigned char>& bytes, size_t& pos, unsigned long long& value) {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (pos >= bytes.size()) {
+			return false;
+		}
+		unsigned char byte = bytes[pos++];
+		value |= (unsigned long long)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool getSigned(const std::vector<unsigned char>& bytes, size_t& pos, long long& value) {
+	unsigned long long raw;
+	if (!getVarint(bytes, pos, raw)) {
+		return false;
+	}
+
+	value = (long long)(raw >> 1) ^ -(long long)(raw & 1);
+	return true;
+}
+
+//Reads a field stored as a difference from base, false if it does not fit in an int
+static bool getInt(const std::vector<unsigned char>& bytes, size_t& pos, int base, int& value) {
+	long long delta;
+	if (!getSigned(bytes, pos, delta)) {
+		return false;
+	}
+
+	long long wide = (long long)base + delta;
+	if (wide < INT_MIN || wide > INT_MAX) {
+		return false;
+	}
+	value = (int)wide;
+	return true;
+}
+
+/*
+ * Function: encode
+ * ----------------
+ * Each entry is its type byte (bit 3 set if the call succeeded), the tank ID as a
+ * difference from the previous entry and then the fields its type uses
+ *
+ * return: The trace in its binary form
+ */
+std::vector<unsigned char> Trace::encode() const {
+	std::vector<unsigned char> bytes(MAGIC, MAGIC + 4);
+	bytes.reserve(8 + m_entries.size() * 6);
+	putVarint(bytes, m_entries.size());
+	int lastTank = 0;
+
+	for (const TraceEntry& entry : m_entries) {
+		const Command& command = entry.command;
+		bytes.push_back((unsigned char)(command.type | (entry.result ? 8 : 0)));
+		putSigned(bytes, (long long)command.tankID - lastTank);
+		lastTank = command.tankID;
+
+		if (command.type == ADDPUMP || command.type == REMOVEPUMP || command.type == DRAINTANK) {
+			putSigned(bytes, command.pumpID);
+		}
+		if (command.type == ADDPUMP) {
+			putSigned(bytes, (long long)command.target - command.tankID);
+		}
+		if (command.type == ADDTANK || command.type == FILLTANK || command.type == DRAINTANK) {
+			putSigned(bytes, command.amount);
+		}
+	}
+
+	return bytes;
+}
+
+/*
+ * Function: decode
+ * ----------------
+ * bytes: A trace as made by encode
+ *
+ * return: True if the whole buffer was a valid trace, the entries are only replaced then
+ */
+bool Trace::decode(const std::vector<unsigned char>& bytes) {
+	if (bytes.size() < 4 || !std::equal(MAGIC, MAGIC + 4, bytes.begin())) {
+		return false;
+	}
+
+	size_t pos = 4;
+	unsigned long long count;
+	//Every entry takes at least two bytes, a larger count is corrupt
+	if (!getVarint(bytes, pos, count) || count > (bytes.size() - pos) / 2) {
+		return false;
+	}
+
+	std::vector<TraceEntry> entries;
+	entries.reserve(count);
+	int lastTank = 0;
+
+	for (unsigned long long i = 0; i < count; i++) {
+		if (pos >= bytes.size()) {
+			return false;
+		}
+		unsigned char head = bytes[pos++];
+		int type = head & 7;
+		if ((head & ~15) != 0 || type > DRAINTANK) {
+			return false;
+		}
+
+		Command command = Command{ (COMMAND)type, 0, 0, 0, 0 };
+		if (!getInt(bytes, pos, lastTank, command.tankID)) {
+			return false;
+		}
+		lastTank = command.tankID;
+
+		if (type == ADDPUMP || type == REMOVEPUMP || type == DRAINTANK) {
+			if (!getInt(bytes, pos, 0, command.pumpID)) {
+				return false;
+			}
+		}
+		if (type == ADDPUMP && !getInt(bytes, pos, command.tankID, command.target)) {
+			return false;
+		}
+		if (type == ADDTANK || type == FILLTANK || type == DRAINTANK) {
+			if (!getInt(bytes, pos, 0, command.amount)) {
+				return false;
+			}
+		}
+
+		entries.push_back(TraceEntry{ command, (head & 8) != 0 });
+	}
+
+	if (pos != bytes.size()) {
+		return false;
+	}
+
+	m_entries.swap(entries);
+	return true;
+}
+
+bool Trace::save(const std::string& path) const {
+	std::vector<unsigned char> bytes = encode();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+	return (bool)file;
+}
+
+bool Trace::load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return decode(bytes);
+}
+
+/*
+ * Function: generate
+ * ------------------
+ * numCommands: Calls to record
+ * numTanks: Tanks created up front, each with two pumps
+ *
+ * A fixed-seed workload that is mostly fills and drains with some tanks and pumps
+ * coming and going, for trying the harness without a recorded trace
+ */
+void Trace::generate(int numCommands, int numTanks) {
+	FuelSys sys;
+	m_entries.clear();
+	std::mt19937 gen(45);
+	std::uniform_int_distribution<int> pickTank(0, numTanks - 1);
+	std::uniform_int_distribution<int> pickAmount(1, DEFCAP / 4);
+	std::uniform_int_distribution<int> pickCommand(0, 99);
+
+	for (int tankID = 0; tankID < numTanks && size() < numCommands; tankID++) {
+		run(sys, Command{ ADDTANK, tankID, 0, 0, DEFCAP });
+	}
+	for (int tankID = 0; tankID < numTanks && size() < numCommands; tankID++) {
+		run(sys, Command{ ADDPUMP, tankID, 0, pickTank(gen), 0 });
+		run(sys, Command{ ADDPUMP, tankID, 1, pickTank(gen), 0 });
+	}
+
+	while (size() < numCommands) {
+		int choice = pickCommand(gen);
+		int tankID = pickTank(gen);
+
+		if (choice < 45) {
+			run(sys, Command{ FILLTANK, tankID, 0, 0, pickAmount(gen) });
+		}
+		else if (choice < 90) {
+			run(sys, Command{ DRAINTANK, tankID, choice % 2, 0, pickAmount(gen) });
+		}
+		else if (choice < 93) {
+			run(sys, Command{ REMOVETANK, tankID, 0, 0, 0 });
+		}
+		else if (choice < 96) {
+			run(sys, Command{ ADDTANK, tankID, 0, 0, DEFCAP });
+		}
+		else if (choice < 98) {
+			run(sys, Command{ REMOVEPUMP, tankID, choice % 2, 0, 0 });
+		}
+		else {
+			run(sys, Command{ ADDPUMP, tankID, choice % 2, pickTank(gen), 0 });
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include "command.h"
+#include <string>
+#include <vector>
+// one recorded call and what it returned
+struct TraceEntry {
+    Command command;
+    bool result;
+};
+// Trace is an ordered log of the calls made on a system, kept so a real
+// workload can be replayed later. Calls are recorded through run, or by a
+// CommandQueue the trace is set on, in the order they were applied.
+//
+// The binary form starts with "FTR1" and the entry count, then one byte per
+// entry holding the command type and result, followed by only the fields
+// that type uses as zigzag varints. Tank IDs are stored as the difference
+// from the previous entry's tank and pump targets as the difference from
+// their source, so the usual command takes three to six bytes.
+class Trace {
+public:
+    // tasks carry a function the binary form cannot hold, so they are not recorded
+    void record(const Command& command, bool result) {
+        if (command.type != RUNTASK) {
+            m_entries.push_back(TraceEntry{ command, result });
+        }
+    }
+    // make the call on sys and record it
+    template <class S>
+    bool run(S& sys, const Command& command) {
+        bool result = applyCommand(sys, command);
+        record(command, result);
+        return result;
+    }
+    const std::vector<TraceEntry>& entries() const { return m_entries; }
+    int size() const { return (int)m_entries.size(); }
+    void clear() { m_entries.clear(); }
+    // replace the entries with a fixed-seed workload of numCommands calls on numTanks tanks, each given two pumps
+    void generate(int numCommands, int numTanks);
+    std::vector<unsigned char> encode() const;
+    // replace the entries with the decoded ones, false and unchanged if the bytes are not a valid trace
+    bool decode(const std::vector<unsigned char>& bytes);
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+private:
+    std::vector<TraceEntry> m_entries;
+};
+#endif
@@ -0,0 +1,153 @@
+#include "transfer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+void TransferScheduler::TransferAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	m_handle = handle;
+	m_scheduler.m_transfers.push_back(this);
+}
+
+void TransferScheduler::SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	m_scheduler.m_sleepers.push(Sleeper{ m_scheduler.m_now + m_seconds, m_scheduler.m_seq++, handle });
+}
+
+TransferScheduler::TransferScheduler(FuelSys& sys, int dt) : m_sys(sys) {
+	m_dt = dt < 1 ? 1 : dt;
+	m_pace = 0;
+	m_now = 0;
+	m_seq = 0;
+}
+
+TransferScheduler::~TransferScheduler() {
+	for (std::coroutine_handle<Job::promise_type> job : m_jobs) {
+		job.destroy();
+	}
+}
+
+TransferScheduler::TransferAwaiter TransferScheduler::transfer(int tankID, int pumpID, int amount, int rate) {
+	return TransferAwaiter(*this, tankID, pumpID, amount, rate);
+}
+
+TransferScheduler::SleepAwaiter TransferScheduler::sleep(long long seconds) {
+	return SleepAwaiter(*this, seconds);
+}
+
+void TransferScheduler::spawn(Job job) {
+	m_jobs.push_back(job.m_handle);
+	m_ready.push_back(job.m_handle);
+	job.m_handle = nullptr;
+}
+
+/*
+ * Function: resumeReady
+ * ---------------------
+ * Resumes every ready coroutine until each has suspended again, then frees the jobs
+ * that ran to completion
+ */
+void TransferScheduler::resumeReady() {
+	while (!m_ready.empty()) {
+		std::vector<std::coroutine_handle<>> ready;
+		ready.swap(m_ready);
+
+		for (std::coroutine_handle<> handle : ready) {
+			handle.resume();
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_jobs.size(); i++) {
+		if (m_jobs[i].done()) {
+			m_jobs[i].destroy();
+		}
+		else {
+			m_jobs[kept++] = m_jobs[i];
+		}
+	}
+	m_jobs.resize(kept);
+}
+
+/*
+ * Function: step
+ * --------------
+ * Advances time by dt and drains each running transfer in the order they started.
+ * The amount a drain moved is read off the source tank, since drain only reports
+ * whether the target had space. A transfer that moves nothing resumes with the
+ * rest of its amount still to move, which its awaiter reports as a stall
+ */
+void TransferScheduler::step() {
+	m_now += m_dt;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_transfers.size(); i++) {
+		TransferAwaiter* transfer = m_transfers[i];
+		int amount = (int)std::min((long long)transfer->m_amount, (long long)transfer->m_rate * m_dt);
+
+		Tank* source = m_sys.getTank(transfer->m_tankID);
+		int moved = 0;
+		if (source != nullptr) {
+			int before = source->m_tankFuel;
+			m_sys.drain(transfer->m_tankID, transfer->m_pumpID, amount);
+			moved = before - source->m_tankFuel;
+		}
+
+		transfer->m_moved += moved;
+		transfer->m_amount -= moved;
+
+		if (moved == 0 || transfer->m_amount == 0) {
+			m_ready.push_back(transfer->m_handle);
+		}
+		else {
+			m_transfers[kept++] = transfer;
+		}
+	}
+	m_transfers.resize(kept);
+
+	while (!m_sleepers.empty() && m_sleepers.top().wake <= m_now) {
+		m_ready.push_back(m_sleepers.top().handle);
+		m_sleepers.pop();
+	}
+}
+
+/*
+ * Function: run
+ * -------------
+ * until: Time to stop at, -1 to run until every job has finished
+ *
+ * With a pace set, each step waits until its simulated time, scaled by the pace, has
+ * passed on the wall clock since the call began. Skipped idle time is waited out too
+ *
+ * return: Simulated time when it stopped
+ */
+long long TransferScheduler::run(long long until) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long begin = m_now;
+	resumeReady();
+
+	while (!m_transfers.empty() || !m_sleepers.empty()) {
+		if (until >= 0 && m_now >= until) {
+			break;
+		}
+
+		//Nothing is flowing, so skip ahead to the step holding the next wake-up
+		if (m_transfers.empty()) {
+			long long wake = m_sleepers.top().wake;
+			if (wake > m_now + m_dt) {
+				long long skipped = (wake - m_now - 1) / m_dt;
+				if (until >= 0) {
+					skipped = std::min(skipped, std::max(0LL, (until - m_now - 1) / m_dt));
+				}
+				m_now += skipped * m_dt;
+			}
+		}
+
+		if (m_pace > 0) {
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>((m_now + m_dt - begin) * m_pace)));
+		}
+		step();
+		resumeReady();
+	}
+
+	return m_now;
+}
@@ -0,0 +1,117 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+#include "fuel.h"
+#include <coroutine>
+#include <exception>
+#include <queue>
+#include <vector>
+// TransferScheduler runs many long transfers on one thread as C++20
+// coroutines. A job is a coroutine returning TransferScheduler::Job that
+// awaits transfers and sleeps:
+//
+//     TransferScheduler::Job refuel(TransferScheduler& sched) {
+//         TransferScheduler::TransferResult done = co_await sched.transfer(1, 1, 5000, 50);
+//         if (done.stalled) { ... }
+//         co_await sched.sleep(60);
+//     }
+//     sched.spawn(refuel(sched));
+//     sched.run();
+//
+// Simulated time advances in steps of dt seconds. Each step drains rate * dt
+// from every running transfer through FuelSys::drain, so every step is
+// clamped exactly like a drain. A transfer ends once it has moved its amount,
+// or stalls when a step moves nothing because the source is empty, the
+// target is full or the pump is gone; co_await reports the fuel moved and
+// whether it stalled, and converts to the fuel moved. With no transfer
+// running, time jumps straight to the next sleeper. By default run goes as
+// fast as it can; setPace ties simulated seconds to the wall clock.
+class TransferScheduler {
+public:
+    struct TransferResult {
+        int moved;
+        bool stalled; // a step moved nothing, or the rate was not positive, before the whole amount moved
+        operator int() const { return moved; }
+    };
+    class Job {
+    public:
+        struct promise_type {
+            Job get_return_object() { return Job(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+        Job(Job&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+        ~Job() { if (m_handle) m_handle.destroy(); }
+    private:
+        friend class TransferScheduler;
+        explicit Job(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+        std::coroutine_handle<promise_type> m_handle;
+    };
+    class TransferAwaiter {
+    public:
+        bool await_ready() const { return m_amount <= 0 || m_rate <= 0; }
+        void await_suspend(std::coroutine_handle<> handle);
+        TransferResult await_resume() const { return TransferResult{ m_moved, m_amount > 0 }; }
+    private:
+        friend class TransferScheduler;
+        TransferAwaiter(TransferScheduler& scheduler, int tankID, int pumpID, int amount, int rate)
+            : m_scheduler(scheduler), m_tankID(tankID), m_pumpID(pumpID), m_amount(amount), m_rate(rate), m_moved(0) {}
+        TransferScheduler& m_scheduler;
+        int m_tankID;
+        int m_pumpID;
+        int m_amount; // still to move
+        int m_rate;   // kg per second
+        int m_moved;
+        std::coroutine_handle<> m_handle;
+    };
+    class SleepAwaiter {
+    public:
+        bool await_ready() const { return m_seconds <= 0; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {}
+    private:
+        friend class TransferScheduler;
+        SleepAwaiter(TransferScheduler& scheduler, long long seconds) : m_scheduler(scheduler), m_seconds(seconds) {}
+        TransferScheduler& m_scheduler;
+        long long m_seconds;
+    };
+    TransferScheduler(FuelSys& sys, int dt = 1);
+    ~TransferScheduler();
+    // drain amount from the tank through the pump at rate kg per second
+    TransferAwaiter transfer(int tankID, int pumpID, int amount, int rate);
+    // resume after seconds of simulated time
+    SleepAwaiter sleep(long long seconds);
+    // hand a job to the scheduler, it starts on the next run
+    void spawn(Job job);
+    // wall-clock seconds per simulated second for run to keep to, 0 for as fast as possible
+    void setPace(double pace) { m_pace = pace < 0 ? 0 : pace; }
+    // run until every job has finished or time reaches until, return the time
+    long long run(long long until = -1);
+    long long now() const { return m_now; }
+    // jobs not finished yet
+    int jobs() const { return (int)m_jobs.size(); }
+    // transfers in progress
+    int transfers() const { return (int)m_transfers.size(); }
+private:
+    struct Sleeper {
+        long long wake;
+        unsigned seq; // keeps sleepers with the same wake time in order
+        std::coroutine_handle<> handle;
+        bool operator>(const Sleeper& other) const {
+            return wake != other.wake ? wake > other.wake : seq > other.seq;
+        }
+    };
+    FuelSys& m_sys;
+    int m_dt;
+    double m_pace;
+    long long m_now;
+    unsigned m_seq;
+    std::vector<std::coroutine_handle<Job::promise_type>> m_jobs;
+    std::vector<std::coroutine_handle<>> m_ready;
+    std::vector<TransferAwaiter*> m_transfers;
+    std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> m_sleepers;
+    void resumeReady();
+    void step();
+};
+#endif